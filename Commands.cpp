@@ -1,12 +1,21 @@
 #include <unistd.h>
 #include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <iostream>
 #include <vector>
 #include <sstream>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
 #include <fcntl.h>
 #include <iomanip>
+#include <algorithm>
+#include <errno.h>
+#include <signal.h>
 #include "Commands.h"
 
 using namespace std;
@@ -42,139 +51,8 @@ string _trim(const std::string &s)
   return _rtrim(_ltrim(s));
 }
 
-int _parseCommandLine(const char *cmd_line, char **args)
-{
-  FUNC_ENTRY()
-  int i = 0;
-  string cmd = string(cmd_line);
-  size_t indexA = string(cmd_line).find(">>");
-  size_t indexW = string(cmd_line).find(">");
-  if (indexA != string::npos)
-  {
-    cmd = cmd.substr(0, indexA) + " >> " + cmd.substr(indexA + 2, cmd.length() - indexA - 1);
-  }
-  else if (indexW != string::npos)
-  {
-    cmd = cmd.substr(0, indexW) + " > " + cmd.substr(indexW + 1, cmd.length() - indexW);
-  }
-  std::istringstream iss(_trim(string(cmd)).c_str());
-  for (std::string s; iss >> s;)
-  {
-    args[i] = (char *)malloc(s.length() + 1);
-    memset(args[i], 0, s.length() + 1);
-    strcpy(args[i], s.c_str());
-    args[++i] = NULL;
-  }
-  return i;
-
-  FUNC_EXIT()
-}
-
-bool _isBackgroundComamnd(const char *cmd_line)
-{
-  const string str(cmd_line);
-  return str[str.find_last_not_of(WHITESPACE)] == '&';
-}
-
-void _removeBackgroundSign(char *cmd_line)
-{
-  const string str(cmd_line);
-  // find last character other than spaces
-  unsigned int idx = str.find_last_not_of(WHITESPACE);
-  // if all characters are spaces then return
-  if (idx == string::npos)
-  {
-    return;
-  }
-  // if the command line does not end with & then return
-  if (cmd_line[idx] != '&')
-  {
-    return;
-  }
-  // replace the & (background sign) with space and then remove all tailing spaces.
-  cmd_line[idx] = ' ';
-  // truncate the command line string up to the last non-space character
-  cmd_line[str.find_last_not_of(WHITESPACE, idx) + 1] = 0;
-}
-
 //-----------------------------------------------Helper Functions-------------------------------------------------------
 
-/*
- * Parses/Extracts each individual argument and command
- * @param cmd_line - the CMD line received
- * @param numArgs - an int value to be filled with the number of args discovered
- * @return
- *      char** - an array of arguments
- */
-char **getArgs(const char *cmd_line, int *numArgs)
-{
-  // Remove background sign if exists:
-  char cmd[COMMAND_ARGS_MAX_LENGTH];
-  strcpy(cmd, cmd_line);
-  _removeBackgroundSign(cmd);
-  const char *cmd_line_clean = cmd;
-
-  // Parse arguments:
-  char **args = (char **)malloc((COMMAND_ARGS_MAX_LENGTH + 1) * sizeof(char *));
-  if (args == nullptr)
-  {
-    cerr << "smash error: malloc failed" << endl;
-    free(args);
-    return nullptr;
-  }
-  // Initialize args to avoid valgrind errors:
-  std::fill_n(args, COMMAND_ARGS_MAX_LENGTH + 1, nullptr);
-  *numArgs = _parseCommandLine(cmd_line_clean, args);
-  return args;
-}
-
-/*
- * Delete the args array received from getArgs()
- * @param args - the args array
- * @return
- *      void
- */
-void deleteArgs(char **args)
-{
-  // Delete each argument in args:
-  for (int i = 0; i < COMMAND_MAX_ARGS + 1; i++)
-  {
-    free(args[i]);
-  }
-  // Delete args itself:
-  free(args);
-}
-
-/*
- * Checks whether a given path is a full or partial path
- * @param newPath - the new path
- * @return
- *      bool - whether the new path is a full path
- */
-bool checkFullPath(char *newPath)
-{
-  if (newPath[0] == '/')
-    return true;
-  return false;
-}
-
-/*
- * Splices a given directory to "go up" (remove last directory)
- * @param dir - the current directory
- * @return
- *      char* - a pointer to the directory after "going up"
- */
-char *goUp(char *dir)
-{
-  if (!strcmp(dir, "/"))
-  {
-    return dir;
-  }
-  int cut = string(dir).find_last_of("/");
-  dir[cut] = '\0';
-  return dir;
-}
-
 /*
  * Checks if the string received is a number
  * @param s - the string received
@@ -191,319 +69,280 @@ bool is_number(const std::string &s)
 
 //-----------------------------------------------Command-----------------------------------------------
 
-Command::Command(const char *cmd_line) : m_cmd_line(cmd_line) {}
+Command::Command(const char *cmd_line, const ParsedLine &line) : m_cmd_line(cmd_line), m_line(&line) {}
 
 Command::~Command()
 {
   m_cmd_line = nullptr;
+  m_line = nullptr;
 }
 
-void Command::firstUpdateCurrDir()
+
+//-----------------------------------------------BuiltInCommand-----------------------------------------------
+
+//-------------------------------------Built-In Commands-------------------------------------
+//-------------------------------------ChangePromptCommand-------------------------------------
+
+ChangePromptCommand::ChangePromptCommand() {}
+
+ChangePromptCommand::~ChangePromptCommand() {}
+
+void ChangePromptCommand::execute(const ParsedLine &line) const
 {
+  int numArgs = line.numArgs;
+  char **args = line.args;
   SmallShell &smash = SmallShell::getInstance();
-  char *buffer = (char *)malloc(MAX_PATH_LENGTH * sizeof(char) + 1);
-  if (!buffer)
+  if (numArgs == 1)
   {
-    free(buffer);
-    cerr << "smash error: malloc failed" << endl;
-    return;
+    smash.chngPrompt();
   }
-  buffer = getcwd(buffer, MAX_PATH_LENGTH);
-  if (!buffer)
+  else
   {
-    free(buffer);
-    perror("smash error: getcwd failed");
-    return;
+    smash.chngPrompt(string(args[1]));
   }
-  smash.setCurrDir(buffer);
-  free(buffer);
 }
 
-//-----------------------------------------------BuiltInCommand-----------------------------------------------
+//-------------------------------------ShowPidCommand-------------------------------------
 
-BuiltInCommand::BuiltInCommand(const char *cmd_line) : Command::Command(cmd_line) {}
+ShowPidCommand::ShowPidCommand() {}
 
-//-----------------------------------------------Jobs-----------------------------------------------
-JobsList::JobEntry::JobEntry(int id, pid_t pid, const char *cmd, bool isStopped) : m_id(id), m_pid(pid),
-                                                                                   m_isStopped(isStopped)
+void ShowPidCommand::execute(const ParsedLine &line) const
 {
-  strcpy(m_cmd, cmd);
+  SmallShell &smash = SmallShell::getInstance();
+  cout << "smash pid is " << smash.m_pid << endl;
 }
 
-void JobsList::addJob(const char *cmd, pid_t pid, bool isStopped)
+bool ShowPidCommand::isReadOnly(const ParsedLine &line) const
 {
-  removeFinishedJobs();
-  JobEntry newJob(max_id + 1, pid, cmd, isStopped);
-  this->m_list.push_back(newJob);
-  max_id++;
+  return true;
 }
 
-void JobsList::printJobsList()
+//-------------------------------------GetCurrDirCommand-------------------------------------
+
+GetCurrDirCommand::GetCurrDirCommand() {}
+
+void GetCurrDirCommand::execute(const ParsedLine &line) const
 {
-  removeFinishedJobs();
-  int i = 1;
-  for (JobEntry job : m_list)
-  {
-    std::cout << "[" << job.m_id << "] " << job.m_cmd << endl;
-    i++;
-  }
+  cout << SmallShell::getInstance().getWorkingDir()->path() << endl;
 }
 
-void JobsList::killAllJobs()
+bool GetCurrDirCommand::isReadOnly(const ParsedLine &line) const
 {
-  removeFinishedJobs();
-  cout << "smash: sending SIGKILL signal to " << m_list.size() << " jobs:" << endl;
-  for (JobEntry element : m_list)
-  {
-    cout << element.m_pid << ": " << element.m_cmd << endl;
-    if (kill(element.m_pid, SIGKILL) == SYS_FAIL)
-    {
-      perror("smash error: kill failed");
-    }
-  }
+  return true;
 }
 
-JobsList::JobEntry *JobsList::getJobById(int jobId)
+/*
+ * Forgets what depends on the current directory after it changed
+ * Receives no parameters
+ * @return
+ *      void
+ */
+static void leftDirectory()
 {
-  removeFinishedJobs();
-  for (auto &job : m_list)
-  {
-    if (job.m_id == jobId)
-    {
-      return &job;
-    }
-  }
-  return nullptr;
+  // The listings of relative patterns are cached by relative path:
+  SmallShell::getInstance().getGlobber()->clear();
 }
 
-void JobsList::removeJobById(int jobId)
+/*
+ * Prints the current directory and the directory stack from its top down, on one line
+ * Receives no parameters
+ * @return
+ *      void
+ */
+static void printDirectoryStack()
 {
-  for (auto it = m_list.begin(); it != m_list.end(); ++it)
+  vector<string> dirs;
+  SmallShell::getInstance().getWorkingDir()->listStack(dirs);
+  for (size_t i = 0; i < dirs.size(); i++)
   {
-    auto job = *it;
-    if (jobId == job.m_pid)
-    {
-      m_list.erase(it);
-      --it;
-      return;
-    }
+    cout << (i > 0 ? " " : "") << dirs[i];
   }
+  cout << endl;
 }
 
-void JobsList::sigJobById(int jobId, int signum)
+//-------------------------------------ChangeDirCommand-------------------------------------
+
+ChangeDirCommand::ChangeDirCommand() {}
+
+void ChangeDirCommand::execute(const ParsedLine &line) const
 {
-  JobEntry *job = getJobById(jobId);
-  if (!job)
+  WorkingDir *workingDir = SmallShell::getInstance().getWorkingDir();
+  int numArgs = line.numArgs;
+  char **args = line.args;
+  if (numArgs > 2) // The command itself counts as an arg
   {
-    cerr << "smash error: kill: job-id " << jobId << " does not exist" << endl;
+    cerr << "smash error: cd: too many arguments" << endl;
     return;
   }
-  if (kill(job->m_pid, signum) == SYS_FAIL)
+  else if (numArgs < 2)
   {
-    perror("smash error: kill failed");
     return;
   }
-  if (signum == SIGTSTP)
+  else if (string(args[1]) == "-")
   {
-    job->m_isStopped = true;
+    if (workingDir->previous().empty())
+    {
+      cerr << "smash error: cd: OLDPWD not set" << endl;
+      return;
+    }
+    if (workingDir->changeBack())
+    {
+      leftDirectory();
+    }
+    return;
   }
-  else if (signum == SIGCONT)
+  if (workingDir->change(args[1]))
   {
-    job->m_isStopped = false;
+    leftDirectory();
   }
-  cout << "signal number " << signum << " was sent to pid " << job->m_pid << endl;
 }
 
-bool JobsList::isEmpty()
-{
-  return !m_list.size();
-}
+//-------------------------------------PushDirCommand-------------------------------------
 
-int JobsList::getMaxId()
-{
-  return max_id;
-}
+PushDirCommand::PushDirCommand() {}
 
-void JobsList::removeFinishedJobs()
+void PushDirCommand::execute(const ParsedLine &line) const
 {
-  if (m_list.empty())
+  WorkingDir *workingDir = SmallShell::getInstance().getWorkingDir();
+  if (line.numArgs > 2)
   {
-    max_id = 0;
+    cerr << "smash error: pushd: too many arguments" << endl;
     return;
   }
-  int max = 0;
-  for (auto it = m_list.begin(); it != m_list.end(); ++it)
+  if (line.numArgs < 2 && workingDir->depth() == 0)
   {
-    auto job = *it;
-    int status;
-    int ret_wait = waitpid(job.m_pid, &status, WNOHANG);
-    if (ret_wait == job.m_pid || ret_wait == -1)
-    {
-      m_list.erase(it);
-      --it;
-    }
-    else if (job.m_id > max)
-    {
-      max = job.m_id;
-    }
+    cerr << "smash error: pushd: no other directory" << endl;
+    return;
+  }
+  if (workingDir->push(line.numArgs < 2 ? nullptr : line.args[1]))
+  {
+    leftDirectory();
+    printDirectoryStack();
   }
-  max_id = max;
 }
 
-//-------------------------------------Built-In Commands-------------------------------------
-//-------------------------------------ChangePromptCommand-------------------------------------
+//-------------------------------------PopDirCommand-------------------------------------
 
-ChangePromptCommand::ChangePromptCommand(const char *cmd_line) : BuiltInCommand::BuiltInCommand(cmd_line) {}
-
-ChangePromptCommand::~ChangePromptCommand() {}
+PopDirCommand::PopDirCommand() {}
 
-void ChangePromptCommand::execute()
+void PopDirCommand::execute(const ParsedLine &line) const
 {
-  int numArgs = 0;
-  char **args = getArgs(this->m_cmd_line, &numArgs);
-  SmallShell &smash = SmallShell::getInstance();
-  if (numArgs == 1)
+  WorkingDir *workingDir = SmallShell::getInstance().getWorkingDir();
+  if (line.numArgs > 1)
   {
-    smash.chngPrompt();
+    cerr << "smash error: popd: too many arguments" << endl;
+    return;
   }
-  else
+  if (workingDir->depth() == 0)
   {
-    smash.chngPrompt(string(args[1]));
+    cerr << "smash error: popd: directory stack empty" << endl;
+    return;
+  }
+  if (workingDir->pop())
+  {
+    leftDirectory();
+    printDirectoryStack();
   }
-  deleteArgs(args);
 }
 
-//-------------------------------------ShowPidCommand-------------------------------------
+//-------------------------------------DirsCommand-------------------------------------
 
-ShowPidCommand::ShowPidCommand(const char *cmd_line) : BuiltInCommand(cmd_line) {}
+DirsCommand::DirsCommand() {}
 
-void ShowPidCommand::execute()
+void DirsCommand::execute(const ParsedLine &line) const
 {
-  SmallShell &smash = SmallShell::getInstance();
-  cout << "smash pid is " << smash.m_pid << endl;
+  if (line.numArgs == 1)
+  {
+    printDirectoryStack();
+  }
+  else if (line.numArgs == 2 && strcmp(line.args[1], "-c") == 0)
+  {
+    SmallShell::getInstance().getWorkingDir()->clearStack();
+  }
+  else
+  {
+    cerr << "smash error: dirs: invalid arguments" << endl;
+  }
 }
 
-//-------------------------------------GetCurrDirCommand-------------------------------------
-
-GetCurrDirCommand::GetCurrDirCommand(const char *cmd_line) : BuiltInCommand(cmd_line) {}
-
-void GetCurrDirCommand::execute()
+bool DirsCommand::isReadOnly(const ParsedLine &line) const
 {
-  SmallShell &smash = SmallShell::getInstance();
-  if (!strcmp(smash.getCurrDir(), ""))
-  {
-    firstUpdateCurrDir();
-  }
-  cout << string(smash.getCurrDir()) << endl;
+  return line.numArgs == 1;
 }
 
-//-------------------------------------ChangeDirCommand-------------------------------------
+//-------------------------------------JobsCommand-------------------------------------
 
-ChangeDirCommand::ChangeDirCommand(const char *cmd_line, char **plastPwd) : BuiltInCommand(cmd_line),
-                                                                            m_plastPwd(plastPwd) {}
+JobsCommand::JobsCommand() {}
 
-void ChangeDirCommand::execute()
+void JobsCommand::execute(const ParsedLine &line) const
 {
   SmallShell &smash = SmallShell::getInstance();
-  if (!strcmp(smash.getCurrDir(), ""))
-  {
-    firstUpdateCurrDir();
-  }
-  int numArgs = 0;
-  char **args = getArgs(this->m_cmd_line, &numArgs);
-  if (numArgs > 2) // The command itself counts as an arg
+  JobsList *jobs = smash.getJobs();
+  if (line.numArgs > 1 && strcmp(line.args[1], "-l") == 0)
   {
-    cerr << "smash error: cd: too many arguments" << endl;
-    deleteArgs(args);
-    return;
+    jobs->printJobsDetails();
   }
-  else if (!strcmp(*m_plastPwd, "") && string(args[1]) == "-")
+  else if (line.numArgs > 1 && strcmp(line.args[1], "--done") == 0)
   {
-    cerr << "smash error: cd: OLDPWD not set" << endl;
-    deleteArgs(args);
-    return;
+    jobs->printFinishedJobs();
   }
-  else if (string(args[1]) == "-")
+  else if (line.numArgs > 1 && strcmp(line.args[1], "--max") == 0)
   {
-    if (chdir(*m_plastPwd) == SYS_FAIL)
+    if (line.numArgs == 2)
     {
-      perror("smash error: chdir failed");
-      deleteArgs(args);
-      return;
+      size_t maxRunning = jobs->getMaxRunning();
+      cout << "max running jobs: " << (maxRunning == 0 ? "unlimited" : to_string(maxRunning)) << endl;
+    }
+    else if (line.numArgs == 3 && strcmp(line.args[2], "cores") == 0)
+    {
+      long cores = sysconf(_SC_NPROCESSORS_ONLN);
+      jobs->setMaxRunning(cores > 0 ? cores : 1);
+    }
+    else if (line.numArgs == 3 && line.args[2][strspn(line.args[2], "0123456789")] == '\0' && strlen(line.args[2]) <= 9)
+    {
+      jobs->setMaxRunning(stoul(line.args[2]));
+    }
+    else
+    {
+      cerr << "smash error: jobs: invalid arguments" << endl;
     }
-    // Switch current and previous directories
-    char temp[MAX_PATH_LENGTH + 1];
-    strcpy(temp, smash.getPrevDir());
-    smash.setPrevDir();
-    smash.setCurrDir(temp);
-    deleteArgs(args);
-    return;
-  }
-  if (chdir(args[1]) == SYS_FAIL)
-  {
-    perror("smash error: chdir failed");
-    deleteArgs(args);
-    return;
-  }
-  // If the given "path" is to go up, remove the last part of the current path
-  if (string(args[1]) == "..")
-  {
-    smash.setPrevDir();
-    goUp(smash.getCurrDir());
-    deleteArgs(args);
-    return;
-  }
-
-  // If the new path is the full path, set currDir equal to it
-  if (checkFullPath(args[1]))
-  {
-    smash.setPrevDir();
-    smash.setCurrDir(args[1]);
   }
-  // If not, append the new folder to the end of the current path
   else
   {
-    smash.setPrevDir();
-    smash.setCurrDir(smash.getCurrDir(), args[1]);
+    jobs->printJobsList();
   }
-  deleteArgs(args);
 }
 
-//-------------------------------------JobsCommand-------------------------------------
-
-JobsCommand::JobsCommand(const char *cmd_line) : BuiltInCommand(cmd_line) {}
-
-void JobsCommand::execute()
+bool JobsCommand::isReadOnly(const ParsedLine &line) const
 {
-  SmallShell &smash = SmallShell::getInstance();
-  smash.getJobs()->printJobsList();
+  return line.numArgs == 1 || strcmp(line.args[1], "--max") != 0 || line.numArgs == 2;
 }
 
 //-------------------------------------Foreground-------------------------------------
 
-ForegroundCommand::ForegroundCommand(const char *cmd_line, JobsList *jobs) : BuiltInCommand(cmd_line), m_jobs(jobs) {}
+ForegroundCommand::ForegroundCommand() {}
 
-void ForegroundCommand::execute()
+void ForegroundCommand::execute(const ParsedLine &line) const
 {
-  int numArgs;
-  char **args = getArgs(this->m_cmd_line, &numArgs);
+  SmallShell &smash = SmallShell::getInstance();
+  JobsList *jobs = smash.getJobs();
+  int numArgs = line.numArgs;
+  char **args = line.args;
   int job_id;
   if (numArgs == 1)
   {
-    if (m_jobs->isEmpty())
+    if (jobs->isEmpty())
     {
       cerr << "smash error: fg: jobs list is empty" << endl;
-      deleteArgs(args);
       return;
     }
     {
-      job_id = m_jobs->getMaxId();
+      job_id = jobs->getMaxId();
     }
   }
   else if (!is_number(args[1]))
   {
     cerr << "smash error: fg: invalid arguments" << endl;
-    deleteArgs(args);
     return;
   }
   else
@@ -511,317 +350,1344 @@ void ForegroundCommand::execute()
     job_id = stoi(args[1]);
   }
 
-  JobsList::JobEntry *job = m_jobs->getJobById(job_id);
+  JobsList::JobEntry *job = jobs->getJobById(job_id);
   if (!job)
   {
     cerr << "smash error: fg: job-id " << job_id << " does not exist" << endl;
-    deleteArgs(args);
     return;
   }
-  if (m_jobs->isEmpty())
+  if (jobs->isEmpty())
   {
     cerr << "smash error: fg: jobs list is empty" << endl;
-    deleteArgs(args);
     return;
   }
   if (numArgs > 2)
   {
     cerr << "smash error: fg: invalid arguments" << endl;
-    deleteArgs(args);
     return;
   }
 
-  SmallShell &smash = SmallShell::getInstance();
   if (job_id >= 0 && job)
   {
+    // A queued job starts now, ahead of the queue and whatever the limit:
+    if (job->m_isQueued && !jobs->startQueuedJob(job_id))
+    {
+      return;
+    }
     int job_pid = job->m_pid;
     if (job->m_isStopped)
     {
-      if (kill(job_pid, SIGCONT) == SYS_FAIL)
+      if (signalProcessGroup(job_pid, job->m_pidfd, SIGCONT) == SYS_FAIL)
       {
         perror("smash error: kill failed");
-        deleteArgs(args);
         return;
       }
     }
-    int status;
     cout << job->m_cmd << " " << job_pid << endl;
-    smash.m_pid_fg = job_pid;
-    m_jobs->removeJobById(job_id);
-    if (waitpid(job_pid, &status, WUNTRACED) == SYS_FAIL)
-    {
-      perror("smash error: waitpid failed");
-      deleteArgs(args);
-      return;
-    }
-    smash.m_pid_fg = 0;
+    smash.waitForeground(job_pid, jobs->takeJobById(job_id));
   }
-  deleteArgs(args);
 }
 
 //-------------------------------------QuitCommand-------------------------------------
 
-QuitCommand::QuitCommand(const char *cmd_line, JobsList *jobs) : BuiltInCommand(cmd_line), m_jobs(jobs) {}
+QuitCommand::QuitCommand() {}
 
-void QuitCommand::execute()
+/*
+ * Parses a duration: a number of seconds, with a fraction or not, followed by "s", "ms" or nothing
+ * @param text - the duration
+ * @param durationNs - set to the duration in nanoseconds
+ * @return
+ *      bool - false if the duration is invalid
+ */
+static bool parseDuration(const char *text, int64_t &durationNs)
 {
-  int numArgs = 0;
-  char **args = getArgs(this->m_cmd_line, &numArgs);
-  if (numArgs > 1 && string(args[1]) == "kill")
+  char *unit;
+  errno = 0;
+  double amount = strtod(text, &unit);
+  if (unit == text || errno != 0 || !(amount >= 0) || amount > 1e6 || !isdigit(static_cast<unsigned char>(text[0])))
   {
-    m_jobs->killAllJobs();
+    return false;
   }
-  deleteArgs(args);
-}
-
-//-------------------------------------Kill-------------------------------------
-
-KillCommand::KillCommand(const char *cmd_line, JobsList *jobs) : BuiltInCommand(cmd_line), m_jobs(jobs) {}
-
-void KillCommand::execute()
-{
-  int num_of_args;
-  int job_id;
-  int signum;
-  char **args = getArgs(this->m_cmd_line, &num_of_args);
-  if (num_of_args < 3)
+  if (strcmp(unit, "ms") == 0)
   {
-    cerr << "smash error: kill: invalid arguments" << endl;
-    deleteArgs(args);
-    return;
+    amount /= 1e3;
   }
-  try
+  else if (*unit != '\0' && strcmp(unit, "s") != 0)
   {
-    SmallShell &smash = SmallShell::getInstance();
-    // Check for a valid job-id
-    if (!is_number(args[2]))
-      throw exception();
-    job_id = stoi(args[2]);
+    return false;
+  }
+  durationNs = static_cast<int64_t>(amount * 1e9);
+  return true;
+}
 
-    JobsList::JobEntry *job = smash.getJobs()->getJobById(job_id);
-    if (!job)
+void QuitCommand::execute(const ParsedLine &line) const
+{
+  int numArgs = line.numArgs;
+  char **args = line.args;
+  if (numArgs > 1 && string(args[1]) == "kill")
+  {
+    int64_t graceNs = 0;
+    if (numArgs > 2 && (string(args[2]) != "--grace" || numArgs != 4 || !parseDuration(args[3], graceNs)))
     {
-      cerr << "smash error: kill: job-id " << job_id << " does not exist" << endl;
-      deleteArgs(args);
-      return;
+      // The shell exits either way, so the jobs are still killed, at once:
+      cerr << "smash error: quit: invalid arguments" << endl;
+      graceNs = 0;
     }
+    SmallShell::getInstance().getJobs()->killAllJobs(graceNs);
+  }
+}
+
+//-------------------------------------Kill-------------------------------------
 
-    // Check for a valid signal number
-    char first_char = string(args[1]).at(0);
-    char minus = '-';
-    if (first_char != minus)
-      throw exception();
+/*
+ *  JobRange Struct:
+ *  Job IDs named by an argument of kill.
+ *  first: The first job ID
+ *  last: The last job ID
+ *  isRange: Whether the argument named a range, whose IDs need not all be in use
+ */
+struct JobRange
+{
+  int first;
+  int last;
+  bool isRange;
+};
 
-    if (!is_number(string(args[1]).erase(0, 1)))
-      throw exception();
-    signum = stoi(string(args[1]).erase(0, 1));
+/*
+ * Reads a job ID, written with or without a leading "%"
+ * @param text - the ID; moved past it
+ * @param jobId - set to the ID
+ * @return
+ *      bool - false if there is no ID
+ */
+static bool readJobId(const char *&text, int &jobId)
+{
+  if (*text == '%')
+  {
+    text++;
   }
-  catch (exception &)
+  if (!isdigit(static_cast<unsigned char>(*text)))
   {
-    cerr << "smash error: kill: invalid arguments" << endl;
-    deleteArgs(args);
-    return;
+    return false;
   }
-
-  if (num_of_args > 3)
+  long id = 0;
+  while (isdigit(static_cast<unsigned char>(*text)))
   {
-    cerr << "smash error: kill: invalid arguments" << endl;
-    deleteArgs(args);
-    return;
+    id = min(id * 10 + (*text++ - '0'), static_cast<long>(INT_MAX));
   }
-  m_jobs->sigJobById(job_id, signum);
-  deleteArgs(args);
+  jobId = static_cast<int>(id);
+  return true;
 }
 
-//-------------------------------------ExternalCommand-------------------------------------
-
-ExternalCommand::ExternalCommand(const char *cmd_line) : Command(cmd_line) {}
-
-void ExternalCommand::execute()
+/*
+ * Parses a set of jobs: job IDs and ranges of them separated by commas, such as "%1,%4-%9"
+ * @param text - the set
+ * @param ranges - receives the IDs
+ * @return
+ *      bool - false if the set is invalid
+ */
+static bool parseJobSet(const char *text, vector<JobRange> &ranges)
 {
-  bool isComplex = string(this->m_cmd_line).find("*") != string::npos || string(this->m_cmd_line).find("?") != string::npos;
-  if (isComplex)
+  while (true)
   {
-    char cmd_trimmed[COMMAND_ARGS_MAX_LENGTH];
-    strcpy(cmd_trimmed, _trim(string(this->m_cmd_line)).c_str());
-    char c[] = "-c";
-    char path[] = "/bin/bash";
-    char *complexArgs[] = {path, c, cmd_trimmed, nullptr};
-    if (execv(path, complexArgs) == -1)
+    JobRange range;
+    if (!readJobId(text, range.first))
     {
-      perror("smash error: execv failed");
-      exit(0);
+      return false;
     }
-  }
-  else
-  {
-    int numArgs = 0;
-    char **args = getArgs(this->m_cmd_line, &numArgs);
-    string command = string(args[0]);
-    if (execvp(command.c_str(), args) == -1)
+    range.last = range.first;
+    range.isRange = *text == '-';
+    if (range.isRange && (!readJobId(++text, range.last) || range.last < range.first))
     {
-      perror("smash error: execvp failed");
-      deleteArgs(args);
-      exit(0);
+      return false;
+    }
+    ranges.push_back(range);
+    if (*text == '\0')
+    {
+      return true;
+    }
+    if (*text++ != ',')
+    {
+      return false;
     }
-    deleteArgs(args);
   }
 }
 
-//-------------------------------------Special Commands-------------------------------------
-//-------------------------------------Redirection Command-------------------------------------
-
-RedirectionCommand::RedirectionCommand(const char *cmd_line) : Command(cmd_line) {}
-
-void RedirectionCommand::execute()
+/*
+ *  SignalName Struct:
+ *  A name kill takes for a signal.
+ *  name: The name, without "SIG"
+ *  number: The signal number
+ */
+struct SignalName
 {
-  int numArgs = 0;
-  char **args = getArgs(this->m_cmd_line, &numArgs);
-  SmallShell &smash = SmallShell::getInstance();
-  char cmd[COMMAND_ARGS_MAX_LENGTH + 1];
-  strcpy(cmd, this->m_cmd_line);
-  char *over = strstr(cmd, ">");
-  char *app = strstr(cmd, ">>");
-  for (int i = 0; i < COMMAND_MAX_ARGS; i++)
-  {
-    if (app != nullptr && strcmp(">>", args[i]) == 0)
+  const char *name;
+  int number;
+};
+
+// The signals kill knows by name; sigabbrev_np would list them, but needs glibc 2.32:
+static const SignalName signalNames[] = {
+    {"HUP", SIGHUP},     {"INT", SIGINT},       {"QUIT", SIGQUIT},   {"ILL", SIGILL},     {"TRAP", SIGTRAP},
+    {"ABRT", SIGABRT},   {"IOT", SIGIOT},       {"BUS", SIGBUS},     {"FPE", SIGFPE},     {"KILL", SIGKILL},
+    {"USR1", SIGUSR1},   {"SEGV", SIGSEGV},     {"USR2", SIGUSR2},   {"PIPE", SIGPIPE},   {"ALRM", SIGALRM},
+    {"TERM", SIGTERM},   {"STKFLT", SIGSTKFLT}, {"CHLD", SIGCHLD},   {"CONT", SIGCONT},   {"STOP", SIGSTOP},
+    {"TSTP", SIGTSTP},   {"TTIN", SIGTTIN},     {"TTOU", SIGTTOU},   {"URG", SIGURG},     {"XCPU", SIGXCPU},
+    {"XFSZ", SIGXFSZ},   {"VTALRM", SIGVTALRM}, {"PROF", SIGPROF},   {"WINCH", SIGWINCH}, {"IO", SIGIO},
+    {"POLL", SIGPOLL},   {"PWR", SIGPWR},       {"SYS", SIGSYS}};
+
+/*
+ * Parses the signal argument of kill: "-" followed by a signal number or name, such as -15, -TERM or -SIGTERM
+ * @param text - the argument
+ * @param signum - set to the signal number
+ * @return
+ *      bool - false if the argument is invalid
+ */
+static bool parseSignal(const char *text, int &signum)
+{
+  if (text[0] != '-' || text[1] == '\0')
+  {
+    return false;
+  }
+  const char *name = text + 1;
+  if (isdigit(static_cast<unsigned char>(*name)))
+  {
+    char *end;
+    long number = strtol(name, &end, 10);
+    signum = static_cast<int>(min(number, static_cast<long>(INT_MAX)));
+    return *end == '\0';
+  }
+  if (strncasecmp(name, "SIG", 3) == 0)
+  {
+    name += 3;
+  }
+  for (const SignalName &known : signalNames)
+  {
+    if (strcasecmp(known.name, name) == 0)
+    {
+      signum = known.number;
+      return true;
+    }
+  }
+  return false;
+}
+
+KillCommand::KillCommand() {}
+
+void KillCommand::execute(const ParsedLine &line) const
+{
+  int num_of_args = line.numArgs;
+  char **args = line.args;
+  vector<JobRange> ranges;
+  bool isValid = num_of_args >= 3;
+  for (int i = 2; i < num_of_args && isValid; i++)
+  {
+    isValid = parseJobSet(args[i], ranges);
+  }
+  if (!isValid)
+  {
+    cerr << "smash error: kill: invalid arguments" << endl;
+    return;
+  }
+  JobsList *jobs = SmallShell::getInstance().getJobs();
+  // A single job that does not exist is reported ahead of an invalid signal:
+  if (ranges.size() == 1 && !ranges[0].isRange && jobs->getJobById(ranges[0].first) == nullptr)
+  {
+    cerr << "smash error: kill: job-id " << ranges[0].first << " does not exist" << endl;
+    return;
+  }
+  int signum;
+  if (!parseSignal(args[1], signum))
+  {
+    cerr << "smash error: kill: invalid arguments" << endl;
+    return;
+  }
+  for (const JobRange &range : ranges)
+  {
+    if (!range.isRange)
+    {
+      jobs->sigJobById(range.first, signum);
+    }
+    else if (jobs->sigJobRange(range.first, range.last, signum) == 0)
     {
-      *app = '\0';
-      if (close(1) == SYS_FAIL)
+      cerr << "smash error: kill: no jobs in %" << range.first << "-%" << range.last << endl;
+    }
+  }
+}
+
+//-------------------------------------PlanCacheCommand-------------------------------------
+
+PlanCacheCommand::PlanCacheCommand() {}
+
+void PlanCacheCommand::execute(const ParsedLine &line) const
+{
+  int numArgs = line.numArgs;
+  char **args = line.args;
+  PlanCache *plans = SmallShell::getInstance().getPlans();
+  if (numArgs > 2 || (numArgs == 2 && strcmp(args[1], "-c") != 0))
+  {
+    cerr << "smash error: plancache: invalid arguments" << endl;
+    return;
+  }
+  cout << "plan cache: " << plans->size() << "/" << plans->capacity() << " plans, "
+       << plans->hits() << " hits, " << plans->misses() << " misses" << endl;
+  if (numArgs == 2)
+  {
+    // The plan of this very line may be cached, so nothing is read after clearing:
+    plans->clear();
+  }
+}
+
+bool PlanCacheCommand::isReadOnly(const ParsedLine &line) const
+{
+  return line.numArgs == 1;
+}
+
+//-------------------------------------HashCommand-------------------------------------
+
+HashCommand::HashCommand() {}
+
+void HashCommand::execute(const ParsedLine &line) const
+{
+  int numArgs = line.numArgs;
+  char **args = line.args;
+  PathCache *paths = SmallShell::getInstance().getPathCache();
+  int first = 1;
+  if (numArgs > 1 && strcmp(args[1], "-r") == 0)
+  {
+    paths->clear();
+    first = 2;
+  }
+  for (int i = first; i < numArgs; i++)
+  {
+    if (args[i][0] == '-')
+    {
+      cerr << "smash error: hash: invalid arguments" << endl;
+      return;
+    }
+  }
+  if (first < numArgs)
+  {
+    for (int i = first; i < numArgs; i++)
+    {
+      if (paths->lookup(args[i]) == nullptr)
       {
-        perror("smash error: close failed");
-        deleteArgs(args);
-        return;
+        cerr << "smash error: hash: " << args[i] << ": not found" << endl;
       }
-      if (open(args[i + 1], O_WRONLY | O_APPEND | O_CREAT, 0777) == SYS_FAIL)
+    }
+    return;
+  }
+  if (first == 2)
+  {
+    return;
+  }
+  const auto &entries = paths->entries();
+  if (entries.empty())
+  {
+    cout << "hash: hash table empty" << endl;
+    return;
+  }
+  vector<const PathCache::Entry *> sorted;
+  for (const auto &entry : entries)
+  {
+    sorted.push_back(&entry.second);
+  }
+  sort(sorted.begin(), sorted.end(),
+       [](const PathCache::Entry *a, const PathCache::Entry *b) { return strcmp(a->name.get(), b->name.get()) < 0; });
+  cout << "path cache: " << entries.size() << " commands, " << paths->hits() << " hits, " << paths->misses()
+       << " misses" << endl;
+  cout << "hits\tcommand" << endl;
+  for (const PathCache::Entry *entry : sorted)
+  {
+    cout << setw(4) << right << entry->hits << "\t"
+         << (entry->path.empty() ? string(entry->name.get()) + " (not found)" : entry->path) << endl;
+  }
+}
+
+bool HashCommand::isReadOnly(const ParsedLine &line) const
+{
+  return line.numArgs == 1;
+}
+
+//-------------------------------------PipesCommand-------------------------------------
+
+PipesCommand::PipesCommand() {}
+
+void PipesCommand::execute(const ParsedLine &line) const
+{
+  int numArgs = line.numArgs;
+  char **args = line.args;
+  PipeOptions *options = SmallShell::getInstance().getPipeOptions();
+  PipeOptions updated = *options;
+  for (int i = 1; i < numArgs; i += 2)
+  {
+    const char *value = i + 1 < numArgs ? args[i + 1] : nullptr;
+    if (value != nullptr && strcmp(args[i], "-s") == 0 && is_number(value) && value[0] != '-' && strlen(value) < 10)
+    {
+      updated.size = stoi(value);
+    }
+    else if (value != nullptr && strcmp(args[i], "-r") == 0 && (strcmp(value, "on") == 0 || strcmp(value, "off") == 0))
+    {
+      updated.relay = strcmp(value, "on") == 0;
+    }
+    else
+    {
+      cerr << "smash error: pipes: invalid arguments" << endl;
+      return;
+    }
+  }
+  if (updated.size != options->size && updated.size > 0)
+  {
+    // Try the capacity once here, since pipelines keep the default capacity when it is refused:
+    int probe[2];
+    if (makePipe(probe, 0) == SYS_FAIL)
+    {
+      perror("smash error: pipe failed");
+      return;
+    }
+    int granted = fcntl(probe[1], F_SETPIPE_SZ, updated.size);
+    if (granted == SYS_FAIL)
+    {
+      perror("smash error: fcntl failed");
+    }
+    close(probe[0]);
+    close(probe[1]);
+    if (granted == SYS_FAIL)
+    {
+      return;
+    }
+    updated.size = granted;
+  }
+  *options = updated;
+  if (numArgs > 1)
+  {
+    return;
+  }
+  cout << "pipe size: " << (options->size > 0 ? to_string(options->size) : "default") << endl;
+  cout << "relay: " << (options->relay ? "on" : "off") << endl;
+}
+
+bool PipesCommand::isReadOnly(const ParsedLine &line) const
+{
+  return line.numArgs == 1;
+}
+
+//-------------------------------------TimeoutCommand-------------------------------------
+
+/*
+ * Checks the arguments of timeout: a positive number of seconds and a command
+ * @param line - the parsed CMD line
+ * @return
+ *      bool - whether the arguments are valid; if not, the error was printed
+ */
+static bool checkTimeoutArgs(const ParsedLine &line)
+{
+  const char *seconds = line.numArgs > 1 ? line.args[1] : "";
+  if (line.numArgs < 3 || !is_number(seconds) || seconds[0] == '-' || strlen(seconds) > 9 || stoi(seconds) == 0)
+  {
+    cerr << "smash error: timeout: invalid arguments" << endl;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Skips words at the start of a CMD line
+ * @param cmd_line - the CMD line
+ * @param count - the number of words
+ * @return
+ *      const char* - the rest of the line, from its next word
+ */
+static const char *skipWords(const char *cmd_line, int count)
+{
+  for (int i = 0; i <= count; i++)
+  {
+    while (isspace(static_cast<unsigned char>(*cmd_line)))
+    {
+      cmd_line++;
+    }
+    while (i < count && *cmd_line != '\0' && !isspace(static_cast<unsigned char>(*cmd_line)))
+    {
+      cmd_line++;
+    }
+  }
+  return cmd_line;
+}
+
+TimeoutCommand::TimeoutCommand() {}
+
+void TimeoutCommand::execute(const ParsedLine &line) const
+{
+  checkTimeoutArgs(line);
+}
+
+void TimeoutCommand::executeLine(const char *cmd_line, const char *text, const ParsedLine &line) const
+{
+  if (!checkTimeoutArgs(line))
+  {
+    return;
+  }
+  int64_t delayNs = static_cast<int64_t>(stoi(line.args[1])) * 1000000000;
+  SmallShell &shell = SmallShell::getInstance();
+  // The seconds are plain words, so the command starts after the second word; planning it
+  // replaces the plan of this line, which is not read afterwards:
+  const char *rest = skipWords(text, 2);
+  const CommandPlan *plan = shell.planCommand(rest);
+  if (plan == nullptr)
+  {
+    return;
+  }
+  shell.setTimeout(delayNs, cmd_line);
+  shell.executeCommand(cmd_line, *plan, rest);
+  shell.setTimeout(0, nullptr);
+}
+
+//-------------------------------------RunCommand-------------------------------------
+
+/*
+ * Reads the options of run into scheduling settings
+ * @param line - the parsed CMD line
+ * @param first - the first argument that may be an option
+ * @param tuning - receives the settings
+ * @return
+ *      int - the index of the first argument after the options, or -1 if an option is invalid
+ */
+static int readRunOptions(const ParsedLine &line, int first, LaunchTuning &tuning)
+{
+  int i = first;
+  while (i < line.numArgs && strncmp(line.args[i], "--", 2) == 0)
+  {
+    if (i + 1 >= line.numArgs || !parseTuningOption(line.args[i], line.args[i + 1], tuning))
+    {
+      return SYS_FAIL;
+    }
+    i += 2;
+  }
+  return i;
+}
+
+RunCommand::RunCommand() {}
+
+void RunCommand::execute(const ParsedLine &line) const
+{
+  LaunchTuning tuning = makeLaunchTuning();
+  bool isDefault = line.numArgs > 1 && strcmp(line.args[1], "--default") == 0;
+  if (!isDefault)
+  {
+    int end = readRunOptions(line, 1, tuning);
+    if (end == SYS_FAIL || end == line.numArgs)
+    {
+      cerr << "smash error: run: invalid arguments" << endl;
+    }
+    return;
+  }
+  LaunchTuning *defaults = SmallShell::getInstance().getDefaultTuning();
+  if (line.numArgs == 2)
+  {
+    string description = describeTuning(*defaults);
+    cout << "run default: " << (description.empty() ? "none" : description) << endl;
+  }
+  else if (line.numArgs == 3 && strcmp(line.args[2], "none") == 0)
+  {
+    *defaults = tuning;
+  }
+  else if (readRunOptions(line, 2, tuning) == line.numArgs)
+  {
+    *defaults = tuning;
+  }
+  else
+  {
+    cerr << "smash error: run: invalid arguments" << endl;
+  }
+}
+
+void RunCommand::executeLine(const char *cmd_line, const char *text, const ParsedLine &line) const
+{
+  LaunchTuning tuning = makeLaunchTuning();
+  int end = line.numArgs > 1 && strcmp(line.args[1], "--default") == 0 ? SYS_FAIL : readRunOptions(line, 1, tuning);
+  if (end == SYS_FAIL || end == line.numArgs)
+  {
+    execute(line);
+    return;
+  }
+  SmallShell &shell = SmallShell::getInstance();
+  // The options are plain words, so the command starts after them:
+  const char *rest = skipWords(text, end);
+  const CommandPlan *plan = shell.planCommand(rest);
+  if (plan == nullptr)
+  {
+    return;
+  }
+  shell.setTuning(&tuning);
+  shell.executeCommand(cmd_line, *plan, rest);
+  shell.setTuning(nullptr);
+}
+
+//-------------------------------------TimeCommand-------------------------------------
+
+/*
+ * Returns the monotonic time
+ * Receives no parameters
+ * @return
+ *      int64_t - the time in nanoseconds
+ */
+static int64_t monotonicNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/*
+ * Converts a time to seconds
+ * @param time - the time
+ * @return
+ *      double - the time in seconds
+ */
+static double toSeconds(const struct timeval &time)
+{
+  return time.tv_sec + time.tv_usec / 1e6;
+}
+
+/*
+ * Starts timing a built-in command the shell runs itself, if the command is timed
+ * @param timing - the timing, or nullptr
+ * @param name - the built-in command
+ * @return
+ *      void
+ */
+static void startShellStage(CommandTiming *timing, const char *name)
+{
+  if (timing == nullptr)
+  {
+    return;
+  }
+  StageTiming stage = {name, 0, monotonicNs(), 0, {}};
+  getrusage(RUSAGE_THREAD, &stage.usage);
+  timing->stages.push_back(stage);
+}
+
+/*
+ * Finishes timing the built-in command started last, if the command is timed
+ * @param timing - the timing, or nullptr
+ * @return
+ *      void
+ */
+static void finishShellStage(CommandTiming *timing)
+{
+  if (timing == nullptr)
+  {
+    return;
+  }
+  StageTiming &stage = timing->stages.back();
+  struct rusage now;
+  getrusage(RUSAGE_THREAD, &now);
+  stage.endNs = monotonicNs();
+  timersub(&now.ru_utime, &stage.usage.ru_utime, &stage.usage.ru_utime);
+  timersub(&now.ru_stime, &stage.usage.ru_stime, &stage.usage.ru_stime);
+  stage.usage.ru_maxrss = now.ru_maxrss;
+}
+
+/*
+ * Prints where the time of a timed command went
+ * @param timing - the timing of the command
+ * @param realNs - the wall time of the whole command, in nanoseconds
+ * @param shellUsage - what the shell itself used meanwhile
+ * @return
+ *      void
+ */
+static void printTiming(const CommandTiming &timing, int64_t realNs, const struct rusage &shellUsage)
+{
+  struct timeval user = shellUsage.ru_utime;
+  struct timeval sys = shellUsage.ru_stime;
+  // What the shell's own stages ran was counted with the shell, and the rest is dispatching:
+  int64_t dispatchNs = realNs - timing.parseNs - timing.launchNs - timing.waitNs;
+  for (const StageTiming &stage : timing.stages)
+  {
+    if (stage.pid != 0)
+    {
+      timeradd(&user, &stage.usage.ru_utime, &user);
+      timeradd(&sys, &stage.usage.ru_stime, &sys);
+    }
+    else if (stage.endNs != 0)
+    {
+      dispatchNs -= stage.endNs - stage.startNs;
+    }
+  }
+  ios::fmtflags flags = cerr.flags();
+  streamsize precision = cerr.precision();
+  cerr << fixed << setprecision(3);
+  cerr << "real " << realNs / 1e9 << "s user " << toSeconds(user) << "s sys " << toSeconds(sys) << "s" << endl;
+  for (size_t i = 0; i < timing.stages.size(); i++)
+  {
+    const StageTiming &stage = timing.stages[i];
+    cerr << "  [" << i + 1 << "] " << stage.name << ": ";
+    if (stage.endNs == 0)
+    {
+      cerr << "not waited for" << endl;
+      continue;
+    }
+    cerr << "real " << (stage.endNs - stage.startNs) / 1e9 << "s user " << toSeconds(stage.usage.ru_utime)
+         << "s sys " << toSeconds(stage.usage.ru_stime) << "s maxrss " << stage.usage.ru_maxrss << "KB"
+         << (stage.pid == 0 ? " (shell)" : "") << endl;
+  }
+  cerr << "  shell: parse " << timing.parseNs / 1e6 << "ms dispatch " << max<int64_t>(dispatchNs, 0) / 1e6
+       << "ms launch " << timing.launchNs / 1e6 << "ms wait " << timing.waitNs / 1e6 << "ms" << endl;
+  cerr.flags(flags);
+  cerr.precision(precision);
+}
+
+TimeCommand::TimeCommand() {}
+
+void TimeCommand::execute(const ParsedLine &line) const
+{
+  cerr << "smash error: time: invalid arguments" << endl;
+}
+
+void TimeCommand::executeLine(const char *cmd_line, const char *text, const ParsedLine &line) const
+{
+  if (line.numArgs < 2)
+  {
+    execute(line);
+    return;
+  }
+  SmallShell &shell = SmallShell::getInstance();
+  CommandTiming timing = {};
+  struct rusage before;
+  getrusage(RUSAGE_SELF, &before);
+  int64_t startNs = monotonicNs();
+  const char *rest = skipWords(text, 1);
+  const CommandPlan *plan = shell.planCommand(rest);
+  timing.parseNs = monotonicNs() - startNs;
+  if (plan == nullptr)
+  {
+    return;
+  }
+  // A built-in command runs in the shell, so it is a stage of the shell's own:
+  bool isShellStage = plan->builtin != nullptr && (plan->builtin->flags & BUILTIN_PREFIX) == 0;
+  CommandTiming *outer = shell.getTiming();
+  shell.setTiming(&timing);
+  if (isShellStage)
+  {
+    startShellStage(&timing, plan->builtin->name);
+  }
+  shell.executeCommand(cmd_line, *plan, rest);
+  if (isShellStage)
+  {
+    finishShellStage(&timing);
+  }
+  shell.setTiming(outer);
+  int64_t realNs = monotonicNs() - startNs;
+  struct rusage after;
+  getrusage(RUSAGE_SELF, &after);
+  timersub(&after.ru_utime, &before.ru_utime, &after.ru_utime);
+  timersub(&after.ru_stime, &before.ru_stime, &after.ru_stime);
+  // Jobs and stopped stages are not waited for, so they are no longer watched:
+  for (const StageTiming &stage : timing.stages)
+  {
+    if (stage.pid != 0 && stage.endNs == 0)
+    {
+      shell.getJobs()->takeExitTime(stage.pid);
+    }
+  }
+  printTiming(timing, realNs, after);
+}
+
+//-------------------------------------StatsCommand-------------------------------------
+
+StatsCommand::StatsCommand() {}
+
+void StatsCommand::execute(const ParsedLine &line) const
+{
+  SmallShell &shell = SmallShell::getInstance();
+  if (line.numArgs == 1)
+  {
+    shell.printStats();
+  }
+  else if (line.numArgs == 2 && strcmp(line.args[1], "-r") == 0)
+  {
+    shell.resetStats();
+  }
+  else
+  {
+    cerr << "smash error: stats: invalid arguments" << endl;
+  }
+}
+
+bool StatsCommand::isReadOnly(const ParsedLine &line) const
+{
+  return line.numArgs == 1;
+}
+
+//-------------------------------------ExternalCommand-------------------------------------
+
+/*
+ * Expands the wildcards of a command's arguments, if its line has any outside quotes
+ * @param stage - the command
+ * @param metaMask - the metacharacters found in the line
+ * @param words - holds the expanded arguments
+ * @param argv - holds pointers into words, NULL-terminated
+ * @return
+ *      char *const* - the arguments to run the command with
+ */
+static char *const *globArgs(const PipelineStage &stage, unsigned metaMask, vector<string> &words, vector<char *> &argv)
+{
+  if ((metaMask & META_GLOB) == 0)
+  {
+    return stage.args;
+  }
+  SmallShell::getInstance().getGlobber()->expand(stage.args, stage.quoted, words);
+  argv.reserve(words.size() + 1);
+  for (string &word : words)
+  {
+    argv.push_back(&word[0]);
+  }
+  argv.push_back(nullptr);
+  return argv.data();
+}
+
+/*
+ * Launches a program that the PATH cache found. A program that cannot be run where the cache found it
+ * (it was removed, or is no longer executable) is dropped from the cache and searched for again,
+ * and launched from where it is found now.
+ * @param spec - what to launch; its path is what PathCache::lookup returned for its first argument
+ * @param mode - the launch path
+ * @param pid - receives the PID of the process
+ * @return
+ *      int - 0, or the errno of the failure
+ */
+static int launchFromPathCache(const LaunchSpec &spec, LaunchMode mode, pid_t &pid)
+{
+  int err = launchProcess(spec, mode, pid);
+  const char *name = spec.argv[0];
+  if ((err != EACCES && err != ENOENT) || spec.path == nullptr || strchr(name, '/') != nullptr)
+  {
+    return err;
+  }
+  // The path may live in the entry that is dropped:
+  string stale = spec.path;
+  PathCache *paths = SmallShell::getInstance().getPathCache();
+  paths->forget(name);
+  const char *found = paths->lookup(name);
+  if (found == nullptr || stale == found)
+  {
+    return err;
+  }
+  LaunchSpec retry = spec;
+  retry.path = found;
+  return launchProcess(retry, mode, pid);
+}
+
+ExternalCommand::ExternalCommand(const char *cmd_line, const ParsedLine &line) : Command(cmd_line, line) {}
+
+void ExternalCommand::execute()
+{
+  SmallShell &shell = SmallShell::getInstance();
+  vector<string> words;
+  vector<char *> expanded;
+  LaunchSpec spec = makeLaunchSpec(globArgs(m_line->stages[0], m_line->metaMask, words, expanded));
+  // Names that are not in PATH fail here, without launching anything:
+  spec.path = shell.getPathCache()->lookup(spec.argv[0]);
+  if (spec.path == nullptr)
+  {
+    errno = ENOENT;
+    perror("smash error: execvp failed");
+    return;
+  }
+  const PipelineStage &stage = m_line->stages[0];
+  JobsList *jobs = shell.getJobs();
+  // Past the limit of running jobs, the command waits in the queue with what it needs to start:
+  LaunchTuning tuning;
+  spec.tuning = shell.getTuning(m_line->isBackground, tuning);
+  string settings = spec.tuning != nullptr ? describeTuning(*spec.tuning) : "";
+  if (m_line->isBackground && jobs->isFull())
+  {
+    jobs->queueJob(m_cmd_line, make_unique<QueuedCommand>(spec.argv, spec.path, stage, spec.tuning), settings.c_str());
+    return;
+  }
+  Redirector redirector;
+  if (!redirector.open(stage.redirections, stage.numRedirections, shell.getHereDocuments()))
+  {
+    return;
+  }
+  spec.fdActions = redirector.actions();
+  spec.numFdActions = redirector.numActions();
+  pid_t pid;
+  int err = shell.launch(spec, pid);
+  if (err != 0)
+  {
+    errno = err;
+    perror("smash error: execvp failed");
+    return;
+  }
+  shell.startTimeout(pid);
+  // Opened before the child can be reaped, so it is bound to this child:
+  int pidfd = openProcessFd(pid);
+  if (m_line->isBackground)
+  {
+    jobs->addJob(m_cmd_line, pid, pidfd, false, settings.c_str());
+    return;
+  }
+  shell.waitForeground(pid, pidfd);
+}
+
+//-------------------------------------QueuedCommand-------------------------------------
+
+QueuedCommand::QueuedCommand(char *const *argv, const char *path, const PipelineStage &stage,
+                             const LaunchTuning *tuning)
+    : m_path(path), m_targets(stage.numRedirections),
+      m_redirections(stage.redirections, stage.redirections + stage.numRedirections),
+      m_tuning(tuning != nullptr ? *tuning : makeLaunchTuning())
+{
+  SmallShell &shell = SmallShell::getInstance();
+  for (int i = 0; argv[i] != nullptr; i++)
+  {
+    m_words.push_back(argv[i]);
+  }
+  for (string &word : m_words)
+  {
+    m_argv.push_back(&word[0]);
+  }
+  m_argv.push_back(nullptr);
+  // The targets point into the parsed line, which the next line replaces:
+  for (size_t i = 0; i < m_redirections.size(); i++)
+  {
+    if (m_redirections[i].target != nullptr)
+    {
+      m_targets[i] = m_redirections[i].target;
+      m_redirections[i].target = m_targets[i].c_str();
+    }
+  }
+  m_hereDocuments = shell.takeHereDocuments();
+  m_launchMode = shell.getLaunchMode();
+  m_timeoutNs = shell.takeTimeout(m_timeoutLine);
+}
+
+QueuedCommand::~QueuedCommand()
+{
+  for (int fd : m_hereDocuments)
+  {
+    if (fd != SYS_FAIL)
+    {
+      close(fd);
+    }
+  }
+}
+
+pid_t QueuedCommand::start()
+{
+  LaunchSpec spec = makeLaunchSpec(m_argv.data());
+  spec.path = m_path.c_str();
+  spec.tuning = isTuned(m_tuning) ? &m_tuning : nullptr;
+  Redirector redirector;
+  if (!redirector.open(m_redirections.data(), static_cast<int>(m_redirections.size()), m_hereDocuments.data()))
+  {
+    return SYS_FAIL;
+  }
+  spec.fdActions = redirector.actions();
+  spec.numFdActions = redirector.numActions();
+  pid_t pid;
+  int err = launchFromPathCache(spec, m_launchMode, pid);
+  if (err != 0)
+  {
+    errno = err;
+    perror("smash error: execvp failed");
+    return SYS_FAIL;
+  }
+  if (m_timeoutNs != 0)
+  {
+    SmallShell::getInstance().getTimeouts()->add(pid, m_timeoutNs, m_timeoutLine.c_str());
+  }
+  return pid;
+}
+
+//-------------------------------------Special Commands-------------------------------------
+//-------------------------------------Redirection Command-------------------------------------
+
+RedirectionCommand::RedirectionCommand(const char *cmd_line, const ParsedLine &line, const BuiltinEntry *builtin)
+    : Command(cmd_line, line), m_builtin(builtin) {}
+
+void RedirectionCommand::execute()
+{
+  const PipelineStage &stage = m_line->stages[0];
+  Redirector redirector;
+  if (!redirector.open(stage.redirections, stage.numRedirections, SmallShell::getInstance().getHereDocuments()) ||
+      m_builtin == nullptr)
+  {
+    return;
+  }
+  // The built-in command runs in the shell, so what it changes (the directory, the prompt) is kept:
+  if (!redirector.applyToShell())
+  {
+    return;
+  }
+  SmallShell::getInstance().runBuiltin(m_builtin, *m_line);
+  redirector.restoreShell();
+  if (m_builtin->flags & BUILTIN_EXITS_SHELL)
+  {
+    exit(0);
+  }
+}
+
+//--------------------------------------------------------Pipe----------------------------------------------------------
+
+PipeCommand::PipeCommand(const char *cmd_line, const ParsedLine &line) : Command(cmd_line, line) {}
+
+/*
+ *  PipelineRelay Struct:
+ *  A relay between the stages of a pipeline, and the stages it serves.
+ *  relay: The relay
+ *  producer: The stage it reads from
+ *  consumer: The stage it writes to (the tee itself if the tee is the last stage)
+ *  tee: The tee stage the relay runs, or -1 if it only connects two stages
+ */
+struct PipelineRelay
+{
+  shared_ptr<Relay> relay;
+  int producer;
+  int consumer;
+  int tee;
+};
+
+/*
+ * Checks whether a pipeline stage is a tee the shell can run itself, one that takes no option but "-a"
+ * @param args - the arguments of the stage
+ * @return
+ *      bool - whether the stage is such a tee
+ */
+static bool isShellTee(char *const *args)
+{
+  if (strcmp(args[0], "tee") != 0)
+  {
+    return false;
+  }
+  for (int i = 1; args[i] != nullptr; i++)
+  {
+    if (args[i][0] == '-' && strcmp(args[i], "-a") != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Prints, for every stage of a relayed pipeline, the bytes it wrote and how long the relays waited on it,
+ * either for its output or for room in its input
+ * @param stages - the stages of the pipeline
+ * @param numStages - the number of stages
+ * @param relays - the relays of the pipeline, joined
+ * @return
+ *      void
+ */
+static void printPipelineStats(const PipelineStage *stages, int numStages, const vector<PipelineRelay> &relays)
+{
+  vector<long long> bytesOut(numStages, SYS_FAIL);
+  vector<int64_t> stallNs(numStages, 0);
+  for (const PipelineRelay &link : relays)
+  {
+    const RelayStats &stats = link.relay->stats();
+    bytesOut[link.producer] = stats.bytes;
+    stallNs[link.producer] += stats.inputWaitNs;
+    stallNs[link.consumer] += stats.outputWaitNs;
+    if (link.tee != SYS_FAIL)
+    {
+      bytesOut[link.tee] = stats.bytes;
+    }
+  }
+  cerr << "stage  bytes out  stall ms  command" << endl;
+  for (int i = 0; i < numStages; i++)
+  {
+    string command;
+    for (int k = 0; k < stages[i].numArgs; k++)
+    {
+      command += (k ? " " : "") + string(stages[i].args[k]);
+    }
+    int64_t tenths = stallNs[i] / 100000;
+    cerr << setw(5) << i + 1 << setw(11) << (bytesOut[i] == SYS_FAIL ? "-" : to_string(bytesOut[i])) << setw(8)
+         << tenths / 10 << "." << tenths % 10 << "  " << command << endl;
+  }
+}
+
+/*
+ * Runs a built-in pipeline stage in the shell, with no process of its own. The output of a stage
+ * that is not the last (and its errors, after "|&") is caught in a memfd while it runs, since the
+ * next stage may not have started yet, and is then moved into the pipe: at once if the pipe has
+ * room for it, otherwise by a relay that is started with the others.
+ * Only a built-in command that leaves the shell's state as it is runs: pwd, showpid, dirs, jobs,
+ * chmod, which changes nothing but a file, and plancache, hash, pipes and stats without arguments.
+ * One that would change the state (cd, pushd, kill, jobs --max, quit, ...) would do so from a
+ * stage, which a program run in a child cannot, so it is refused, and the next stage reads
+ * nothing from it.
+ * @param line - the parsed CMD line
+ * @param index - the index of the stage
+ * @param builtin - the built-in command of the stage
+ * @param output - the write end of the pipe to the next stage, taken over; -1 for the last stage
+ * @return
+ *      shared_ptr<Relay> - the relay that moves the rest of the output, or nullptr if none is needed
+ */
+static shared_ptr<Relay> runBuiltinStage(const ParsedLine &line, int index, const BuiltinEntry *builtin, int output)
+{
+  const PipelineStage &stage = line.stages[index];
+  ParsedLine stageLine = line;
+  stageLine.args = stage.args;
+  stageLine.numArgs = stage.numArgs;
+  stageLine.stages = line.stages + index;
+  stageLine.numStages = 1;
+  if (!builtin->command->isReadOnly(stageLine))
+  {
+    cerr << "smash error: " << builtin->name << ": cannot run in a pipeline" << endl;
+    if (output != SYS_FAIL)
+    {
+      close(output);
+    }
+    return nullptr;
+  }
+  int capture = SYS_FAIL;
+  if (output != SYS_FAIL)
+  {
+    capture = createMemoryFile("smash-builtin-output");
+    if (capture == SYS_FAIL)
+    {
+      close(output);
+      return nullptr;
+    }
+  }
+  {
+    Redirector redirector;
+    if (capture != SYS_FAIL)
+    {
+      redirector.addAction(capture, STDOUT_FILENO);
+      if (stage.pipeStderr)
       {
-        perror("smash error: open failed");
-        deleteArgs(args);
-        return;
+        redirector.addAction(capture, STDERR_FILENO);
       }
+    }
+    if (redirector.open(stage.redirections, stage.numRedirections, SmallShell::getInstance().getHereDocuments()) &&
+        redirector.applyToShell())
+    {
+      SmallShell::getInstance().runBuiltin(builtin, stageLine);
+    }
+  }
+  if (capture == SYS_FAIL)
+  {
+    return nullptr;
+  }
+  lseek(capture, 0, SEEK_SET);
+  while (true)
+  {
+    ssize_t moved = splice(capture, nullptr, output, nullptr, RELAY_MAX_CHUNK, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (moved == 0)
+    {
+      close(capture);
+      close(output);
+      return nullptr;
+    }
+    if (moved == SYS_FAIL && errno != EINTR)
+    {
+      // The pipe is full (or does not take splice); the relay moves the rest once the next stage runs:
+      return make_shared<Relay>(capture, output, true);
+    }
+  }
+}
+
+void PipeCommand::execute()
+{
+  SmallShell &shell = SmallShell::getInstance();
+  const PipeOptions &options = *shell.getPipeOptions();
+  const PipelineStage *stages = m_line->stages;
+  int numStages = m_line->numStages;
+  vector<pid_t> pids;
+  pids.reserve(numStages);
+  vector<PipelineRelay> relays;
+  LaunchTuning tuning;
+  const LaunchTuning *stageTuning = shell.getTuning(m_line->isBackground, tuning);
+  // Every stage is started before any is waited for, all in the process group of the first one:
+  pid_t group = 0;
+  int input = SYS_FAIL;
+  for (int i = 0; i < numStages; i++)
+  {
+    int my_pipe[2] = {SYS_FAIL, SYS_FAIL};
+    bool isLast = i == numStages - 1;
+    if (!isLast && makePipe(my_pipe, options.size) == SYS_FAIL)
+    {
+      perror("smash error: pipe failed");
       break;
     }
-    else if (over != nullptr && strcmp(">", args[i]) == 0)
+    vector<string> words;
+    vector<char *> expanded;
+    char *const *argv = globArgs(stages[i], m_line->metaMask, words, expanded);
+    if (i > 0 && stages[i].numRedirections == 0 && isShellTee(stages[i].args))
     {
-      *over = '\0';
-      if (close(1) == SYS_FAIL)
+      // The shell copies the stream into the files itself, and passes it on:
+      int output = isLast ? STDOUT_FILENO : my_pipe[1];
+      shared_ptr<Relay> relay = make_shared<Relay>(input, output, !isLast);
+      bool isAppend = false;
+      for (int k = 1; argv[k] != nullptr; k++)
       {
-        perror("smash error: close failed");
-        deleteArgs(args);
-        return;
+        isAppend = isAppend || strcmp(argv[k], "-a") == 0;
       }
-      if (open(args[i + 1], O_WRONLY | O_CREAT | O_TRUNC, 0777) == SYS_FAIL)
+      for (int k = 1; argv[k] != nullptr; k++)
       {
-        perror("smash error: open failed");
-        deleteArgs(args);
-        return;
+        if (strcmp(argv[k], "-a") == 0)
+        {
+          continue;
+        }
+        int fd = open(argv[k], O_WRONLY | O_CREAT | O_CLOEXEC | (isAppend ? O_APPEND : O_TRUNC), 0666);
+        if (fd == SYS_FAIL)
+        {
+          perror("smash error: open failed");
+        }
+        else
+        {
+          relay->addCopy(fd);
+        }
       }
-      break;
+      relays.push_back({relay, i - 1, isLast ? i : i + 1, i});
+      input = my_pipe[0];
+      continue;
+    }
+
+    const BuiltinEntry *builtin = findBuiltin(stages[i].args[0]);
+    if (builtin != nullptr && (builtin->flags & BUILTIN_PREFIX) == 0)
+    {
+      // The shell runs the built-in command itself and writes its output into the pipe:
+      startShellStage(shell.getTiming(), builtin->name);
+      shared_ptr<Relay> rest = runBuiltinStage(*m_line, i, builtin, my_pipe[1]);
+      finishShellStage(shell.getTiming());
+      my_pipe[1] = SYS_FAIL;
+      if (rest != nullptr)
+      {
+        relays.push_back({rest, i, i + 1, SYS_FAIL});
+      }
+    }
+    else
+    {
+      LaunchSpec spec = makeLaunchSpec(argv);
+      spec.tuning = stageTuning;
+      spec.stdinFd = input;
+      if (!isLast && stages[i].pipeStderr)
+      {
+        spec.stderrFd = my_pipe[1];
+      }
+      else if (!isLast)
+      {
+        spec.stdoutFd = my_pipe[1];
+      }
+      spec.processGroup = group;
+      spec.path = shell.getPathCache()->lookup(spec.argv[0]);
+      // A stage whose redirection fails does not run; the failure was printed:
+      Redirector redirector;
+      pid_t pid = 0;
+      int err = spec.path == nullptr ? ENOENT : 0;
+      bool isRedirected = err == 0 && redirector.open(stages[i].redirections, stages[i].numRedirections,
+                                                      shell.getHereDocuments());
+      if (isRedirected)
+      {
+        spec.fdActions = redirector.actions();
+        spec.numFdActions = redirector.numActions();
+        err = shell.launch(spec, pid);
+      }
+      if (err != 0)
+      {
+        errno = err;
+        perror("smash error: evecvp failed");
+      }
+      else if (isRedirected)
+      {
+        pids.push_back(pid);
+        group = group == 0 ? pid : group;
+      }
+    }
+    // Once a stage started, the shell keeps no end of its pipes, so its neighbours see EOF and EPIPE:
+    if (input != SYS_FAIL)
+    {
+      close(input);
+    }
+    if (my_pipe[1] != SYS_FAIL)
+    {
+      close(my_pipe[1]);
+    }
+    input = my_pipe[0];
+
+    int relayed[2];
+    if (options.relay && !isLast && !isShellTee(stages[i + 1].args) && makePipe(relayed, options.size) != SYS_FAIL)
+    {
+      relays.push_back({make_shared<Relay>(input, relayed[1], true), i, i + 1, SYS_FAIL});
+      input = relayed[0];
     }
   }
-  smash.executeCommand(cmd);
-  deleteArgs(args);
-  return;
-}
-
-//--------------------------------------------------------Pipe----------------------------------------------------------
-
-PipeCommand::PipeCommand(const char *cmd_line) : Command(cmd_line) {}
-
-void PipeCommand::execute()
-{
-  string str1 = string(this->m_cmd_line);
-  int pipeIndex = str1.find('|');
-  int isAmpersand = 0;
-  if (str1.find('&') != string::npos)
+  if (input != SYS_FAIL)
+  {
+    close(input);
+  }
+  if (!pids.empty())
   {
-    isAmpersand = 1;
+    shell.startTimeout(group);
   }
-  string first = str1.substr(0, pipeIndex + isAmpersand);
-  string sec = str1.substr(pipeIndex + isAmpersand + 1);
-  int numArgs1;
-  char **args1 = getArgs(first.c_str(), &numArgs1);
-  int numArgs2;
-  char **args2 = getArgs(sec.c_str(), &numArgs2);
-  int my_pipe[2];
-  pipe(my_pipe);
-  if (fork() == 0) // Child
+  // Relays start once every process is launched, so no thread runs while the shell forks:
+  for (const PipelineRelay &link : relays)
   {
-    if (setpgrp() == SYS_FAIL)
+    int err = link.relay->start();
+    if (err != 0)
     {
-      perror("smash error: setpgrp failed");
-      return;
+      errno = err;
+      perror("smash error: pthread_create failed");
     }
-    if (!isAmpersand)
+  }
+
+  int status = 0;
+  if (!pids.empty())
+  {
+    status = shell.waitForeground(pids.back(), openProcessFd(pids.back()));
+    // If the last stage was killed, the others would otherwise keep the shell waiting:
+    if (status != SYS_FAIL && WIFSIGNALED(status))
     {
-      if (dup2(my_pipe[1], STDOUT_FILENO) == -1)
-      {
-        deleteArgs(args1);
-        deleteArgs(args2);
-        perror("smash error: dup2 failed");
-        exit(0);
-      }
+      killpg(group, WTERMSIG(status));
     }
-    else
+    if (status == SYS_FAIL || !WIFSTOPPED(status))
     {
-      if (dup2(my_pipe[1], 2) == -1)
+      for (size_t i = 0; i + 1 < pids.size(); i++)
       {
-        deleteArgs(args1);
-        deleteArgs(args2);
-        perror("smash error: dup2 failed");
-        exit(0);
+        shell.waitStage(pids[i]);
       }
     }
-    close(my_pipe[0]);
-    close(my_pipe[1]);
-    string command = string(args1[0]);
-    if (execvp(command.c_str(), args1) == SYS_FAIL)
-    {
-      perror("smash error: evecvp failed");
-      deleteArgs(args1);
-      deleteArgs(args2);
-      exit(0);
-    }
   }
-  else
+  // The relays of a stopped pipeline finish whenever it does:
+  bool isStopped = status != SYS_FAIL && WIFSTOPPED(status);
+  for (const PipelineRelay &link : relays)
   {
-    if (dup2(my_pipe[0], STDIN_FILENO) == SYS_FAIL)
+    if (isStopped)
     {
-      perror("smash error: dup2 failed");
-      exit(0);
+      link.relay->detach();
     }
-    close(my_pipe[0]);
-    close(my_pipe[1]);
-    string command = string(args2[0]);
-    if (execvp(command.c_str(), args2) == SYS_FAIL)
+    else
     {
-      perror("smash error: evecvp failed");
-      deleteArgs(args1);
-      deleteArgs(args2);
-      exit(0);
+      link.relay->join();
     }
   }
+  if (options.relay && !isStopped)
+  {
+    printPipelineStats(stages, numStages, relays);
+  }
 }
 
 //------------------------------------------------Chmod----------------------------------------------------------------
 
-ChmodCommand::ChmodCommand(const char *cmd_line) : BuiltInCommand(cmd_line) {}
+ChmodCommand::ChmodCommand() {}
 
-void ChmodCommand::execute()
+void ChmodCommand::execute(const ParsedLine &line) const
 {
   int permissionsNum;
-  int numArgs;
-  char **args = getArgs(this->m_cmd_line, &numArgs);
+  int numArgs = line.numArgs;
+  char **args = line.args;
   if (numArgs != 3)
   {
     cerr << "smash error: chmod: invalid arguments" << endl;
-    deleteArgs(args);
     return;
   }
   if (!is_number(args[1]))
   {
     cerr << "smash error: chmod: invalid arguments" << endl;
-    deleteArgs(args);
     return;
   }
   try
@@ -834,266 +1700,598 @@ void ChmodCommand::execute()
   }
   if (chmod(args[2], permissionsNum) == SYS_FAIL)
   {
-    deleteArgs(args);
     perror("smash error: chmod failed");
     return;
   }
-  deleteArgs(args);
 }
 
-//-------------------------------------SmallShell-------------------------------------
+bool ChmodCommand::isReadOnly(const ParsedLine &line) const
+{
+  return true;
+}
 
-pid_t SmallShell::m_pid = getpid();
+//-------------------------------------Built-In Registry-------------------------------------
+
+#define BUILTIN_INSTANCE(name, cls, flags) static const cls cls##Instance;
+SMASH_BUILTINS(BUILTIN_INSTANCE)
+#undef BUILTIN_INSTANCE
 
-SmallShell::SmallShell(std::string prompt) : m_pid_fg(0), m_prompt(prompt)
+#define BUILTIN_ENTRY(name, cls, flags) {name, &cls##Instance, flags},
+static constexpr BuiltinEntry builtins[] = {SMASH_BUILTINS(BUILTIN_ENTRY)};
+#undef BUILTIN_ENTRY
+
+static_assert(sizeof(builtins) / sizeof(builtins[0]) == NUM_BUILTINS, "the built-in count is out of date");
+static constexpr unsigned BUILTIN_TABLE_SIZE = 64;
+static_assert((BUILTIN_TABLE_SIZE & (BUILTIN_TABLE_SIZE - 1)) == 0, "the built-in table size must be a power of two");
+static_assert(NUM_BUILTINS * 2 <= (int)BUILTIN_TABLE_SIZE, "too many built-in commands for the built-in table");
+
+/*
+ * Hashes the name of a built-in command into a slot of the built-in table (seeded FNV-1a)
+ * @param name - the name
+ * @param seed - the seed of the hash
+ * @return
+ *      unsigned - the slot
+ */
+static constexpr unsigned builtinHash(const char *name, unsigned seed)
 {
-  m_prevDir = (char *)malloc((MAX_PATH_LENGTH + 1) * sizeof(char));
-  if (m_prevDir == nullptr)
-  {
-    free(m_prevDir);
-    cerr << "smash error: malloc failed" << endl;
-    return;
-  }
-  strcpy(m_prevDir, "");
-  m_currDir = (char *)malloc((MAX_PATH_LENGTH + 1) * sizeof(char));
-  if (m_currDir == nullptr)
+  unsigned hash = seed;
+  for (; *name; name++)
   {
-    free(m_currDir);
-    cerr << "smash error: malloc failed" << endl;
-    return;
+    hash = (hash ^ (unsigned char)*name) * 16777619u;
   }
-  strcpy(m_currDir, "");
+  return hash & (BUILTIN_TABLE_SIZE - 1);
 }
 
-SmallShell::~SmallShell()
+/*
+ *  BuiltinTable Struct:
+ *  A perfect hash table over the registered built-in commands.
+ *  seed: The seed for which no two built-in commands share a slot
+ *  slots: The index of the built-in command in each slot, -1 for empty slots
+ */
+struct BuiltinTable
+{
+  unsigned seed;
+  signed char slots[BUILTIN_TABLE_SIZE];
+};
+
+/*
+ * Searches for a seed that hashes every registered built-in command into its own slot
+ * Receives no parameters
+ * @return
+ *      BuiltinTable - the perfect hash table
+ */
+static constexpr BuiltinTable makeBuiltinTable()
 {
-  free(m_prevDir);
-  free(m_currDir);
+  for (unsigned seed = 2166136261u;; seed++)
+  {
+    BuiltinTable table = {seed, {}};
+    for (unsigned i = 0; i < BUILTIN_TABLE_SIZE; i++)
+    {
+      table.slots[i] = -1;
+    }
+    bool perfect = true;
+    for (int i = 0; i < NUM_BUILTINS && perfect; i++)
+    {
+      unsigned slot = builtinHash(builtins[i].name, seed);
+      perfect = table.slots[slot] == -1;
+      table.slots[slot] = i;
+    }
+    if (perfect)
+    {
+      return table;
+    }
+  }
 }
 
-Command *SmallShell::CreateCommand(const char *cmd_line)
+static constexpr BuiltinTable builtinTable = makeBuiltinTable();
+
+const BuiltinEntry *findBuiltin(const char *name)
 {
-  if (string(cmd_line).empty())
+  int index = builtinTable.slots[builtinHash(name, builtinTable.seed)];
+  if (index < 0 || strcmp(builtins[index].name, name) != 0)
   {
     return nullptr;
   }
-  // Check if command is an IO redirection:
-  SmallShell &shell = SmallShell::getInstance();
-  if (strstr(cmd_line, ">") != nullptr || strstr(cmd_line, ">>") != nullptr)
+  return &builtins[index];
+}
+
+int builtinIndex(const BuiltinEntry *builtin)
+{
+  return static_cast<int>(builtin - builtins);
+}
+
+//-------------------------------------SmallShell-------------------------------------
+
+pid_t SmallShell::m_pid = getpid();
+
+SmallShell::SmallShell(std::string prompt) : m_pid_fg(0), m_pidfd_fg(SYS_FAIL), m_prompt(prompt), m_arena(m_arenaBuffer, LINE_ARENA_SIZE),
+                                              m_launchMode(defaultLaunchMode()), m_pipeOptions(), m_timeouts(jobs), m_timeoutNs(0),
+                                              m_timeoutLine(nullptr), m_tuning(nullptr), m_defaultTuning(makeLaunchTuning()),
+                                              m_timing(nullptr), m_dispatchStartNs(0), m_firstLaunchNs(0),
+                                              m_signalSentNs(0) {}
+
+SmallShell::~SmallShell() {}
+
+const CommandPlan *SmallShell::planCommand(const char *cmd_line)
+{
+  int64_t startNs = monotonicNs();
+  const CommandPlan *plan = m_plans.lookup(cmd_line);
+  if (plan == nullptr)
   {
-    int stat = 0;
-    pid_t pid = fork();
-    if (pid < 0)
+    m_arena.reset();
+    if (!parseCommandLine(cmd_line, m_arena, m_parsed.line))
     {
-      perror("smash error: fork failed");
+      cerr << "smash error: malloc failed" << endl;
       return nullptr;
     }
-    else if (pid > 0)
+    classifyCommand(m_parsed);
+    if (m_parsed.kind != CMD_EMPTY)
     {
-      shell.m_pid_fg = pid;
-      pid = waitpid(pid, &stat, WUNTRACED);
-      if (pid == SYS_FAIL)
-      {
-        perror("smash error: waitpid failed");
-        return nullptr;
-      }
-      shell.m_pid_fg = 0;
-      return nullptr;
+      m_plans.insert(cmd_line, m_parsed);
     }
-    else
+    plan = &m_parsed;
+  }
+  m_phaseStats[STATS_PARSE].record(monotonicNs() - startNs);
+  return plan;
+}
+
+void SmallShell::classifyCommand(CommandPlan &plan)
+{
+  const ParsedLine &line = plan.line;
+  plan.builtin = nullptr;
+  const BuiltinEntry *first = line.numArgs > 0 ? findBuiltin(line.args[0]) : nullptr;
+  if (first != nullptr && (first->flags & BUILTIN_PREFIX))
+  {
+    // It runs the rest of the line itself, pipes and redirections included:
+    plan.kind = CMD_BUILTIN;
+    plan.builtin = first;
+  }
+  else if (line.numStages > 1)
+  {
+    plan.kind = CMD_PIPE;
+    for (int i = 0; i < line.numStages; i++)
     {
-      if (setpgrp() == SYS_FAIL)
+      if (line.stages[i].numArgs == 0)
       {
-        perror("smash error: setpgrp failed");
-        return nullptr;
+        plan.kind = CMD_EMPTY;
       }
-      return new RedirectionCommand(cmd_line);
     }
   }
-  // Removes background sign (if exists):
-  char cmd[COMMAND_ARGS_MAX_LENGTH];
-  strcpy(cmd, cmd_line);
-  _removeBackgroundSign(cmd);
-  const char *cmd_line_clean = cmd;
-  // Compare command without background sign:
-  string cmd_s = _trim(string(cmd_line_clean));
-  string firstWord = cmd_s.substr(0, cmd_s.find_first_of(" \n"));
-  // Find appropriate command:
-  if (strchr(cmd, '|'))
+  else if (line.numArgs == 0)
   {
-    pid_t pid = fork();
-    if (pid < 0)
-    {
-      perror("smash error: fork failed");
-      return nullptr;
-    }
-    else if (pid > 0)
+    // Redirections alone still create (or truncate) their files:
+    plan.kind = line.stages[0].numRedirections > 0 ? CMD_REDIRECTION : CMD_EMPTY;
+  }
+  else
+  {
+    plan.builtin = findBuiltin(line.args[0]);
+    if (plan.builtin == nullptr)
     {
-      int status;
-      shell.m_pid_fg = pid;
-      pid = waitpid(pid, &status, WUNTRACED);
-      if (pid == SYS_FAIL)
-      {
-        perror("smash error: waitpid failed");
-        return nullptr;
-      }
-      shell.m_pid_fg = 0;
-      return nullptr;
+      plan.kind = CMD_EXTERNAL;
     }
+
     else
     {
-      if (setpgrp() == SYS_FAIL)
-      {
-        perror("smash error: setpgrp failed");
-        return nullptr;
-      }
-      return new PipeCommand(cmd_line);
+      plan.kind = line.stages[0].numRedirections > 0 ? CMD_REDIRECTION : CMD_BUILTIN;
     }
   }
-  if (firstWord.compare("pwd") == 0)
+}
+
+Command *SmallShell::CreateCommand(const char *cmd_line)
+{
+  const CommandPlan *plan = planCommand(cmd_line);
+  if (plan == nullptr)
   {
-    return new GetCurrDirCommand(cmd_line);
+    return nullptr;
+  }
+  return CreateCommand(cmd_line, *plan);
+}
+
+Command *SmallShell::CreateCommand(const char *cmd_line, const CommandPlan &plan)
+{
+  const ParsedLine &line = plan.line;
+  // The commands below run in the shell and launch their programs through the launch engine:
+  switch (plan.kind)
+  {
+  case CMD_REDIRECTION:
+    return new RedirectionCommand(cmd_line, line, plan.builtin);
+  case CMD_PIPE:
+    return new PipeCommand(cmd_line, line);
+  case CMD_EXTERNAL:
+    return new ExternalCommand(cmd_line, line);
+  default:
+    return nullptr;
   }
-  else if (firstWord.compare("showpid") == 0)
+}
+
+JobsList *SmallShell::getJobs()
+{
+  return &jobs;
+}
+
+PlanCache *SmallShell::getPlans()
+{
+  return &m_plans;
+}
+
+PathCache *SmallShell::getPathCache()
+{
+  return &m_pathCache;
+}
+
+GlobExpander *SmallShell::getGlobber()
+{
+  return &m_globber;
+}
+
+WorkingDir *SmallShell::getWorkingDir()
+{
+  return &m_workingDir;
+}
+
+PipeOptions *SmallShell::getPipeOptions()
+{
+  return &m_pipeOptions;
+}
+
+const int *SmallShell::getHereDocuments() const
+{
+  return m_hereDocuments.data();
+}
+
+vector<int> SmallShell::takeHereDocuments()
+{
+  vector<int> hereDocuments;
+  hereDocuments.swap(m_hereDocuments);
+  return hereDocuments;
+}
+
+void SmallShell::readHereDocuments(const ParsedLine &line)
+{
+  m_hereDocuments.assign(line.numHereDocuments, SYS_FAIL);
+  for (int i = 0; i < line.numStages; i++)
   {
-    return new ShowPidCommand(cmd_line);
+    for (int r = 0; r < line.stages[i].numRedirections; r++)
+    {
+      const Redirection &redirection = line.stages[i].redirections[r];
+      if (redirection.hereIndex == SYS_FAIL || redirection.target == nullptr)
+      {
+        continue;
+      }
+      m_hereDocuments[redirection.hereIndex] = redirection.type == REDIRECT_HEREDOC
+                                                   ? readHereDocument(cin, redirection.target)
+                                                   : makeHereString(redirection.target);
+    }
   }
-  else if (firstWord.compare("chprompt") == 0)
+}
+
+void SmallShell::closeHereDocuments()
+{
+  for (int fd : m_hereDocuments)
   {
-    return new ChangePromptCommand(cmd_line);
+    if (fd != SYS_FAIL)
+    {
+      close(fd);
+    }
   }
-  else if (firstWord.compare("cd") == 0)
+  m_hereDocuments.clear();
+}
+
+LaunchMode SmallShell::getLaunchMode() const
+{
+  return m_launchMode;
+}
+
+int SmallShell::launch(const LaunchSpec &spec, pid_t &pid)
+{
+  int64_t startNs = monotonicNs();
+  dispatched(startNs);
+  int err = launchFromPathCache(spec, m_launchMode, pid);
+  if (err != 0)
   {
-    return new ChangeDirCommand(cmd_line, &m_prevDir);
+    return err;
   }
-  else if (firstWord.compare("jobs") == 0)
+  int64_t launchedNs = monotonicNs();
+  m_phaseStats[STATS_LAUNCH].record(launchedNs - startNs);
+  if (m_firstLaunchNs == 0)
   {
-    return new JobsCommand(cmd_line);
+    m_firstLaunchNs = launchedNs;
   }
-  else if (firstWord.compare("quit") == 0)
+  if (m_timing == nullptr)
   {
-    return new QuitCommand(cmd_line, &jobs);
+    return 0;
   }
-  else if (firstWord.compare("fg") == 0)
+  m_timing->launchNs += launchedNs - startNs;
+  m_timing->stages.push_back({spec.argv[0], pid, startNs, 0, {}});
+  // Watched from the start, so a stage that is reaped after another one is still timed to its end:
+  jobs.watchExit(pid, openProcessFd(pid));
+  return 0;
+}
+
+int SmallShell::waitForeground(pid_t pid, int pidfd)
+{
+  int64_t startNs = monotonicNs();
+  if (m_firstLaunchNs != 0)
   {
-    return new ForegroundCommand(cmd_line, &jobs);
+    m_phaseStats[STATS_FIRST_WAIT].record(startNs - m_firstLaunchNs);
+    m_firstLaunchNs = 0;
   }
-  else if (firstWord.compare("kill") == 0)
+  m_signalSentNs = 0;
+  m_pidfd_fg = pidfd;
+  m_pid_fg = pid;
+  struct rusage usage = {};
+  int status = jobs.waitForChild(pid, pidfd, &usage);
+  int64_t endNs = monotonicNs();
+  m_pid_fg = 0;
+  m_pidfd_fg = SYS_FAIL;
+  if (pidfd != SYS_FAIL)
   {
-    return new KillCommand(cmd_line, &jobs);
+    close(pidfd);
   }
-  else if (firstWord.compare("chmod") == 0)
+  if (m_signalSentNs != 0 && status != SYS_FAIL && (WIFSIGNALED(status) || WIFSTOPPED(status)))
   {
-    return new ChmodCommand(cmd_line);
+    m_phaseStats[STATS_SIGNAL].record(endNs - m_signalSentNs);
   }
-  else
+  if (m_timing != nullptr)
   {
-    bool isBackground = _isBackgroundComamnd(cmd_line);
-    int stat = 0;
-    pid_t pid = fork();
-    if (pid < 0)
+    m_timing->waitNs += endNs - startNs;
+    if (status != SYS_FAIL && !WIFSTOPPED(status))
     {
-      perror("smash error: fork failed");
-      return nullptr;
+      finishTiming(pid, usage);
     }
-    if (pid > 0 && !isBackground)
+  }
+  return status;
+}
+
+void SmallShell::waitStage(pid_t pid)
+{
+  int64_t startNs = m_timing != nullptr ? monotonicNs() : 0;
+  struct rusage usage = {};
+  pid_t reaped = wait4(pid, nullptr, 0, &usage);
+  if (m_timing != nullptr)
+  {
+    m_timing->waitNs += monotonicNs() - startNs;
+    if (reaped == pid)
     {
-      shell.m_pid_fg = pid;
-      pid = waitpid(pid, &stat, WUNTRACED);
-      if (pid == SYS_FAIL)
-      {
-        perror("smash error: waitpid failed");
-        return nullptr;
-      }
-      shell.m_pid_fg = 0;
-      return nullptr;
+      finishTiming(pid, usage);
     }
-    if (pid == 0)
+  }
+}
+
+void SmallShell::runBuiltin(const BuiltinEntry *builtin, const ParsedLine &line)
+{
+  int64_t startNs = monotonicNs();
+  dispatched(startNs);
+  builtin->command->execute(line);
+  m_builtinStats[builtinIndex(builtin)].record(monotonicNs() - startNs);
+}
+
+void SmallShell::markSignalSent()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  m_signalSentNs = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/*
+ * Formats a latency with three significant digits and its unit
+ * @param ns - the latency, in nanoseconds
+ * @return
+ *      string - the latency
+ */
+static string formatLatency(uint64_t ns)
+{
+  static const char *const units[] = {"ns", "us", "ms", "s"};
+  double value = static_cast<double>(ns);
+  int unit = 0;
+  while (value >= 1000 && unit < 3)
+  {
+    value /= 1000;
+    unit++;
+  }
+  ostringstream text;
+  text << fixed << setprecision(unit == 0 || value >= 100 ? 0 : value >= 10 ? 1 : 2) << value << units[unit];
+  return text.str();
+}
+
+/*
+ * Prints a row of the latency statistics
+ * @param name - the phase or the built-in command
+ * @param histogram - its latencies
+ * @return
+ *      void
+ */
+static void printStatsRow(const string &name, const Histogram &histogram)
+{
+  cout << left << setw(16) << name << right << setw(8) << histogram.count();
+  if (histogram.count() == 0)
+  {
+    cout << endl;
+    return;
+  }
+  cout << setw(10) << formatLatency(histogram.percentile(50)) << setw(10) << formatLatency(histogram.percentile(90))
+       << setw(10) << formatLatency(histogram.percentile(99)) << setw(10) << formatLatency(histogram.max()) << endl;
+}
+
+void SmallShell::printStats() const
+{
+  static const char *const phases[NUM_STATS_PHASES] = {"parse", "dispatch", "launch", "first-wait", "signal"};
+  cout << left << setw(16) << "phase" << right << setw(8) << "count" << setw(10) << "p50" << setw(10) << "p90"
+       << setw(10) << "p99" << setw(10) << "max" << endl;
+  for (int phase = 0; phase < NUM_STATS_PHASES; phase++)
+  {
+    printStatsRow(phases[phase], m_phaseStats[phase]);
+  }
+  for (int i = 0; i < NUM_BUILTINS; i++)
+  {
+    if (m_builtinStats[i].count() != 0)
     {
-      if (setpgrp() == SYS_FAIL)
-      {
-        perror("smash error: setpgrp failed");
-        return nullptr;
-      }
-      return new ExternalCommand(cmd_line);
+      printStatsRow(string("builtin ") + builtins[i].name, m_builtinStats[i]);
     }
-    else if (pid > 0 && isBackground)
+  }
+}
+
+void SmallShell::resetStats()
+{
+  for (Histogram &histogram : m_phaseStats)
+  {
+    histogram.reset();
+  }
+  for (Histogram &histogram : m_builtinStats)
+  {
+    histogram.reset();
+  }
+}
+
+void SmallShell::dispatched(int64_t nowNs)
+{
+  if (m_dispatchStartNs != 0)
+  {
+    m_phaseStats[STATS_DISPATCH].record(nowNs - m_dispatchStartNs);
+    m_dispatchStartNs = 0;
+  }
+}
+
+void SmallShell::finishTiming(pid_t pid, const struct rusage &usage)
+{
+  int64_t endNs = monotonicNs();
+  for (StageTiming &stage : m_timing->stages)
+  {
+    if (stage.pid == pid && stage.endNs == 0)
     {
-      shell.getJobs()->addJob(cmd_line, pid);
-      return nullptr;
+      int64_t exitNs = jobs.takeExitTime(pid);
+      stage.endNs = exitNs != 0 ? exitNs : endNs;
+      stage.usage = usage;
     }
   }
-  return nullptr;
 }
 
-JobsList *SmallShell::getJobs()
+void SmallShell::setTimeout(int64_t delayNs, const char *cmd_line)
 {
-  return &jobs;
+  m_timeoutNs = delayNs;
+  m_timeoutLine = cmd_line;
 }
 
-void SmallShell::executeCommand(const char *cmd_line)
+void SmallShell::startTimeout(pid_t pid)
 {
-  Command *cmd = CreateCommand(cmd_line);
-  if (cmd == nullptr)
+  if (m_timeoutNs == 0)
   {
-    delete cmd;
     return;
   }
-  cmd->execute();
-  if (dynamic_cast<QuitCommand *>(cmd) != nullptr || dynamic_cast<RedirectionCommand *>(cmd) != nullptr)
+  m_timeouts.add(pid, m_timeoutNs, m_timeoutLine);
+  m_timeoutNs = 0;
+}
+
+int64_t SmallShell::takeTimeout(string &cmd_line)
+{
+  int64_t delayNs = m_timeoutNs;
+  if (delayNs != 0)
   {
-    delete cmd;
-    exit(0);
+    cmd_line = m_timeoutLine;
+    m_timeoutNs = 0;
   }
-  delete cmd;
+  return delayNs;
 }
 
-void SmallShell::chngPrompt(const std::string newPrompt)
+Timeouts *SmallShell::getTimeouts()
 {
-  m_prompt = newPrompt;
+  return &m_timeouts;
 }
 
-std::string SmallShell::getPrompt() const
+void SmallShell::setTuning(const LaunchTuning *tuning)
 {
-  return m_prompt;
+  m_tuning = tuning;
+}
+
+const LaunchTuning *SmallShell::getTuning(bool isBackground, LaunchTuning &tuning) const
+{
+  tuning = isBackground ? m_defaultTuning : makeLaunchTuning();
+  if (m_tuning != nullptr)
+  {
+    tuning = mergeTuning(tuning, *m_tuning);
+  }
+  return isTuned(tuning) ? &tuning : nullptr;
+}
+
+LaunchTuning *SmallShell::getDefaultTuning()
+{
+  return &m_defaultTuning;
+}
+
+void SmallShell::setTiming(CommandTiming *timing)
+{
+  m_timing = timing;
 }
 
-char *SmallShell::getCurrDir() const
+CommandTiming *SmallShell::getTiming()
 {
-  return m_currDir;
+  return m_timing;
 }
 
-void SmallShell::setCurrDir(char *currDir, char *toCombine)
+void SmallShell::executeCommand(const char *cmd_line)
 {
-  if (toCombine == nullptr)
+  // The PATH directories are checked once for the whole line:
+  m_pathCache.startLine();
+  const CommandPlan *plan = planCommand(cmd_line);
+  if (plan == nullptr)
   {
-    strcpy(m_currDir, currDir);
     return;
   }
-  int length = string(currDir).length() + string(toCombine).length() + 2;
-  char *temp = (char *)malloc(length * sizeof(char));
-  if (temp == nullptr)
+  executeCommand(cmd_line, *plan);
+}
+
+void SmallShell::executeCommand(const char *cmd_line, const CommandPlan &plan, const char *text)
+{
+  // A command run by a prefix command is dispatched as part of it:
+  bool isOutermost = m_dispatchStartNs == 0;
+  if (isOutermost)
   {
-    free(temp);
-    cerr << "smash error: malloc failed" << endl;
-    return;
+    m_dispatchStartNs = monotonicNs();
+  }
+  // Jobs that finished while the shell waited for input are reaped now:
+  jobs.removeFinishedJobs();
+  // The plan may be evicted while it runs (plancache -c), so read what is needed afterwards first:
+  CommandKind kind = plan.kind;
+  if (kind == CMD_BUILTIN && (plan.builtin->flags & BUILTIN_PREFIX))
+  {
+    plan.builtin->command->executeLine(cmd_line, text != nullptr ? text : cmd_line, plan.line);
+  }
+  else if (kind == CMD_BUILTIN)
+  {
+    const BuiltinEntry *builtin = plan.builtin;
+    runBuiltin(builtin, plan.line);
+    if (builtin->flags & BUILTIN_EXITS_SHELL)
+    {
+      exit(0);
+    }
+  }
+  else
+  {
+    // The bodies of here-documents follow the line, and are read even if it does not run:
+    readHereDocuments(plan.line);
+    Command *cmd = CreateCommand(cmd_line, plan);
+    if (cmd != nullptr)
+    {
+      cmd->execute();
+      delete cmd;
+    }
+    closeHereDocuments();
   }
-  strcpy(temp, currDir);
-  if (strcmp(currDir, "/") != 0)
+  // What was not dispatched (a queued job, a program not found) is not counted:
+  if (isOutermost)
   {
-    strcat(temp, "/");
+    m_dispatchStartNs = 0;
+    m_firstLaunchNs = 0;
   }
-  strcat(temp, toCombine);
-  strcpy(m_currDir, temp);
-  free(temp);
 }
 
-char *SmallShell::getPrevDir() const
+void SmallShell::chngPrompt(const std::string newPrompt)
 {
-  return m_prevDir;
+  m_prompt = newPrompt;
 }
 
-void SmallShell::setPrevDir()
+std::string SmallShell::getPrompt() const
 {
-  strcpy(m_prevDir, m_currDir);
+  return m_prompt;
 }
+
@@ -2,11 +2,18 @@
 #define SMASH_COMMAND_H_
 
 #include <vector>
+#include <string>
 #include <string.h>
-
-#define COMMAND_ARGS_MAX_LENGTH (200)
-#define COMMAND_MAX_ARGS (20)
-#define MAX_PATH_LENGTH (80)
+#include "Parser.h"
+#include "Launcher.h"
+#include "PathCache.h"
+#include "Glob.h"
+#include "Relay.h"
+#include "Redirector.h"
+#include "Jobs.h"
+#include "Timeouts.h"
+#include "WorkingDir.h"
+#include "Histogram.h"
 
 /*
  *  Command Class:
@@ -18,10 +25,11 @@ public:
   /*
    * Constructor of Command class
    * @param cmd_line - the given CMD line
+   * @param line - the parsed CMD line
    * @return
    *      A new instance of Command.
    */
-  Command(const char *cmd_line);
+  Command(const char *cmd_line, const ParsedLine &line);
 
   /*
    * Destructor of the Command class
@@ -39,190 +47,71 @@ public:
 
 protected:
   /*
-   * Updates the current directory for the first time
-   * Receives no parameters
-   * @return
-   *      void
-   */
-  void firstUpdateCurrDir();
-
-  /*
-   * The internal field associated with a Command:
+   * The internal fields associated with a Command:
    * m_cmd_line: The CMD line received from the user
+   * m_line: The CMD line split into arguments
    */
   const char *m_cmd_line;
+  const ParsedLine *m_line;
 };
 
 /*
  *  BuiltInCommand Class:
  *  This class represents a built-in Command of SmallShell.
+ *  Built-in commands hold no state, so each one is a single instance that is
+ *  registered in SMASH_BUILTINS and runs without allocating anything.
  */
-class BuiltInCommand : public Command
+class BuiltInCommand
 {
 public:
   /*
    * Constructor of BuiltInCommand class
-   * @param cmd_line - the given CMD line
+   * Receives no parameters.
    * @return
    *      A new instance of BuiltInCommand.
    */
-  BuiltInCommand(const char *cmd_line);
+  BuiltInCommand() = default;
 
   /*
    * Destructor of the BuiltInCommand class
    */
   virtual ~BuiltInCommand() = default;
-};
-
-//-------------------------------------Jobs List-------------------------------------
-
-/*
- *  JobsList Class:
- *  This class represents the list of jobs in SmallShell.
- */
-class JobsList
-{
-public:
-  /*
-   *  JobEntry Class:
-   *  This class represents a job in the list of jobs in SmallShell.
-   */
-  class JobEntry
-  {
-  public:
-    /*
-     * Constructor of JobEntry class
-     * Receives no parameters.
-     * @return
-     *      A new instance of JobEntry.
-     */
-    JobEntry() {}
-
-    /*
-     * Constructor of JobEntry class
-     * @param id - the given job's ID
-     * @param pid - the job's PID
-     * @param cmd - the given CMD line
-     * @param isStopped - whether the job has been stopped
-     * @return
-     *      A new instance of JobEntry.
-     */
-    JobEntry(int id, pid_t pid, const char *cmd, bool isStopped = false);
-
-    /*
-     * Destructor of the JobEntry class
-     */
-    ~JobEntry() = default;
-
-    /*
-     * The internal fields associated with JobEntry:
-     * m_id: The job's ID
-     * m_pid: The job's PID
-     * m_cmd: The job's CMD line
-     * m_isStopped: Whether the job has been stopped
-     */
-    int m_id;
-    pid_t m_pid;
-    char m_cmd[COMMAND_ARGS_MAX_LENGTH + 1];
-    bool m_isStopped;
-  };
-
-  /*
-   * Constructor of JobsList class
-   * Receives no parameters.
-   * @return
-   *      A new instance of JobsList.
-   */
-  JobsList() = default;
-
-  /*
-   * Destructor of the JobsList class
-   */
-  ~JobsList() = default;
-
-  /*
-   * Adds a job to the jobs list
-   * @param cmd - The CMD command received
-   * @param pid - The PID of the job to be added
-   * @param isStopped - Whether the job has been stopped
-   * @return
-   *    void
-   */
-  void addJob(const char *cmd, pid_t pid, bool isStopped = false);
-
-  /*
-   * Prints the list of jobs
-   * Receives no parameters.
-   * @return
-   *    void
-   */
-  void printJobsList();
-
-  /*
-   * Kills all jobs in the jobs list
-   * Receives no parameters.
-   * @return
-   *    void
-   */
-  void killAllJobs();
-
-  /*
-   * Retrieves a specific job according to its ID
-   * @param jobId - The job's ID
-   * @return
-   *    JobEntry* - A pointer to the requested job
-   */
-  JobEntry *getJobById(int jobId);
 
   /*
-   * Removes a job from the jobs list according to its ID
-   * @param jobId - The job's ID
+   * Execute function of the BuiltInCommand class:
+   * Executes the built-in command on the given arguments.
+   * @param line - the parsed CMD line
    * @return
-   *    void
-   */
-  void removeJobById(int jobId);
-
-  /*
-   * Handles signals sent to a specific job
-   * @param jobId - The job's ID
-   * @param signum - The signal number sent
-   * @return
-   *    void
-   */
-  void sigJobById(int jobId, int signum);
-
-  /*
-   * Determines whether the list of jobs is empty
-   * Receives no parameters.
-   * @return
-   *    bool - whether the jobs list is empty
+   *      void
    */
-  bool isEmpty();
+  virtual void execute(const ParsedLine &line) const = 0;
 
   /*
-   * Returns the current largest used ID in the jobs list
-   * Receives no parameters.
+   * Execute function for built-in commands registered with BUILTIN_PREFIX, which are given the
+   * whole CMD line to run the rest of it. By default the command runs on its arguments.
+   * @param cmd_line - the CMD line received
+   * @param text - the part of cmd_line the command was parsed from, which starts with its name
+   *               (after another prefix command, it is what that command runs)
+   * @param line - the parsed CMD line
    * @return
-   *    int - the current largest used ID in the jobs list
+   *      void
    */
-  int getMaxId();
+  virtual void executeLine(const char *cmd_line, const char *text, const ParsedLine &line) const
+  {
+    execute(line);
+  }
 
-private:
   /*
-   * Removes finished jobs from the list of jobs
-   * Receives no parameters.
+   * Checks whether the command leaves the shell's state as it is on the given arguments, so it can
+   * run inside the shell as a stage of a pipeline. By default it may change the state.
+   * @param line - the parsed CMD line
    * @return
-   *    void
+   *      bool - true if the command only reports, or changes nothing but files
    */
-  void removeFinishedJobs();
-
-  /*
-   * The internal fields associated with JobsList:
-   * m_list: The list of jobs in SmallShell
-   * max_id: The largest used jobs ID in the list
-   */
-  std::vector<JobEntry> m_list;
-  int max_id = 0;
+  virtual bool isReadOnly(const ParsedLine &line) const
+  {
+    return false;
+  }
 };
 
 //-------------------------------------Built-In Commands-------------------------------------
@@ -236,11 +125,11 @@ class ChangePromptCommand : public BuiltInCommand
 public:
   /*
    * Constructor of ChangePromptCommand class
-   * @param cmd_line - the given CMD line
+   * Receives no parameters.
    * @return
    *      A new instance of ChangePromptCommand.
    */
-  explicit ChangePromptCommand(const char *cmd_line);
+  ChangePromptCommand();
 
   /*
    * Destructor of the ChangePromptCommand class
@@ -250,11 +139,11 @@ public:
   /*
    * Execute function of the ChangePromptCommand class:
    * Executes the chprompt command.
-   * Receives no parameters
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
+  void execute(const ParsedLine &line) const override;
 };
 
 /*
@@ -266,11 +155,11 @@ class ShowPidCommand : public BuiltInCommand
 public:
   /*
    * Constructor of ShowPidCommand class
-   * @param cmd_line - the given CMD line
+   * Receives no parameters.
    * @return
    *      A new instance of ShowPidCommand.
    */
-  ShowPidCommand(const char *cmd_line);
+  ShowPidCommand();
 
   /*
    * Destructor of the ShowPidCommand class
@@ -280,11 +169,20 @@ public:
   /*
    * Execute function of the ShowPidCommand class:
    * Executes the showpid command.
-   * Receives no parameters
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Read-only check of the ShowPidCommand class:
+   * showpid only reports.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
+   */
+  bool isReadOnly(const ParsedLine &line) const override;
 };
 
 /*
@@ -296,11 +194,11 @@ class GetCurrDirCommand : public BuiltInCommand
 public:
   /*
    * Constructor of GetCurrDirCommand class
-   * @param cmd_line - the given CMD line
+   * Receives no parameters.
    * @return
    *      A new instance of GetCurrDirCommand.
    */
-  GetCurrDirCommand(const char *cmd_line);
+  GetCurrDirCommand();
 
   /*
    * Destructor of the GetCurrDirCommand class
@@ -310,11 +208,20 @@ public:
   /*
    * Execute function of the GetCurrDirCommand class:
    * Executes the get current directory (pwd) command.
-   * Receives no parameters
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Read-only check of the GetCurrDirCommand class:
+   * pwd only reports.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
+   */
+  bool isReadOnly(const ParsedLine &line) const override;
 };
 
 /*
@@ -326,12 +233,11 @@ class ChangeDirCommand : public BuiltInCommand
 public:
   /*
    * Constructor of ChangeDirCommand class
-   * @param cmd_line - the given CMD line
-   * @param plastPwd - the previous directory
+   * Receives no parameters.
    * @return
    *      A new instance of ChangeDirCommand.
    */
-  ChangeDirCommand(const char *cmd_line, char **plastPwd);
+  ChangeDirCommand();
 
   /*
    * Destructor of the ChangeDirCommand class
@@ -341,18 +247,111 @@ public:
   /*
    * Execute function of the ChangeDirCommand class:
    * Executes the change directory command.
-   * Receives no parameters
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
+  void execute(const ParsedLine &line) const override;
+};
+
+/*
+ *  PushDirCommand Class:
+ *  This class represents a pushd Command of SmallShell.
+ */
+class PushDirCommand : public BuiltInCommand
+{
+public:
+  /*
+   * Constructor of PushDirCommand class
+   * Receives no parameters.
+   * @return
+   *      A new instance of PushDirCommand.
+   */
+  PushDirCommand();
+
+  /*
+   * Destructor of the PushDirCommand class
+   */
+  virtual ~PushDirCommand() {}
+
+  /*
+   * Execute function of the PushDirCommand class:
+   * Pushes the current directory on the directory stack and changes to the given one, or with no
+   * argument exchanges the current directory with the top of the stack. Prints the stack.
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void execute(const ParsedLine &line) const override;
+};
+
+/*
+ *  PopDirCommand Class:
+ *  This class represents a popd Command of SmallShell.
+ */
+class PopDirCommand : public BuiltInCommand
+{
+public:
+  /*
+   * Constructor of PopDirCommand class
+   * Receives no parameters.
+   * @return
+   *      A new instance of PopDirCommand.
+   */
+  PopDirCommand();
+
+  /*
+   * Destructor of the PopDirCommand class
+   */
+  virtual ~PopDirCommand() {}
+
+  /*
+   * Execute function of the PopDirCommand class:
+   * Pops the top of the directory stack and changes to it. Prints the stack.
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void execute(const ParsedLine &line) const override;
+};
+
+/*
+ *  DirsCommand Class:
+ *  This class represents a dirs Command of SmallShell.
+ */
+class DirsCommand : public BuiltInCommand
+{
+public:
+  /*
+   * Constructor of DirsCommand class
+   * Receives no parameters.
+   * @return
+   *      A new instance of DirsCommand.
+   */
+  DirsCommand();
+
+  /*
+   * Destructor of the DirsCommand class
+   */
+  virtual ~DirsCommand() {}
+
+  /*
+   * Execute function of the DirsCommand class:
+   * Prints the current directory and the directory stack from its top down, or with -c empties the stack.
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void execute(const ParsedLine &line) const override;
 
-private:
   /*
-   * The internal field associated with a ChangeDirCommand:
-   * m_plastPwd: The last directory (last PWD)
+   * Read-only check of the DirsCommand class:
+   * dirs changes the directory stack only with -c.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
    */
-  char **m_plastPwd;
+  bool isReadOnly(const ParsedLine &line) const override;
 };
 
 /*
@@ -364,11 +363,11 @@ class JobsCommand : public BuiltInCommand
 public:
   /*
    * Constructor of JobsCommand class
-   * @param cmd_line - The CMD line received
+   * Receives no parameters.
    * @return
    *      A new instance of JobsCommand.
    */
-  JobsCommand(const char *cmd_line);
+  JobsCommand();
 
   /*
    * Destructor of the JobsCommand class
@@ -377,12 +376,24 @@ public:
 
   /*
    * Execute function of the JobsCommand class:
-   * Executes the jobs command.
-   * Receives no parameters
+   * Executes the jobs command. "jobs -l" adds each job's PID, state and elapsed time, and
+   * "jobs --done" lists the jobs that finished instead, with their exit status and resource usage.
+   * "jobs --max N" lets at most N jobs run at once and queues the rest ("cores" for the number
+   * of online CPUs, 0 for no limit); "jobs --max" alone prints the limit.
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Read-only check of the JobsCommand class:
+   * jobs changes the list only when --max sets the limit of running jobs.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
+   */
+  bool isReadOnly(const ParsedLine &line) const override;
 };
 
 /*
@@ -394,12 +405,11 @@ class ForegroundCommand : public BuiltInCommand
 public:
   /*
    * Constructor of ForegroundCommand class
-   * @param cmd_line - The CMD line received
-   * @param jobs - The list of jobs in SmallShell
+   * Receives no parameters.
    * @return
-   *      A new instance of Foreground.
+   *      A new instance of ForegroundCommand.
    */
-  ForegroundCommand(const char *cmd_line, JobsList *jobs);
+  ForegroundCommand();
 
   /*
    * Destructor of the ForegroundCommand class
@@ -409,18 +419,11 @@ public:
   /*
    * Execute function of the ForegroundCommand class:
    * Executes the fg command.
-   * Receives no parameters
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
-
-private:
-  /*
-   * The internal field associated with ForegroundCommand:
-   * m_jobs: The list of jobs in SmallShell
-   */
-  JobsList *m_jobs;
+  void execute(const ParsedLine &line) const override;
 };
 
 /*
@@ -432,12 +435,11 @@ class QuitCommand : public BuiltInCommand
 public:
   /*
    * Constructor of QuitCommand class
-   * @param cmd_line - the given CMD line
-   * @param jobs - the list of jobs in SmallShell
+   * Receives no parameters.
    * @return
    *      A new instance of QuitCommand.
    */
-  QuitCommand(const char *cmd_line, JobsList *jobs);
+  QuitCommand();
 
   /*
    * Destructor of the QuitCommand class
@@ -446,19 +448,13 @@ public:
 
   /*
    * Execute function of the QuitCommand class:
-   * Executes the quit command.
-   * Receives no parameters
+   * Executes the quit command. "quit kill" kills the jobs first, and "quit kill --grace DURATION"
+   * (such as 5s or 500ms) lets them end on SIGTERM within DURATION before killing the rest.
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
-
-private:
-  /*
-   * The internal field associated with a QuitCommand:
-   * m_jobs: The list of jobs in SmallShell
-   */
-  JobsList *m_jobs;
+  void execute(const ParsedLine &line) const override;
 };
 
 /*
@@ -470,12 +466,11 @@ class KillCommand : public BuiltInCommand
 public:
   /*
    * Constructor of KillCommand class
-   * @param cmd_line - The CMD line received
-   * @param jobs - The list of jobs in SmallShell
+   * Receives no parameters.
    * @return
    *      A new instance of KillCommand.
    */
-  KillCommand(const char *cmd_line, JobsList *jobs);
+  KillCommand();
 
   /*
    * Destructor of the KillCommand class
@@ -484,157 +479,658 @@ public:
 
   /*
    * Execute function of the KillCommand class:
-   * Executes the kill command.
-   * Receives no parameters
+   * Executes "kill -SIGNAL JOBS...": sends the signal, by number or name, to the process group of
+   * each job named. A job is named by its ID, with or without "%"; "%N-%M" names the jobs in a
+   * range, and commas separate several in one argument.
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
-
-private:
-  /*
-   * The internal field associated with KillCommand:
-   * m_jobs: The list of jobs in SmallShell
-   */
-  JobsList *m_jobs;
+  void execute(const ParsedLine &line) const override;
 };
 
-//-------------------------------------External Commands-------------------------------------
-
 /*
- *  ExternalCommand Class:
- *  This class represents an external Command of SmallShell.
+ *  PlanCacheCommand Class:
+ *  This class represents the plancache Command in SmallShell.
  */
-class ExternalCommand : public Command
+class PlanCacheCommand : public BuiltInCommand
 {
 public:
   /*
-   * Constructor of ExternalCommand class
-   * @param cmd_line - the given CMD line
+   * Constructor of PlanCacheCommand class
+   * Receives no parameters.
    * @return
-   *      A new instance of ExternalCommand.
+   *      A new instance of PlanCacheCommand.
    */
-  ExternalCommand(const char *cmd_line);
+  PlanCacheCommand();
 
   /*
-   * Destructor of the ExternalCommand class
+   * Destructor of the PlanCacheCommand class
    */
-  virtual ~ExternalCommand() {}
+  virtual ~PlanCacheCommand() {}
 
   /*
-   * Execute function of the ExternalCommand class:
-   * Executes the external command.
-   * Receives no parameters
+   * Execute function of the PlanCacheCommand class:
+   * Prints the plan cache counters, or clears the cache with "-c".
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
-};
+  void execute(const ParsedLine &line) const override;
 
-//-------------------------------------Special Commands-------------------------------------
+  /*
+   * Read-only check of the PlanCacheCommand class:
+   * plancache changes the cache only with -c.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
+   */
+  bool isReadOnly(const ParsedLine &line) const override;
+};
 
 /*
- *  RedirectionCommand Class:
- *  This class represents a redirection Command of SmallShell.
+ *  HashCommand Class:
+ *  This class represents the hash Command in SmallShell.
  */
-class RedirectionCommand : public Command
+class HashCommand : public BuiltInCommand
 {
 public:
   /*
-   * Constructor of RedirectionCommand class
-   * @param cmd_line - the given CMD line
+   * Constructor of HashCommand class
+   * Receives no parameters.
    * @return
-   *      A new instance of RedirectionCommand.
+   *      A new instance of HashCommand.
    */
-  explicit RedirectionCommand(const char *cmd_line);
+  HashCommand();
 
   /*
-   * Destructor of the RedirectionCommand class
+   * Destructor of the HashCommand class
    */
-  virtual ~RedirectionCommand() {}
+  virtual ~HashCommand() {}
 
   /*
-   * Execute function of the RedirectionCommand class:
-   * Executes the redirection command.
-   * Receives no parameters
+   * Execute function of the HashCommand class:
+   * Prints the remembered locations of commands, clears them with "-r",
+   * or looks up and remembers the given command names.
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Read-only check of the HashCommand class:
+   * hash changes the cache when it is given arguments: -r clears it, and names are added to it.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
+   */
+  bool isReadOnly(const ParsedLine &line) const override;
 };
 
 /*
- *  PipeCommand Class:
- *  This class represents a pipe Command of SmallShell.
+ *  PipesCommand Class:
+ *  This class represents the pipes Command in SmallShell.
  */
-class PipeCommand : public Command
+class PipesCommand : public BuiltInCommand
 {
 public:
   /*
-   * Constructor of PipeCommand class
-   * @param cmd_line - the given CMD line
+   * Constructor of PipesCommand class
+   * Receives no parameters.
    * @return
-   *      A new instance of PipeCommand.
+   *      A new instance of PipesCommand.
    */
-  PipeCommand(const char *cmd_line);
+  PipesCommand();
 
   /*
-   * Destructor of the PipeCommand class
+   * Destructor of the PipesCommand class
    */
-  virtual ~PipeCommand() {}
+  virtual ~PipesCommand() {}
 
   /*
-   * Execute function of the PipeCommand class:
-   * Executes the pipe command.
-   * Receives no parameters
+   * Execute function of the PipesCommand class:
+   * Prints how pipelines set up their pipes. "-s SIZE" sets the pipe capacity (0 for the
+   * system default), and "-r on|off" turns the relay that counts bytes and stalls on or off.
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Read-only check of the PipesCommand class:
+   * pipes changes the options when it is given any.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
+   */
+  bool isReadOnly(const ParsedLine &line) const override;
 };
 
 /*
- *  ChmodCommand Class:
- *  This class represents the chmod Command in SmallShell.
+ *  TimeoutCommand Class:
+ *  This class represents the timeout Command in SmallShell.
  */
-class ChmodCommand : public BuiltInCommand
+class TimeoutCommand : public BuiltInCommand
 {
 public:
   /*
-   * Constructor of ChmodCommand class
-   * @param cmd_line - The CMD line received
+   * Constructor of TimeoutCommand class
+   * Receives no parameters.
    * @return
-   *      A new instance of ChmodCommand.
+   *      A new instance of TimeoutCommand.
    */
-  ChmodCommand(const char *cmd_line);
+  TimeoutCommand();
 
   /*
-   * Destructor of the ChmodCommand class
+   * Destructor of the TimeoutCommand class
    */
-  virtual ~ChmodCommand() {}
+  virtual ~TimeoutCommand() {}
 
   /*
-   * Execute function of the ChmodCommand class:
-   * Executes the chmod command.
-   * Receives no parameters
+   * Execute function of the TimeoutCommand class:
+   * Without the rest of its CMD line there is nothing to run, so this only checks the arguments.
+   * @param line - the parsed CMD line
    * @return
    *      void
    */
-  void execute() override;
-};
+  void execute(const ParsedLine &line) const override;
 
-//-------------------------------------SmallShell-------------------------------------
+  /*
+   * Runs "timeout SECS CMD": runs CMD, in the foreground or as a job, and kills its process
+   * group if it did not finish after SECS seconds, reporting it when that happens.
+   * @param cmd_line - the CMD line received
+   * @param text - the part of cmd_line the command was parsed from
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void executeLine(const char *cmd_line, const char *text, const ParsedLine &line) const override;
+};
 
 /*
- *  SmallShell Class:
- *  This class represents the smash (small shell).
+ *  RunCommand Class:
+ *  This class represents the run Command in SmallShell.
  */
-class SmallShell
+class RunCommand : public BuiltInCommand
 {
 public:
   /*
-   * Constructor of SmallShell class
-   * @param prompt - The desired prompt line
+   * Constructor of RunCommand class
+   * Receives no parameters.
+   * @return
+   *      A new instance of RunCommand.
+   */
+  RunCommand();
+
+  /*
+   * Destructor of the RunCommand class
+   */
+  virtual ~RunCommand() {}
+
+  /*
+   * Execute function of the RunCommand class:
+   * Sets, clears or prints the default scheduling settings of background jobs
+   * ("run --default [OPTIONS | none]"); otherwise there is nothing to run without the rest of
+   * the CMD line, so this only checks the arguments.
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Runs "run [--cpus LIST] [--nice N] [--ioprio CLASS[:LEVEL]] CMD": runs CMD, in the foreground
+   * or as a job, with every process it launches set to run on the CPUs of LIST, with nice value N
+   * and with the I/O priority given, on top of the defaults of background jobs if CMD is one.
+   * @param cmd_line - the CMD line received
+   * @param text - the part of cmd_line the command was parsed from
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void executeLine(const char *cmd_line, const char *text, const ParsedLine &line) const override;
+};
+
+/*
+ *  TimeCommand Class:
+ *  This class represents the time Command in SmallShell.
+ */
+class TimeCommand : public BuiltInCommand
+{
+public:
+  /*
+   * Constructor of TimeCommand class
+   * Receives no parameters.
+   * @return
+   *      A new instance of TimeCommand.
+   */
+  TimeCommand();
+
+  /*
+   * Destructor of the TimeCommand class
+   */
+  virtual ~TimeCommand() {}
+
+  /*
+   * Execute function of the TimeCommand class:
+   * There is nothing to time without the rest of the CMD line, so this only reports it.
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Runs "time CMD": runs CMD, then reports to stderr the wall, user and system time it took,
+   * the same for each stage of it with the most memory the stage used, and how the shell's own
+   * part divides between parsing, dispatching, launching and waiting.
+   * @param cmd_line - the CMD line received
+   * @param text - the part of cmd_line the command was parsed from
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void executeLine(const char *cmd_line, const char *text, const ParsedLine &line) const override;
+};
+
+/*
+ *  StatsCommand Class:
+ *  This class represents the stats Command in SmallShell.
+ */
+class StatsCommand : public BuiltInCommand
+{
+public:
+  /*
+   * Constructor of StatsCommand class
+   * Receives no parameters.
+   * @return
+   *      A new instance of StatsCommand.
+   */
+  StatsCommand();
+
+  /*
+   * Destructor of the StatsCommand class
+   */
+  virtual ~StatsCommand() {}
+
+  /*
+   * Execute function of the StatsCommand class:
+   * Prints the 50th, 90th and 99th percentiles and the maximum of the latency of each phase of
+   * executing commands, and of each built-in command, or with -r forgets them.
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Read-only check of the StatsCommand class:
+   * stats changes the statistics only with -r.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
+   */
+  bool isReadOnly(const ParsedLine &line) const override;
+};
+
+//-------------------------------------External Commands-------------------------------------
+
+/*
+ *  ExternalCommand Class:
+ *  This class represents an external Command of SmallShell.
+ */
+class ExternalCommand : public Command
+{
+public:
+  /*
+   * Constructor of ExternalCommand class
+   * @param cmd_line - the given CMD line
+   * @param line - the parsed CMD line
+   * @return
+   *      A new instance of ExternalCommand.
+   */
+  ExternalCommand(const char *cmd_line, const ParsedLine &line);
+
+  /*
+   * Destructor of the ExternalCommand class
+   */
+  virtual ~ExternalCommand() {}
+
+  /*
+   * Execute function of the ExternalCommand class:
+   * Executes the external command, with its redirections applied in the launched process.
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void execute() override;
+};
+
+/*
+ *  QueuedCommand Class:
+ *  An external command run in the background that waits in the admission queue of the jobs
+ *  list. It keeps its expanded arguments, its program, its redirections, the memfds of its
+ *  here-documents and its timeout, so it starts the same way later, whatever line the shell
+ *  runs by then.
+ */
+class QueuedCommand : public JobStarter
+{
+public:
+  /*
+   * Constructor of QueuedCommand class. Takes over the here-documents of the line being
+   * executed and the timeout set for it.
+   * @param argv - the program and its arguments, NULL-terminated
+   * @param path - the program's path
+   * @param stage - the parsed command, for its redirections
+   * @param tuning - the scheduling settings of the command, or nullptr
+   * @return
+   *      A new instance of QueuedCommand.
+   */
+  QueuedCommand(char *const *argv, const char *path, const PipelineStage &stage, const LaunchTuning *tuning);
+
+  /*
+   * Destructor of the QueuedCommand class
+   * Closes the here-documents.
+   */
+  virtual ~QueuedCommand();
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  QueuedCommand(QueuedCommand const &) = delete;
+  void operator=(QueuedCommand const &) = delete;
+
+  /*
+   * Launches the command, with its redirections applied in the launched process
+   * Receives no parameters
+   * @return
+   *      pid_t - the PID of the process, or -1
+   */
+  pid_t start() override;
+
+private:
+  /*
+   * The internal fields associated with QueuedCommand:
+   * m_words: The program and its arguments
+   * m_argv: Points into m_words, NULL-terminated
+   * m_path: The program's path
+   * m_targets: The target of every redirection
+   * m_redirections: The redirections, whose targets point into m_targets
+   * m_hereDocuments: The memfds of the here-documents of the line, by hereIndex, owned
+   * m_launchMode: The launch path
+   * m_tuning: The scheduling settings of the command
+   * m_timeoutNs: The timeout of the command, in nanoseconds, or 0
+   * m_timeoutLine: The CMD line reported when that timeout fires
+   */
+  std::vector<std::string> m_words;
+  std::vector<char *> m_argv;
+  std::string m_path;
+  std::vector<std::string> m_targets;
+  std::vector<Redirection> m_redirections;
+  std::vector<int> m_hereDocuments;
+  LaunchMode m_launchMode;
+  LaunchTuning m_tuning;
+  int64_t m_timeoutNs;
+  std::string m_timeoutLine;
+};
+
+//-------------------------------------Special Commands-------------------------------------
+
+/*
+ *  RedirectionCommand Class:
+ *  This class represents a built-in command with redirections (or redirections alone), run in SmallShell itself.
+ */
+class RedirectionCommand : public Command
+{
+public:
+  /*
+   * Constructor of RedirectionCommand class
+   * @param cmd_line - the given CMD line
+   * @param line - the parsed CMD line
+   * @param builtin - the built-in command to run, or nullptr if the line has no command
+   * @return
+   *      A new instance of RedirectionCommand.
+   */
+  RedirectionCommand(const char *cmd_line, const ParsedLine &line, const BuiltinEntry *builtin);
+
+  /*
+   * Destructor of the RedirectionCommand class
+   */
+  virtual ~RedirectionCommand() {}
+
+  /*
+   * Execute function of the RedirectionCommand class:
+   * Redirects the shell's own descriptors, runs the built-in command and puts the descriptors back.
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void execute() override;
+
+private:
+  /*
+   * The internal fields associated with RedirectionCommand:
+   * m_builtin: The built-in command to run, nullptr if the line has no command
+   */
+  const BuiltinEntry *m_builtin;
+};
+
+/*
+ *  PipeCommand Class:
+ *  This class represents a pipeline of any number of stages, started together in one process group.
+ */
+class PipeCommand : public Command
+{
+public:
+  /*
+   * Constructor of PipeCommand class
+   * @param cmd_line - the given CMD line
+   * @param line - the parsed CMD line
+   * @return
+   *      A new instance of PipeCommand.
+   */
+  PipeCommand(const char *cmd_line, const ParsedLine &line);
+
+  /*
+   * Destructor of the PipeCommand class
+   */
+  virtual ~PipeCommand() {}
+
+  /*
+   * Execute function of the PipeCommand class:
+   * Executes the pipe command: starts every stage, then waits for all of them.
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void execute() override;
+};
+
+/*
+ *  ChmodCommand Class:
+ *  This class represents the chmod Command in SmallShell.
+ */
+class ChmodCommand : public BuiltInCommand
+{
+public:
+  /*
+   * Constructor of ChmodCommand class
+   * Receives no parameters.
+   * @return
+   *      A new instance of ChmodCommand.
+   */
+  ChmodCommand();
+
+  /*
+   * Destructor of the ChmodCommand class
+   */
+  virtual ~ChmodCommand() {}
+
+  /*
+   * Execute function of the ChmodCommand class:
+   * Executes the chmod command.
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void execute(const ParsedLine &line) const override;
+
+  /*
+   * Read-only check of the ChmodCommand class:
+   * chmod changes a file, which a program run in its place would do as well, and not the shell.
+   * @param line - the parsed CMD line
+   * @return
+   *      bool - true if the command leaves the shell's state as it is
+   */
+  bool isReadOnly(const ParsedLine &line) const override;
+};
+
+//-------------------------------------Built-In Registry-------------------------------------
+
+/*
+ * Flags of a registered built-in command:
+ * BUILTIN_EXITS_SHELL: smash exits after running the command
+ * BUILTIN_PREFIX: the command runs the rest of its CMD line, pipes and redirections included, so
+ *                 it takes the whole line (see BuiltInCommand::executeLine); inside a pipeline
+ *                 the program of the same name runs instead
+ */
+enum BuiltinFlags
+{
+  BUILTIN_EXITS_SHELL = 1,
+  BUILTIN_PREFIX = 2
+};
+
+/*
+ * The registry of built-in commands, as X(name, class, flags).
+ * A new built-in command only has to be added here; the dispatch table is generated from it.
+ */
+#define SMASH_BUILTINS(X)                   \
+  X("chprompt", ChangePromptCommand, 0)     \
+  X("showpid", ShowPidCommand, 0)           \
+  X("pwd", GetCurrDirCommand, 0)            \
+  X("cd", ChangeDirCommand, 0)              \
+  X("pushd", PushDirCommand, 0)             \
+  X("popd", PopDirCommand, 0)               \
+  X("dirs", DirsCommand, 0)                 \
+  X("jobs", JobsCommand, 0)                 \
+  X("fg", ForegroundCommand, 0)             \
+  X("quit", QuitCommand, BUILTIN_EXITS_SHELL) \
+  X("kill", KillCommand, 0)                 \
+  X("chmod", ChmodCommand, 0)               \
+  X("plancache", PlanCacheCommand, 0)       \
+  X("hash", HashCommand, 0)                 \
+  X("pipes", PipesCommand, 0)               \
+  X("timeout", TimeoutCommand, BUILTIN_PREFIX) \
+  X("run", RunCommand, BUILTIN_PREFIX)      \
+  X("time", TimeCommand, BUILTIN_PREFIX)    \
+  X("stats", StatsCommand, 0)
+
+/*
+ *  BuiltinEntry Struct:
+ *  A registered built-in command.
+ *  name: The name the command is invoked by
+ *  command: The single instance of the command
+ *  flags: A combination of BuiltinFlags
+ */
+struct BuiltinEntry
+{
+  const char *name;
+  const BuiltInCommand *command;
+  unsigned flags;
+};
+
+/*
+ * Finds a registered built-in command by name, using a perfect hash table
+ * that is generated at compile time
+ * @param name - the first word of the CMD line
+ * @return
+ *      const BuiltinEntry* - the built-in command, or nullptr if name is not a built-in command
+ */
+const BuiltinEntry *findBuiltin(const char *name);
+
+#define BUILTIN_COUNT(name, cls, flags) +1
+// The number of registered built-in commands:
+static constexpr int NUM_BUILTINS = 0 SMASH_BUILTINS(BUILTIN_COUNT);
+#undef BUILTIN_COUNT
+
+/*
+ * Returns the position of a built-in command in the registry
+ * @param builtin - the built-in command, as returned by findBuiltin
+ * @return
+ *      int - its position in SMASH_BUILTINS, from 0 to NUM_BUILTINS - 1
+ */
+int builtinIndex(const BuiltinEntry *builtin);
+
+//-------------------------------------Command Timing-------------------------------------
+
+/*
+ *  StageTiming Struct:
+ *  What one stage of a timed command cost.
+ *  name: The program the stage ran, or its built-in command
+ *  pid: The PID of its process, or 0 for a built-in command the shell ran itself
+ *  startNs: The monotonic time it started at, in nanoseconds
+ *  endNs: The monotonic time it was seen finishing at, or 0 if it was not waited for
+ *  usage: What it used, from wait4; for a built-in command, what the shell's thread used meanwhile
+ */
+struct StageTiming
+{
+  std::string name;
+  pid_t pid;
+  int64_t startNs;
+  int64_t endNs;
+  struct rusage usage;
+};
+
+/*
+ *  CommandTiming Struct:
+ *  Where the time of a command run by time went, collected while it runs.
+ *  parseNs: The time spent planning the command
+ *  launchNs: The time spent launching its processes, by fork or spawn
+ *  waitNs: The time spent waiting for them
+ *  stages: Its stages, in the order they started
+ */
+struct CommandTiming
+{
+  int64_t parseNs;
+  int64_t launchNs;
+  int64_t waitNs;
+  std::vector<StageTiming> stages;
+};
+
+//-------------------------------------Latency Statistics-------------------------------------
+
+/*
+ * The phases of executing a command that SmallShell keeps latency histograms of:
+ * STATS_PARSE: Planning a CMD line, from the plan cache or by parsing it
+ * STATS_DISPATCH: From starting to execute a command until it launches its first process or runs its built-in command
+ * STATS_LAUNCH: Launching a process, by fork or spawn
+ * STATS_FIRST_WAIT: From launching the first process of a command until the shell waits for it in the foreground
+ * STATS_SIGNAL: From forwarding ctrl-C until the foreground wait sees the process end
+ */
+enum StatsPhase
+{
+  STATS_PARSE,
+  STATS_DISPATCH,
+  STATS_LAUNCH,
+  STATS_FIRST_WAIT,
+  STATS_SIGNAL,
+  NUM_STATS_PHASES
+};
+
+//-------------------------------------SmallShell-------------------------------------
+
+/*
+ *  SmallShell Class:
+ *  This class represents the smash (small shell).
+ */
+class SmallShell
+{
+public:
+  /*
+   * Constructor of SmallShell class
+   * @param prompt - The desired prompt line
    * @return
    *      A new instance of SmallShell.
    */
@@ -663,13 +1159,23 @@ public:
   ~SmallShell();
 
   /*
-   * Creates a command based on the input received
+   * Parses the input received into the line arena and creates a command from it
    * @param cmd_line - The CMD line received
    * @return
-   *      A new instance of Command.
+   *      A new instance of Command, or nullptr for built-in commands (which are not
+   *      allocated) and for empty lines.
    */
   Command *CreateCommand(const char *cmd_line);
 
+  /*
+   * Creates a command based on an already parsed input
+   * @param cmd_line - The CMD line received
+   * @param plan - the parsed CMD line and the command it dispatches to
+   * @return
+   *      A new instance of Command.
+   */
+  Command *CreateCommand(const char *cmd_line, const CommandPlan &plan);
+
   /*
    * Retrieves the list of jobs in SmallShell
    * Receives no parameters.
@@ -679,79 +1185,346 @@ public:
   JobsList *getJobs();
 
   /*
-   * Executes a command created
-   * @param cmd_line - The CMD line received
+   * Retrieves the plan cache of SmallShell
+   * Receives no parameters.
+   * @return
+   *     PlanCache* - a pointer to SmallShell's plan cache.
+   */
+  PlanCache *getPlans();
+
+  /*
+   * Retrieves the cache of command locations in PATH
+   * Receives no parameters.
+   * @return
+   *     PathCache* - a pointer to SmallShell's path cache.
+   */
+  PathCache *getPathCache();
+
+  /*
+   * Retrieves the wildcard expander of SmallShell
+   * Receives no parameters.
+   * @return
+   *     GlobExpander* - a pointer to SmallShell's wildcard expander.
+   */
+  GlobExpander *getGlobber();
+
+  /*
+   * Retrieves the current directory of SmallShell
+   * Receives no parameters.
+   * @return
+   *     WorkingDir* - a pointer to SmallShell's current directory and directory stack.
+   */
+  WorkingDir *getWorkingDir();
+
+  /*
+   * Retrieves the options pipelines set up their pipes with
+   * Receives no parameters.
+   * @return
+   *     PipeOptions* - a pointer to SmallShell's pipe options.
+   */
+  PipeOptions *getPipeOptions();
+
+  /*
+   * Retrieves the here-documents of the line being executed
+   * Receives no parameters.
+   * @return
+   *     const int* - the memfd of every here-document by its hereIndex (-1 for one that failed)
+   */
+  const int *getHereDocuments() const;
+
+  /*
+   * Takes over the here-documents of the line being executed, for a command that runs later
+   * Receives no parameters.
+   * @return
+   *     std::vector<int> - the memfd of every here-document by its hereIndex (-1 for one that failed)
+   */
+  std::vector<int> takeHereDocuments();
+
+  /*
+   * Retrieves the launch path SmallShell starts programs with
+   * Receives no parameters.
+   * @return
+   *     LaunchMode - LAUNCH_SPAWN, or LAUNCH_FORK if selected through LAUNCH_MODE_ENV.
+   */
+  LaunchMode getLaunchMode() const;
+
+  /*
+   * Launches a process the way SmallShell launches programs, timing it if the command is timed
+   * @param spec - what to launch
+   * @param pid - receives the PID of the process
+   * @return
+   *      int - 0, or the errno of the failure
+   */
+  int launch(const LaunchSpec &spec, pid_t &pid);
+
+  /*
+   * Waits for a process running in the foreground, reaping the jobs that finish meanwhile.
+   * Meanwhile ctrl-C is forwarded to it. A timed process is timed to its end.
+   * @param pid - the PID of the process
+   * @param pidfd - its process fd, which is closed afterwards, or -1
+   * @return
+   *      int - the wait status of the process, or -1 if waiting failed
+   */
+  int waitForeground(pid_t pid, int pidfd);
+
+  /*
+   * Sets the timeout the next command launched gets, or clears it
+   * @param delayNs - the delay after which the command is killed, in nanoseconds, or 0 for none
+   * @param cmd_line - the CMD line to report when it fires
    * @return
    *      void
    */
-  void executeCommand(const char *cmd_line);
+  void setTimeout(int64_t delayNs, const char *cmd_line);
 
   /*
-   * Changes the prompt
-   * @param newPrompt - the desired new prompt
+   * Gives a command that was just launched the timeout that was set, if any, and clears it
+   * @param pid - the PID of the process that leads the command's process group
    * @return
    *      void
    */
-  void chngPrompt(const std::string newPrompt = "smash");
+  void startTimeout(pid_t pid);
 
   /*
-   * Gets the current prompt
+   * Takes the timeout that was set, if any, for a command that is launched later, and clears it
+   * @param cmd_line - receives the CMD line to report when it fires
+   * @return
+   *      int64_t - the delay in nanoseconds, or 0 for none
+   */
+  int64_t takeTimeout(std::string &cmd_line);
+
+  /*
+   * Retrieves the timeouts of the commands SmallShell launched
+   * Receives no parameters.
+   * @return
+   *     Timeouts* - a pointer to SmallShell's timeouts.
+   */
+  Timeouts *getTimeouts();
+
+  /*
+   * Sets the scheduling settings every process launched gets until they are cleared
+   * @param tuning - the settings, which must outlive their use, or nullptr to clear them
+   * @return
+   *      void
+   */
+  void setTuning(const LaunchTuning *tuning);
+
+  /*
+   * Retrieves the scheduling settings of a process about to be launched: those set with
+   * setTuning, on top of the defaults if the process is a background job
+   * @param isBackground - whether the process is a background job
+   * @param tuning - receives the settings
+   * @return
+   *      const LaunchTuning* - tuning, or nullptr if nothing is set
+   */
+  const LaunchTuning *getTuning(bool isBackground, LaunchTuning &tuning) const;
+
+  /*
+   * Retrieves the default scheduling settings of background jobs
+   * Receives no parameters.
+   * @return
+   *     LaunchTuning* - a pointer to the defaults.
+   */
+  LaunchTuning *getDefaultTuning();
+
+  /*
+   * Sets where the processes launched and waited for are timed, until it is cleared
+   * @param timing - the timing, which must outlive its use, or nullptr to clear it
+   * @return
+   *      void
+   */
+  void setTiming(CommandTiming *timing);
+
+  /*
+   * Retrieves where the processes launched and waited for are timed
+   * Receives no parameters.
+   * @return
+   *     CommandTiming* - the timing set by time, or nullptr.
+   */
+  CommandTiming *getTiming();
+
+  /*
+   * Runs a built-in command, counting how long it took
+   * @param builtin - the built-in command
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void runBuiltin(const BuiltinEntry *builtin, const ParsedLine &line);
+
+  /*
+   * Notes that a signal was sent to the process in the foreground, to time until it is seen ending.
+   * Async-signal-safe.
    * Receives no parameters
    * @return
-   *      string - the current prompt
+   *      void
    */
-  std::string getPrompt() const;
+  void markSignalSent();
+
+  /*
+   * Prints the latency percentiles of the phases of executing commands, and of the built-in commands run
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void printStats() const;
 
   /*
-   * Gets the current directory
+   * Forgets every latency counted
    * Receives no parameters
    * @return
-   *      char*  - the current directory
+   *      void
+   */
+  void resetStats();
+
+  /*
+   * Waits for a process of a pipeline that is not the one in the foreground, timing it if it is timed
+   * @param pid - the PID of the process
+   * @return
+   *      void
+   */
+  void waitStage(pid_t pid);
+
+  /*
+   * Finds the plan of a CMD line in the plan cache, or parses it into the line arena
+   * @param cmd_line - The CMD line received
+   * @return
+   *      const CommandPlan* - the plan, or nullptr if the line could not be parsed
+   */
+  const CommandPlan *planCommand(const char *cmd_line);
+
+  /*
+   * Executes a command created
+   * @param cmd_line - The CMD line received
+   * @return
+   *      void
+   */
+  void executeCommand(const char *cmd_line);
+
+  /*
+   * Executes a command created from an already parsed input
+   * @param cmd_line - The CMD line received
+   * @param plan - the parsed CMD line and the command it dispatches to
+   * @param text - the part of cmd_line the plan was made from, or nullptr for all of it
+   * @return
+   *      void
    */
-  char *getCurrDir() const;
+  void executeCommand(const char *cmd_line, const CommandPlan &plan, const char *text = nullptr);
 
   /*
-   * Sets the current directory
-   * @param currDir - the new current directory
-   * @param toCombine - a partial path to add to the current path
+   * Changes the prompt
+   * @param newPrompt - the desired new prompt
    * @return
    *      void
    */
-  void setCurrDir(char *currDir, char *toCombine = nullptr);
+  void chngPrompt(const std::string newPrompt = "smash");
 
   /*
-   * Gets the previous directory
+   * Gets the current prompt
    * Receives no parameters
    * @return
-   *      char*  - the previous directory
+   *      string - the current prompt
    */
-  char *getPrevDir() const;
+  std::string getPrompt() const;
 
   /*
-   * Gets the current directory
-   * @param prevDir - the new previous directory
+   * Determines which command a parsed line dispatches to
+   * @param plan - the plan whose kind and built-in command are set from its parsed line
    * @return
-   *      char*  - the current directory
+   *      void
    */
-  void setPrevDir();
+  static void classifyCommand(CommandPlan &plan);
 
   /*
    * The internal fields associated with SmallShell:
    * m_pid: SmallShell's PID
    * m_pid_fg: The PID of a process running in the foreground
+   * m_pidfd_fg: The process fd of the process running in the foreground, or -1
    * m_prompt: SmallShell's prompt
-   * m_prevDir: The previous directory
-   * m_currDir: The current directory
+   * m_workingDir: The current directory and the directory stack
    * jobs: The list of jobs in SmallShell
+   * m_arenaBuffer: The memory backing the line arena
+   * m_arena: Holds the arguments of the line being executed, reset for every line
+   * m_parsed: The plan of the line being executed when it is not cached
+   * m_plans: The plans of recently executed lines
+   * m_launchMode: How external programs are started
+   * m_pathCache: Where the commands run so far were found in PATH
+   * m_globber: Expands wildcards, keeping recent directory listings
+   * m_pipeOptions: How pipelines set up their pipes
+   * m_hereDocuments: The memfds of the here-documents of the line being executed
+   * m_timeouts: The commands to kill when their timeouts fire
+   * m_timeoutNs: The timeout the next command launched gets, in nanoseconds, or 0
+   * m_timeoutLine: The CMD line reported when that timeout fires
+   * m_tuning: The scheduling settings of the processes launched, set by run, or nullptr
+   * m_defaultTuning: The default scheduling settings of background jobs
+   * m_timing: Where the processes launched and waited for are timed, set by time, or nullptr
+   * m_phaseStats: The latencies of each phase of executing commands, in nanoseconds
+   * m_builtinStats: The latencies of each built-in command run, in nanoseconds, by its position in SMASH_BUILTINS
+   * m_dispatchStartNs: When the command being executed started, until it is dispatched, or 0
+   * m_firstLaunchNs: When the command being executed launched its first process, until it is waited for, or 0
+   * m_signalSentNs: When ctrl-C was forwarded to the process in the foreground, until it is seen ending, or 0
    */
   static pid_t m_pid;
   int m_pid_fg;
+  int m_pidfd_fg;
 
 private:
   std::string m_prompt;
-  char *m_prevDir;
-  char *m_currDir;
+  WorkingDir m_workingDir;
   JobsList jobs;
+  char m_arenaBuffer[LINE_ARENA_SIZE];
+  LineArena m_arena;
+  CommandPlan m_parsed;
+  PlanCache m_plans;
+  LaunchMode m_launchMode;
+  PathCache m_pathCache;
+  GlobExpander m_globber;
+  PipeOptions m_pipeOptions;
+  std::vector<int> m_hereDocuments;
+  Timeouts m_timeouts;
+  int64_t m_timeoutNs;
+  const char *m_timeoutLine;
+  const LaunchTuning *m_tuning;
+  LaunchTuning m_defaultTuning;
+  CommandTiming *m_timing;
+  Histogram m_phaseStats[NUM_STATS_PHASES];
+  Histogram m_builtinStats[NUM_BUILTINS];
+  int64_t m_dispatchStartNs;
+  int64_t m_firstLaunchNs;
+  volatile int64_t m_signalSentNs;
+
+  /*
+   * Reads the bodies of the here-documents of a line from the input, which follow the line,
+   * and makes the here-strings of the line
+   * @param line - the parsed CMD line
+   * @return
+   *      void
+   */
+  void readHereDocuments(const ParsedLine &line);
+
+  /*
+   * Closes the here-documents of the line that was executed
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void closeHereDocuments();
+
+  /*
+   * Notes that a timed process finished, with what it used
+   * @param pid - the PID of the process
+   * @param usage - what it used, from wait4
+   * @return
+   *      void
+   */
+  void finishTiming(pid_t pid, const struct rusage &usage);
+
+  /*
+   * Counts the dispatch of the command being executed, unless it was counted already
+   * @param nowNs - the monotonic time, in nanoseconds
+   * @return
+   *      void
+   */
+  void dispatched(int64_t nowNs);
 };
 
 #endif // SMASH_COMMAND_H_
@@ -0,0 +1,487 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <iterator>
+#include "Glob.h"
+
+#define GLOB_DENTS_BUFFER (32768)
+
+/*
+ *  LinuxDirent64 Struct:
+ *  A directory entry as returned by the getdents64 system call.
+ */
+struct LinuxDirent64
+{
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];
+};
+
+/*
+ * Returns the current time of the monotonic clock
+ * Receives no parameters
+ * @return
+ *      int64_t - the time in nanoseconds
+ */
+static int64_t monotonicNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Matches a character against a bracket expression ("[abc]", "[a-z]", "[!a]" or "[^a]")
+ * @param pattern - points at the '['
+ * @param end - the end of the pattern
+ * @param c - the character
+ * @param matched - set to whether c matches
+ * @return
+ *      const char* - the character after the closing ']', or nullptr if the bracket is not closed
+ */
+static const char *matchBracket(const char *pattern, const char *end, char c, bool &matched)
+{
+  const char *p = pattern + 1;
+  bool negate = false;
+  if (p < end && (*p == '!' || *p == '^'))
+  {
+    negate = true;
+    p++;
+  }
+  matched = false;
+  // A ']' right after the opening is a member, not the end:
+  bool first = true;
+  while (p < end && (*p != ']' || first))
+  {
+    first = false;
+    if (*p == '\\' && p + 1 < end)
+    {
+      p++;
+    }
+    unsigned char low = *p++;
+    unsigned char high = low;
+    if (p + 1 < end && *p == '-' && p[1] != ']')
+    {
+      p++;
+      if (*p == '\\' && p + 1 < end)
+      {
+        p++;
+      }
+      high = *p++;
+    }
+    if ((unsigned char)c >= low && (unsigned char)c <= high)
+    {
+      matched = true;
+    }
+  }
+  if (p >= end)
+  {
+    return nullptr;
+  }
+  matched = matched != negate;
+  return p + 1;
+}
+
+/*
+ * Joins a directory and a name
+ * @param dir - the directory ("" for the current directory)
+ * @param name - the name
+ * @return
+ *      string - the path
+ */
+static std::string joinPath(const std::string &dir, const char *name)
+{
+  if (dir.empty())
+  {
+    return name;
+  }
+  std::string path = dir;
+  if (path.back() != '/')
+  {
+    path += '/';
+  }
+  path += name;
+  return path;
+}
+
+/*
+ * Removes the backslashes that escape wildcard characters
+ * @param word - the word
+ * @return
+ *      string - the word without escapes
+ */
+static std::string unescape(const std::string &word)
+{
+  std::string result;
+  for (size_t i = 0; i < word.size(); i++)
+  {
+    if (word[i] == '\\' && i + 1 < word.size())
+    {
+      i++;
+    }
+    result += word[i];
+  }
+  return result;
+}
+
+/*
+ * Checks whether a directory entry is a directory
+ * @param path - the path of the entry
+ * @param type - the d_type of the entry
+ * @param followLinks - whether a symbolic link to a directory counts
+ * @return
+ *      bool - whether the entry is a directory
+ */
+static bool isDirectory(const std::string &path, unsigned char type, bool followLinks)
+{
+  if (type == DT_DIR)
+  {
+    return true;
+  }
+  if (type != DT_UNKNOWN && (type != DT_LNK || !followLinks))
+  {
+    return false;
+  }
+  struct stat st;
+  int result = followLinks ? stat(path.c_str(), &st) : lstat(path.c_str(), &st);
+  return result == 0 && S_ISDIR(st.st_mode);
+}
+
+GlobExpander::GlobExpander(size_t capacity, long ttlMs) : m_capacity(capacity), m_ttlNs((int64_t)ttlMs * 1000000),
+                                                           m_pass(0), m_hits(0), m_misses(0) {}
+
+bool GlobExpander::hasWildcard(const char *word)
+{
+  const char *end = word + strlen(word);
+  for (const char *p = word; p < end; p++)
+  {
+    bool matched;
+    if (*p == '\\' && p + 1 < end)
+    {
+      p++;
+    }
+    else if (*p == '*' || *p == '?' || (*p == '[' && matchBracket(p, end, '\0', matched) != nullptr))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GlobExpander::matchName(const char *pattern, size_t patternLength, const char *name)
+{
+  const char *p = pattern;
+  const char *end = pattern + patternLength;
+  const char *n = name;
+  // Where to resume after the last '*' if the rest does not match:
+  const char *starP = nullptr;
+  const char *starN = nullptr;
+  while (*n != '\0')
+  {
+    if (p < end && *p == '*')
+    {
+      starP = ++p;
+      starN = n;
+      continue;
+    }
+    if (p < end)
+    {
+      bool matched = false;
+      const char *next = nullptr;
+      if (*p == '?')
+      {
+        matched = true;
+        next = p + 1;
+      }
+      else if (*p == '[')
+      {
+        next = matchBracket(p, end, *n, matched);
+      }
+      if (next == nullptr)
+      {
+        // A literal character, possibly escaped:
+        const char *literal = (*p == '\\' && p + 1 < end) ? p + 1 : p;
+        matched = *literal == *n;
+        next = literal + 1;
+      }
+      if (matched)
+      {
+        p = next;
+        n++;
+        continue;
+      }
+    }
+    if (starP == nullptr)
+    {
+      return false;
+    }
+    p = starP;
+    n = ++starN;
+  }
+  while (p < end && *p == '*')
+  {
+    p++;
+  }
+  return p == end;
+}
+
+bool GlobExpander::readDirectory(const std::string &dir, Listing &listing)
+{
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1)
+  {
+    return false;
+  }
+  alignas(LinuxDirent64) char buffer[GLOB_DENTS_BUFFER];
+  long got;
+  while ((got = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0)
+  {
+    for (long offset = 0; offset < got;)
+    {
+      const LinuxDirent64 *entry = reinterpret_cast<const LinuxDirent64 *>(buffer + offset);
+      offset += entry->d_reclen;
+      const char *name = entry->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+      {
+        continue;
+      }
+      listing.offsets.push_back((uint32_t)listing.names.size());
+      listing.names.append(name, strlen(name) + 1);
+      listing.types.push_back(entry->d_type);
+    }
+  }
+  close(fd);
+  return got == 0;
+}
+
+const GlobExpander::Listing *GlobExpander::list(const std::string &dir)
+{
+  auto found = m_listings.find(dir);
+  // A listing already used by this expansion is kept as is, since the expansion may still be iterating over it:
+  if (found != m_listings.end() && found->second.pass == m_pass)
+  {
+    m_hits++;
+    return &found->second;
+  }
+  struct stat st;
+  if (stat(dir.c_str(), &st) == -1)
+  {
+    if (found != m_listings.end())
+    {
+      m_listings.erase(found);
+    }
+    return nullptr;
+  }
+  int64_t now = monotonicNs();
+  if (found != m_listings.end())
+  {
+    const Listing &cached = found->second;
+    if (cached.isStable && now < cached.expiry && cached.mtime.tv_sec == st.st_mtim.tv_sec &&
+        cached.mtime.tv_nsec == st.st_mtim.tv_nsec)
+    {
+      m_hits++;
+      found->second.pass = m_pass;
+      return &found->second;
+    }
+  }
+  else
+  {
+    found = m_listings.emplace(dir, Listing()).first;
+  }
+  m_misses++;
+  Listing &listing = found->second;
+  listing.names.clear();
+  listing.offsets.clear();
+  listing.types.clear();
+  listing.mtime = st.st_mtim;
+  listing.expiry = now + m_ttlNs;
+  // File system timestamps advance in clock ticks, so a directory changed within the last
+  // second may change again without a new mtime; its listing is not reused:
+  listing.isStable = st.st_mtim.tv_sec < time(nullptr) - 1;
+  listing.pass = m_pass;
+  if (!readDirectory(dir, listing))
+  {
+    m_listings.erase(found);
+    return nullptr;
+  }
+  return &listing;
+}
+
+void GlobExpander::walk(const std::string &dir, const std::vector<std::string> &parts, size_t index,
+                        std::vector<std::string> &matches)
+{
+  const std::string &part = parts[index];
+  bool isLast = index + 1 == parts.size();
+  if (part.empty())
+  {
+    // A trailing '/' only matches directories, which is what dir is by now:
+    if (!dir.empty())
+    {
+      matches.push_back(dir.back() == '/' ? dir : dir + "/");
+    }
+    return;
+  }
+  if (part == "**")
+  {
+    if (isLast)
+    {
+      walkAll(dir, matches);
+      return;
+    }
+    walk(dir, parts, index + 1, matches);
+    const Listing *listing = list(dir.empty() ? "." : dir);
+    for (size_t i = 0; listing != nullptr && i < listing->offsets.size(); i++)
+    {
+      const char *name = listing->names.c_str() + listing->offsets[i];
+      std::string path = joinPath(dir, name);
+      if (name[0] != '.' && isDirectory(path, listing->types[i], false))
+      {
+        walk(path, parts, index, matches);
+      }
+    }
+    return;
+  }
+  if (!hasWildcard(part.c_str()))
+  {
+    std::string path = joinPath(dir, unescape(part).c_str());
+    struct stat st;
+    if (!isLast)
+    {
+      walk(path, parts, index + 1, matches);
+    }
+    else if (lstat(path.c_str(), &st) == 0)
+    {
+      matches.push_back(path);
+    }
+    return;
+  }
+  const Listing *listing = list(dir.empty() ? "." : dir);
+  for (size_t i = 0; listing != nullptr && i < listing->offsets.size(); i++)
+  {
+    const char *name = listing->names.c_str() + listing->offsets[i];
+    // Hidden entries only match a pattern that starts with a '.':
+    if (name[0] == '.' && part[0] != '.')
+    {
+      continue;
+    }
+    if (!matchName(part.c_str(), part.size(), name))
+    {
+      continue;
+    }
+    std::string path = joinPath(dir, name);
+    if (isLast)
+    {
+      matches.push_back(path);
+    }
+    else if (isDirectory(path, listing->types[i], true))
+    {
+      walk(path, parts, index + 1, matches);
+    }
+  }
+}
+
+void GlobExpander::walkAll(const std::string &dir, std::vector<std::string> &matches)
+{
+  const Listing *listing = list(dir.empty() ? "." : dir);
+  for (size_t i = 0; listing != nullptr && i < listing->offsets.size(); i++)
+  {
+    const char *name = listing->names.c_str() + listing->offsets[i];
+    if (name[0] == '.')
+    {
+      continue;
+    }
+    std::string path = joinPath(dir, name);
+    matches.push_back(path);
+    if (isDirectory(path, listing->types[i], false))
+    {
+      walkAll(path, matches);
+    }
+  }
+}
+
+bool GlobExpander::expandPattern(const char *pattern, std::vector<std::string> &matches)
+{
+  // Listings that expired are dropped between expansions, never while one iterates over them:
+  m_pass++;
+  if (m_listings.size() > m_capacity)
+  {
+    int64_t now = monotonicNs();
+    for (auto it = m_listings.begin(); it != m_listings.end();)
+    {
+      it = now >= it->second.expiry ? m_listings.erase(it) : std::next(it);
+    }
+    if (m_listings.size() > m_capacity)
+    {
+      m_listings.clear();
+    }
+  }
+
+  std::string dir;
+  const char *p = pattern;
+  if (*p == '/')
+  {
+    dir = "/";
+  }
+  std::vector<std::string> parts;
+  while (*p != '\0')
+  {
+    while (*p == '/')
+    {
+      p++;
+    }
+    if (*p == '\0')
+    {
+      // A trailing '/':
+      parts.push_back(std::string());
+      break;
+    }
+    const char *end = strchr(p, '/');
+    if (end == nullptr)
+    {
+      end = p + strlen(p);
+    }
+    parts.push_back(std::string(p, end));
+    p = end;
+  }
+  if (parts.empty())
+  {
+    return false;
+  }
+  size_t before = matches.size();
+  walk(dir, parts, 0, matches);
+  std::sort(matches.begin() + before, matches.end());
+  return matches.size() > before;
+}
+
+void GlobExpander::expand(char *const *args, const bool *quoted, std::vector<std::string> &words)
+{
+  for (int i = 0; args[i] != nullptr; i++)
+  {
+    bool isLiteral = quoted != nullptr && quoted[i];
+    if (isLiteral || !hasWildcard(args[i]) || !expandPattern(args[i], words))
+    {
+      words.push_back(args[i]);
+    }
+  }
+}
+
+void GlobExpander::clear()
+{
+  m_listings.clear();
+}
+
+unsigned long GlobExpander::hits() const
+{
+  return m_hits;
+}
+
+unsigned long GlobExpander::misses() const
+{
+  return m_misses;
+}
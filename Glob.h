@@ -0,0 +1,172 @@
+#ifndef SMASH_GLOB_H_
+#define SMASH_GLOB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define GLOB_LISTING_CAPACITY (64)
+#define GLOB_LISTING_TTL_MS (2000)
+
+/*
+ *  GlobExpander Class:
+ *  Expands the wildcards "*", "?", "[...]" and "**" (any number of directories) in command
+ *  arguments, the way the shell would. Directories are read with getdents64, and their listings
+ *  are kept for a short while so repeated globs in a script do not read them again.
+ */
+class GlobExpander
+{
+public:
+  /*
+   * Constructor of GlobExpander class
+   * @param capacity - the maximal number of directory listings kept
+   * @param ttlMs - how long a listing is kept, in milliseconds
+   * @return
+   *      A new instance of GlobExpander.
+   */
+  explicit GlobExpander(size_t capacity = GLOB_LISTING_CAPACITY, long ttlMs = GLOB_LISTING_TTL_MS);
+
+  /*
+   * Destructor of the GlobExpander class
+   */
+  ~GlobExpander() = default;
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  GlobExpander(GlobExpander const &) = delete;
+  void operator=(GlobExpander const &) = delete;
+
+  /*
+   * Expands the wildcards of an argument list. An argument that matches nothing, or that was quoted, is kept as is.
+   * @param args - the arguments, NULL-terminated
+   * @param quoted - for each argument, whether it was quoted; nullptr if none was
+   * @param words - receives the expanded arguments, in order
+   * @return
+   *      void
+   */
+  void expand(char *const *args, const bool *quoted, std::vector<std::string> &words);
+
+  /*
+   * Appends the paths that match a pattern, sorted
+   * @param pattern - the pattern
+   * @param matches - receives the matching paths
+   * @return
+   *      bool - whether anything matched
+   */
+  bool expandPattern(const char *pattern, std::vector<std::string> &matches);
+
+  /*
+   * Drops every directory listing. The counters are kept.
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void clear();
+
+  /*
+   * Getters for the counters of the listing cache
+   */
+  unsigned long hits() const;
+  unsigned long misses() const;
+
+  /*
+   * Checks whether a word contains a wildcard ("*", "?" or a complete "[...]")
+   * @param word - the word
+   * @return
+   *      bool - whether the word is a pattern
+   */
+  static bool hasWildcard(const char *word);
+
+  /*
+   * Matches a single path component against a pattern without "/"
+   * @param pattern - the pattern
+   * @param patternLength - the length of pattern
+   * @param name - the path component
+   * @return
+   *      bool - whether name matches
+   */
+  static bool matchName(const char *pattern, size_t patternLength, const char *name);
+
+private:
+  /*
+   *  Listing Struct:
+   *  The entries of a directory, without "." and "..".
+   *  names: The names, each followed by a '\0'
+   *  offsets: The offset of each name in names
+   *  types: The d_type of each entry
+   *  mtime: The modification time of the directory when it was read
+   *  expiry: The monotonic time, in nanoseconds, after which the listing is read again
+   *  isStable: Whether mtime was old enough to prove later that nothing changed
+   *  pass: The expansion that last used the listing
+   */
+  struct Listing
+  {
+    std::string names;
+    std::vector<uint32_t> offsets;
+    std::vector<unsigned char> types;
+    struct timespec mtime;
+    int64_t expiry;
+    bool isStable;
+    unsigned long pass;
+  };
+
+  /*
+   * Returns the listing of a directory, from the cache if it is still valid
+   * @param dir - the directory
+   * @return
+   *      const Listing* - the listing, or nullptr if the directory cannot be read
+   */
+  const Listing *list(const std::string &dir);
+
+  /*
+   * Reads a directory with getdents64
+   * @param dir - the directory
+   * @param listing - receives the entries
+   * @return
+   *      bool - false if the directory cannot be read
+   */
+  static bool readDirectory(const std::string &dir, Listing &listing);
+
+  /*
+   * Matches the remaining components of a pattern below a directory
+   * @param dir - the path matched so far ("" at the start of a relative pattern)
+   * @param parts - the components of the pattern
+   * @param index - the first component to match
+   * @param matches - receives the matching paths
+   * @return
+   *      void
+   */
+  void walk(const std::string &dir, const std::vector<std::string> &parts, size_t index,
+            std::vector<std::string> &matches);
+
+  /*
+   * Appends every path below a directory, except hidden ones, for a final "**"
+   * @param dir - the directory
+   * @param matches - receives the paths
+   * @return
+   *      void
+   */
+  void walkAll(const std::string &dir, std::vector<std::string> &matches);
+
+  /*
+   * The internal fields associated with GlobExpander:
+   * m_listings: The cached directory listings, by directory
+   * m_capacity: The maximal number of cached listings
+   * m_ttlNs: How long a listing is kept, in nanoseconds
+   * m_pass: Counts the expansions; within one, every directory is read at most once
+   * m_hits: The number of listings served from the cache
+   * m_misses: The number of directories read
+   */
+  std::unordered_map<std::string, Listing> m_listings;
+  size_t m_capacity;
+  int64_t m_ttlNs;
+  unsigned long m_pass;
+  unsigned long m_hits;
+  unsigned long m_misses;
+};
+
+#endif // SMASH_GLOB_H_
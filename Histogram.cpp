@@ -0,0 +1,87 @@
+#include <algorithm>
+#include "Histogram.h"
+
+// The number of buckets for each power of two, and the largest value counted exactly:
+static const uint64_t SUB_BUCKETS = static_cast<uint64_t>(1) << HISTOGRAM_SUB_BITS;
+
+Histogram::Histogram()
+{
+  reset();
+}
+
+void Histogram::record(uint64_t value)
+{
+  m_counts[bucketOf(value)]++;
+  m_count++;
+  m_max = std::max(m_max, value);
+}
+
+uint64_t Histogram::percentile(double percent) const
+{
+  if (m_count == 0)
+  {
+    return 0;
+  }
+  // The rank of the value sought, counting from 1:
+  uint64_t rank = static_cast<uint64_t>(percent / 100 * m_count + 0.5);
+  rank = std::min(std::max<uint64_t>(rank, 1), m_count);
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+  {
+    seen += m_counts[bucket];
+    if (seen >= rank)
+    {
+      return std::min(bucketLimit(bucket), m_max);
+    }
+  }
+  return m_max;
+}
+
+void Histogram::reset()
+{
+  std::fill(m_counts, m_counts + HISTOGRAM_BUCKETS, 0);
+  m_count = 0;
+  m_max = 0;
+}
+
+uint64_t Histogram::count() const
+{
+  return m_count;
+}
+
+uint64_t Histogram::max() const
+{
+  return m_max;
+}
+
+int Histogram::bucketOf(uint64_t value)
+{
+  if (value < SUB_BUCKETS)
+  {
+    return static_cast<int>(value);
+  }
+  int exponent = 63 - __builtin_clzll(value);
+  if (exponent >= HISTOGRAM_MAX_BITS)
+  {
+    return HISTOGRAM_BUCKETS - 1;
+  }
+  // Below the leading bit, the next HISTOGRAM_SUB_BITS bits pick the bucket within the power of two:
+  int shift = exponent - HISTOGRAM_SUB_BITS;
+  uint64_t fraction = (value >> shift) - SUB_BUCKETS;
+  return static_cast<int>(((exponent - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + fraction);
+}
+
+uint64_t Histogram::bucketLimit(int bucket)
+{
+  if (bucket < static_cast<int>(SUB_BUCKETS))
+  {
+    return bucket;
+  }
+  if (bucket == HISTOGRAM_BUCKETS - 1)
+  {
+    return UINT64_MAX;
+  }
+  int shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+  uint64_t fraction = bucket & (SUB_BUCKETS - 1);
+  return ((SUB_BUCKETS + fraction + 1) << shift) - 1;
+}
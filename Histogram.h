@@ -0,0 +1,90 @@
+#ifndef SMASH_HISTOGRAM_H_
+#define SMASH_HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Each power of two is split into 2^HISTOGRAM_SUB_BITS buckets, so a bucket is within about 3% of its values:
+#define HISTOGRAM_SUB_BITS (5)
+// Values from 2^HISTOGRAM_MAX_BITS on (about 4.9 hours in nanoseconds) are counted in a last bucket of their own:
+#define HISTOGRAM_MAX_BITS (44)
+#define HISTOGRAM_BUCKETS (((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + 1)
+
+/*
+ *  Histogram Class:
+ *  Counts values, such as latencies in nanoseconds, in logarithmic buckets with a fixed relative
+ *  precision, in the manner of an HDR histogram. Recording a value costs a few instructions and
+ *  never allocates, so histograms can stay on in the shell's hot paths; percentiles are computed
+ *  only when they are asked for.
+ */
+class Histogram
+{
+public:
+  /*
+   * Constructor of Histogram class
+   * Receives no parameters
+   * @return
+   *      A new, empty instance of Histogram.
+   */
+  Histogram();
+
+  /*
+   * Counts a value
+   * @param value - the value
+   * @return
+   *      void
+   */
+  void record(uint64_t value);
+
+  /*
+   * Returns the value below which a share of the counted values fall, to the precision of a bucket
+   * @param percent - the share, between 0 and 100
+   * @return
+   *      uint64_t - the highest value of the bucket the share ends in (never above the largest
+   *                 value counted), or 0 if nothing was counted
+   */
+  uint64_t percentile(double percent) const;
+
+  /*
+   * Forgets every value counted
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void reset();
+
+  /*
+   * Getters for the number of values counted and the largest of them
+   */
+  uint64_t count() const;
+  uint64_t max() const;
+
+  /*
+   * Returns the bucket a value is counted in
+   * @param value - the value
+   * @return
+   *      int - the bucket, below HISTOGRAM_BUCKETS
+   */
+  static int bucketOf(uint64_t value);
+
+  /*
+   * Returns the highest value a bucket counts
+   * @param bucket - the bucket
+   * @return
+   *      uint64_t - the value
+   */
+  static uint64_t bucketLimit(int bucket);
+
+private:
+  /*
+   * The internal fields associated with Histogram:
+   * m_counts: The number of values counted in each bucket
+   * m_count: The number of values counted
+   * m_max: The largest value counted
+   */
+  uint64_t m_counts[HISTOGRAM_BUCKETS];
+  uint64_t m_count;
+  uint64_t m_max;
+};
+
+#endif // SMASH_HISTOGRAM_H_
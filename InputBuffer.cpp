@@ -0,0 +1,30 @@
+#include <errno.h>
+#include <unistd.h>
+#include "InputBuffer.h"
+
+#define SYS_FAIL -1
+
+InputBuffer::InputBuffer(int fd) : m_fd(fd)
+{
+  setg(m_buffer, m_buffer, m_buffer);
+}
+
+InputBuffer::int_type InputBuffer::underflow()
+{
+  if (gptr() < egptr())
+  {
+    return traits_type::to_int_type(*gptr());
+  }
+  ssize_t count;
+  do
+  {
+    count = read(m_fd, m_buffer, sizeof(m_buffer));
+  } while (count == SYS_FAIL && errno == EINTR);
+  if (count <= 0)
+  {
+    setg(m_buffer, m_buffer, m_buffer);
+    return traits_type::eof();
+  }
+  setg(m_buffer, m_buffer, m_buffer + count);
+  return traits_type::to_int_type(*gptr());
+}
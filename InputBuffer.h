@@ -0,0 +1,58 @@
+#ifndef SMASH_INPUT_BUFFER_H_
+#define SMASH_INPUT_BUFFER_H_
+
+#include <stddef.h>
+#include <streambuf>
+
+// The most bytes read from the input at a time:
+#define INPUT_BUFFER_SIZE (4096)
+
+/*
+ *  InputBuffer Class:
+ *  Reads the shell's input from a descriptor into a buffer of its own, which an istream (std::cin)
+ *  reads the command lines and here-documents through. Unlike stdio's buffer, what it holds is
+ *  known: input that was read already but not used is told by in_avail, so the shell does not
+ *  wait on the descriptor for lines it has.
+ */
+class InputBuffer : public std::streambuf
+{
+public:
+  /*
+   * Constructor of InputBuffer class
+   * @param fd - the descriptor to read
+   * @return
+   *      A new instance of InputBuffer, empty.
+   */
+  explicit InputBuffer(int fd);
+
+  /*
+   * Destructor of the InputBuffer class
+   */
+  ~InputBuffer() = default;
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  InputBuffer(InputBuffer const &) = delete;
+  void operator=(InputBuffer const &) = delete;
+
+protected:
+  /*
+   * Refills the buffer once all of it was used, with what one read of the descriptor returns
+   * Receives no parameters
+   * @return
+   *      int_type - the next character, or EOF at the end of the input or on a failure
+   */
+  int_type underflow() override;
+
+private:
+  /*
+   * The internal fields associated with InputBuffer:
+   * m_fd: The descriptor read
+   * m_buffer: The bytes read and not used yet, between gptr and egptr
+   */
+  int m_fd;
+  char m_buffer[INPUT_BUFFER_SIZE];
+};
+
+#endif // SMASH_INPUT_BUFFER_H_
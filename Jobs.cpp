@@ -0,0 +1,784 @@
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+// The header of this glibc version does not declare C linkage itself:
+extern "C"
+{
+#include <sys/pidfd.h>
+}
+#include "Jobs.h"
+#include "Redirector.h"
+
+// Signals the whole process group of the process (Linux 6.9):
+#ifndef PIDFD_SIGNAL_PROCESS_GROUP
+#define PIDFD_SIGNAL_PROCESS_GROUP (1U << 2)
+#endif
+
+#define SYS_FAIL -1
+
+using namespace std;
+
+/*
+ * Returns the monotonic time
+ * Receives no parameters
+ * @return
+ *      int64_t - the time in nanoseconds
+ */
+static int64_t monotonicNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/*
+ * Converts a time to seconds
+ * @param time - the time
+ * @return
+ *      double - the seconds
+ */
+static double toSeconds(const struct timeval &time)
+{
+  return time.tv_sec + time.tv_usec / 1e6;
+}
+
+int openProcessFd(pid_t pid)
+{
+  int pidfd = pidfd_open(pid, 0);
+  if (pidfd == SYS_FAIL)
+  {
+    perror("smash error: pidfd_open failed");
+  }
+  return moveAboveRedirections(pidfd);
+}
+
+int signalProcess(pid_t pid, int pidfd, int signum)
+{
+  if (pidfd == SYS_FAIL)
+  {
+    return kill(pid, signum);
+  }
+  return pidfd_send_signal(pidfd, signum, nullptr, 0);
+}
+
+int signalProcessGroup(pid_t pid, int pidfd, int signum)
+{
+  pid_t group = getpgid(pid);
+  if (group == SYS_FAIL)
+  {
+    return SYS_FAIL;
+  }
+  if (group == getpgrp())
+  {
+    return signalProcess(pid, pidfd, signum);
+  }
+  // The process fd names a group only if its process leads it, like the first stage of a pipeline:
+  bool isLeader = pidfd != SYS_FAIL && group == pid;
+  if (isLeader && pidfd_send_signal(pidfd, signum, nullptr, PIDFD_SIGNAL_PROCESS_GROUP) == 0)
+  {
+    return 0;
+  }
+  // Otherwise, and before Linux 6.9, the group is signalled by its ID, which stays the same while
+  // the child is not reaped:
+  if (isLeader && errno != EINVAL)
+  {
+    return SYS_FAIL;
+  }
+  return killpg(group, signum);
+}
+
+JobsList::JobEntry::JobEntry(int id, pid_t pid, int pidfd, const char *cmd, const char *settings, int64_t startNs,
+                             bool isStopped, bool isQueued)
+    : m_id(id), m_pid(pid), m_pidfd(pidfd), m_cmd(cmd), m_settings(settings), m_startNs(startNs),
+      m_isStopped(isStopped), m_isQueued(isQueued), m_queuePrev(0), m_queueNext(0) {}
+
+JobsList::JobsList()
+{
+  m_events = moveAboveRedirections(epoll_create1(EPOLL_CLOEXEC));
+  if (m_events == SYS_FAIL)
+  {
+    perror("smash error: epoll_create1 failed");
+  }
+}
+
+JobsList::~JobsList()
+{
+  for (const JobEntry &job : m_slots)
+  {
+    if (job.m_pidfd != SYS_FAIL)
+    {
+      close(job.m_pidfd);
+    }
+  }
+  for (const auto &watched : m_exits)
+  {
+    close(watched.second.first);
+  }
+  if (m_events != SYS_FAIL)
+  {
+    close(m_events);
+  }
+}
+
+void JobsList::addJob(const char *cmd, pid_t pid, int pidfd, bool isStopped, const char *settings)
+{
+  JobEntry &job = newJob(cmd, settings);
+  job.m_pid = pid;
+  job.m_pidfd = pidfd;
+  job.m_isStopped = isStopped;
+  m_byPid[pid] = job.m_id;
+  watchJob(job);
+}
+
+void JobsList::queueJob(const char *cmd, unique_ptr<JobStarter> starter, const char *settings)
+{
+  JobEntry &job = newJob(cmd, settings);
+  job.m_isQueued = true;
+  m_starters[job.m_id] = move(starter);
+  enqueueJob(job);
+  // Room may have been made since the caller looked:
+  admitJobs();
+}
+
+bool JobsList::startQueuedJob(int jobId)
+{
+  dequeueJob(m_slots[jobId]);
+  return startJob(m_slots[jobId]);
+}
+
+void JobsList::setMaxRunning(size_t maxRunning)
+{
+  m_maxRunning = maxRunning;
+  removeFinishedJobs();
+  admitJobs();
+}
+
+size_t JobsList::getMaxRunning() const
+{
+  return m_maxRunning;
+}
+
+bool JobsList::isFull() const
+{
+  return m_maxRunning != 0 && (m_byPid.size() >= m_maxRunning || m_queueSize != 0);
+}
+
+JobsList::JobEntry &JobsList::newJob(const char *cmd, const char *settings)
+{
+  int id = max_id + 1;
+  if (static_cast<size_t>(id) >= m_slots.size())
+  {
+    m_slots.resize(id + 1);
+  }
+  const char *stored = settings == nullptr || *settings == '\0' ? nullptr : intern(settings);
+  m_slots[id] = JobEntry(id, 0, SYS_FAIL, intern(cmd), stored, monotonicNs());
+  max_id = id;
+  return m_slots[id];
+}
+
+const char *JobsList::intern(const char *text)
+{
+  TextView view = {text, strlen(text)};
+  auto found = m_commands.find(view);
+  if (found != m_commands.end())
+  {
+    found->second.uses++;
+    return found->first.text;
+  }
+  // The key points into the copy, which does not move when the table grows:
+  StoredText stored = {unique_ptr<char[]>(new char[view.length + 1]), 1};
+  memcpy(stored.text.get(), text, view.length + 1);
+  view.text = stored.text.get();
+  return m_commands.emplace(view, move(stored)).first->first.text;
+}
+
+void JobsList::release(const char *text)
+{
+  if (text == nullptr)
+  {
+    return;
+  }
+  auto stored = m_commands.find(TextView{text, strlen(text)});
+  if (--stored->second.uses == 0)
+  {
+    m_commands.erase(stored);
+  }
+}
+
+void JobsList::enqueueJob(JobEntry &job)
+{
+  job.m_queuePrev = m_queueTail;
+  job.m_queueNext = 0;
+  (m_queueTail == 0 ? m_queueHead : m_slots[m_queueTail].m_queueNext) = job.m_id;
+  m_queueTail = job.m_id;
+  m_queueSize++;
+}
+
+void JobsList::dequeueJob(JobEntry &job)
+{
+  (job.m_queuePrev == 0 ? m_queueHead : m_slots[job.m_queuePrev].m_queueNext) = job.m_queueNext;
+  (job.m_queueNext == 0 ? m_queueTail : m_slots[job.m_queueNext].m_queuePrev) = job.m_queuePrev;
+  job.m_queuePrev = 0;
+  job.m_queueNext = 0;
+  m_queueSize--;
+}
+
+void JobsList::watchJob(const JobEntry &job)
+{
+  if (job.m_pidfd == SYS_FAIL)
+  {
+    return;
+  }
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = static_cast<uint64_t>(job.m_pid);
+  if (epoll_ctl(m_events, EPOLL_CTL_ADD, job.m_pidfd, &event) == SYS_FAIL)
+  {
+    perror("smash error: epoll_ctl failed");
+  }
+}
+
+bool JobsList::startJob(JobEntry &job)
+{
+  auto found = m_starters.find(job.m_id);
+  unique_ptr<JobStarter> starter = move(found->second);
+  m_starters.erase(found);
+  pid_t pid = starter->start();
+  if (pid == SYS_FAIL)
+  {
+    removeJob(job);
+    return false;
+  }
+  job.m_pid = pid;
+  // Opened before the child can be reaped, so it is bound to this child:
+  job.m_pidfd = openProcessFd(pid);
+  job.m_startNs = monotonicNs();
+  job.m_isQueued = false;
+  m_byPid[pid] = job.m_id;
+  watchJob(job);
+  return true;
+}
+
+void JobsList::admitJobs()
+{
+  while (m_queueHead != 0 && (m_maxRunning == 0 || m_byPid.size() < m_maxRunning))
+  {
+    JobEntry &job = m_slots[m_queueHead];
+    dequeueJob(job);
+    startJob(job);
+  }
+}
+
+void JobsList::printJobsList()
+{
+  removeFinishedJobs();
+  for (int id = 1; id <= max_id; id++)
+  {
+    const JobEntry &job = m_slots[id];
+    if (job.m_id != 0)
+    {
+      std::cout << "[" << job.m_id << "] " << job.m_cmd << (job.m_isQueued ? " (queued)" : "") << endl;
+    }
+  }
+}
+
+void JobsList::printJobsDetails()
+{
+  removeFinishedJobs();
+  int64_t now = monotonicNs();
+  ios::fmtflags flags = cout.flags();
+  streamsize precision = cout.precision();
+  cout << fixed << setprecision(1);
+  for (int id = 1; id <= max_id; id++)
+  {
+    const JobEntry &job = m_slots[id];
+    if (job.m_id == 0)
+    {
+      continue;
+    }
+    cout << "[" << job.m_id << "] ";
+    if (job.m_isQueued)
+    {
+      cout << "- queued ";
+    }
+    else
+    {
+      cout << job.m_pid << " " << (job.m_isStopped ? "stopped " : "running ");
+    }
+    cout << (now - job.m_startNs) / 1e9 << "s " << job.m_cmd;
+    if (job.m_settings != nullptr)
+    {
+      cout << " (" << job.m_settings << ")";
+    }
+    cout << endl;
+  }
+  cout.flags(flags);
+  cout.precision(precision);
+}
+
+void JobsList::printFinishedJobs()
+{
+  removeFinishedJobs();
+  ios::fmtflags flags = cout.flags();
+  streamsize precision = cout.precision();
+  cout << fixed << setprecision(3);
+  for (const FinishedJob &job : m_done)
+  {
+    cout << "[" << job.m_id << "] " << job.m_pid << " ";
+    if (WIFSIGNALED(job.m_status))
+    {
+      cout << "signal " << WTERMSIG(job.m_status);
+    }
+    else
+    {
+      cout << "exit " << WEXITSTATUS(job.m_status);
+    }
+    cout << " real " << job.m_wallNs / 1e9 << "s user " << toSeconds(job.m_usage.ru_utime) << "s sys "
+         << toSeconds(job.m_usage.ru_stime) << "s maxrss " << job.m_usage.ru_maxrss << "KB " << job.m_cmd << endl;
+  }
+  cout.flags(flags);
+  cout.precision(precision);
+}
+
+const deque<JobsList::FinishedJob> &JobsList::getFinishedJobs() const
+{
+  return m_done;
+}
+
+void JobsList::killAllJobs(int64_t graceNs)
+{
+  removeFinishedJobs();
+  // Queued jobs have no process; they are dropped first, so none starts meanwhile:
+  while (m_queueHead != 0)
+  {
+    removeJob(m_slots[m_queueHead]);
+  }
+  if (graceNs > 0)
+  {
+    cout << "smash: sending SIGTERM signal to " << m_byPid.size() << " jobs:" << endl;
+    signalAllJobs(SIGTERM);
+    waitForJobs(monotonicNs() + graceNs);
+    if (m_byPid.empty())
+    {
+      return;
+    }
+    cout << "smash: sending SIGKILL signal to " << m_byPid.size() << " jobs still running after " << graceNs / 1e9
+         << "s:" << endl;
+  }
+  else
+  {
+    cout << "smash: sending SIGKILL signal to " << m_byPid.size() << " jobs:" << endl;
+  }
+  signalAllJobs(SIGKILL);
+}
+
+void JobsList::signalAllJobs(int signum)
+{
+  for (int id = 1; id <= max_id; id++)
+  {
+    const JobEntry &element = m_slots[id];
+    if (element.m_id == 0)
+    {
+      continue;
+    }
+    cout << element.m_pid << ": " << element.m_cmd << endl;
+    if (signalProcessGroup(element.m_pid, element.m_pidfd, signum) == SYS_FAIL)
+    {
+      perror("smash error: kill failed");
+    }
+    // A stopped job would only handle the signal once continued:
+    else if (element.m_isStopped && signum != SIGKILL)
+    {
+      signalProcessGroup(element.m_pid, element.m_pidfd, SIGCONT);
+    }
+  }
+}
+
+void JobsList::waitForJobs(int64_t deadlineNs)
+{
+  while (!m_byPid.empty())
+  {
+    int64_t left = deadlineNs - monotonicNs();
+    if (left <= 0)
+    {
+      return;
+    }
+    epoll_event events[JOBS_EVENT_BATCH];
+    int count = epoll_wait(m_events, events, JOBS_EVENT_BATCH, static_cast<int>((left + 999999) / 1000000));
+    if (count == SYS_FAIL)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      perror("smash error: epoll_wait failed");
+      return;
+    }
+    reapJobs(events, count, 0);
+  }
+}
+
+JobsList::JobEntry *JobsList::getJobById(int jobId)
+{
+  if (jobId <= 0 || jobId > max_id || m_slots[jobId].m_id == 0)
+  {
+    return nullptr;
+  }
+  return &m_slots[jobId];
+}
+
+JobsList::JobEntry *JobsList::getJobByPid(pid_t pid)
+{
+  auto found = m_byPid.find(pid);
+  return found == m_byPid.end() ? nullptr : &m_slots[found->second];
+}
+
+void JobsList::removeJobById(int jobId)
+{
+  if (jobId > 0 && jobId <= max_id && m_slots[jobId].m_id != 0)
+  {
+    removeJob(m_slots[jobId]);
+  }
+}
+
+int JobsList::takeJobById(int jobId)
+{
+  JobEntry &job = m_slots[jobId];
+  int pidfd = job.m_pidfd;
+  if (pidfd != SYS_FAIL)
+  {
+    epoll_ctl(m_events, EPOLL_CTL_DEL, pidfd, nullptr);
+    job.m_pidfd = SYS_FAIL;
+  }
+  removeJob(job);
+  return pidfd;
+}
+
+void JobsList::sigJobById(int jobId, int signum)
+{
+  JobEntry *job = getJobById(jobId);
+  if (!job)
+  {
+    cerr << "smash error: kill: job-id " << jobId << " does not exist" << endl;
+    return;
+  }
+  signalJob(*job, signum);
+}
+
+int JobsList::sigJobRange(int first, int last, int signum)
+{
+  removeFinishedJobs();
+  int count = 0;
+  // A queued job that is taken off the queue may lower the largest ID:
+  for (int id = max(first, 1); id <= min(last, max_id); id++)
+  {
+    if (m_slots[id].m_id != 0)
+    {
+      signalJob(m_slots[id], signum);
+      count++;
+    }
+  }
+  return count;
+}
+
+void JobsList::signalJob(JobEntry &job, int signum)
+{
+  // A queued job has no process yet; one that would be terminated is taken off the queue instead:
+  if (job.m_isQueued)
+  {
+    int jobId = job.m_id;
+    if (signum != SIGKILL && signum != SIGTERM)
+    {
+      cerr << "smash error: kill: job-id " << jobId << " is queued" << endl;
+      return;
+    }
+    removeJob(job);
+    cout << "job-id " << jobId << " was taken off the queue" << endl;
+    return;
+  }
+  if (signalProcessGroup(job.m_pid, job.m_pidfd, signum) == SYS_FAIL)
+  {
+    perror("smash error: kill failed");
+    return;
+  }
+  if (signum == SIGTSTP || signum == SIGSTOP)
+  {
+    job.m_isStopped = true;
+  }
+  else if (signum == SIGCONT)
+  {
+    job.m_isStopped = false;
+  }
+  cout << "signal number " << signum << " was sent to pid " << job.m_pid << endl;
+}
+
+bool JobsList::isEmpty()
+{
+  return m_byPid.empty() && m_queueSize == 0;
+}
+
+size_t JobsList::size() const
+{
+  return m_byPid.size() + m_queueSize;
+}
+
+int JobsList::getMaxId()
+{
+  return max_id;
+}
+
+void JobsList::removeFinishedJobs()
+{
+  if (m_byPid.empty())
+  {
+    return;
+  }
+  epoll_event events[JOBS_EVENT_BATCH];
+  int count;
+  do
+  {
+    count = epoll_wait(m_events, events, JOBS_EVENT_BATCH, 0);
+    reapJobs(events, count, 0);
+  } while (count == JOBS_EVENT_BATCH);
+}
+
+int JobsList::waitForChild(pid_t pid, int pidfd, struct rusage *usage)
+{
+  sigset_t child;
+  sigset_t previous;
+  sigemptyset(&child);
+  sigaddset(&child, SIGCHLD);
+  pthread_sigmask(SIG_BLOCK, &child, &previous);
+  sigset_t waiting = previous;
+  sigdelset(&waiting, SIGCHLD);
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = static_cast<uint64_t>(pid);
+  bool isWatched = pidfd != SYS_FAIL && epoll_ctl(m_events, EPOLL_CTL_ADD, pidfd, &event) != SYS_FAIL;
+  int status = 0;
+  while (true)
+  {
+    // Checked before every wait, since a SIGCHLD that came before the mask was set was consumed:
+    pid_t done = wait4(pid, &status, WUNTRACED | WNOHANG, usage);
+    if (done == pid)
+    {
+      break;
+    }
+    if (done == SYS_FAIL)
+    {
+      perror("smash error: waitpid failed");
+      status = SYS_FAIL;
+      break;
+    }
+    epoll_event events[JOBS_EVENT_BATCH];
+    int count = epoll_pwait(m_events, events, JOBS_EVENT_BATCH, -1, &waiting);
+    if (count == SYS_FAIL && errno != EINTR)
+    {
+      perror("smash error: epoll_pwait failed");
+      if (wait4(pid, &status, WUNTRACED, usage) == SYS_FAIL)
+      {
+        perror("smash error: waitpid failed");
+        status = SYS_FAIL;
+      }
+      break;
+    }
+    reapJobs(events, count, pid);
+  }
+  if (isWatched)
+  {
+    epoll_ctl(m_events, EPOLL_CTL_DEL, pidfd, nullptr);
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  // The child may have been killed by a timeout, whose report comes before the next prompt:
+  printReports();
+  return status;
+}
+
+void JobsList::watchExit(pid_t pid, int pidfd)
+{
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = static_cast<uint64_t>(pid);
+  if (pidfd == SYS_FAIL || epoll_ctl(m_events, EPOLL_CTL_ADD, pidfd, &event) == SYS_FAIL)
+  {
+    if (pidfd != SYS_FAIL)
+    {
+      close(pidfd);
+    }
+    return;
+  }
+  m_exits[pid] = {pidfd, 0};
+}
+
+int64_t JobsList::takeExitTime(pid_t pid)
+{
+  auto found = m_exits.find(pid);
+  if (found == m_exits.end())
+  {
+    return 0;
+  }
+  int64_t exitNs = found->second.second;
+  close(found->second.first);
+  m_exits.erase(found);
+  return exitNs;
+}
+
+void JobsList::waitForInput(int fd, std::streambuf &buffered)
+{
+  // A report left while the shell ran the last line is printed before the wait:
+  printReports();
+  // Lines read along with earlier ones are there already, however long the jobs run:
+  if ((m_byPid.empty() && m_queueSize == 0) || buffered.in_avail() > 0)
+  {
+    return;
+  }
+  // The prompt is shown before the wait, not when the input is read:
+  cout.flush();
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  // No job has PID 0, so the input is told apart from the jobs:
+  event.data.u64 = 0;
+  if (epoll_ctl(m_events, EPOLL_CTL_ADD, fd, &event) == SYS_FAIL)
+  {
+    // A regular file cannot be waited on, and is always ready to be read:
+    if (errno != EPERM)
+    {
+      perror("smash error: epoll_ctl failed");
+    }
+    return;
+  }
+  // SIGCHLD is taken only during the wait, so one that comes between two waits still interrupts the next:
+  sigset_t child;
+  sigset_t previous;
+  sigemptyset(&child);
+  sigaddset(&child, SIGCHLD);
+  pthread_sigmask(SIG_BLOCK, &child, &previous);
+  sigset_t waiting = previous;
+  sigdelset(&waiting, SIGCHLD);
+  bool hasInput = false;
+  while (!hasInput && (!m_byPid.empty() || m_queueSize != 0))
+  {
+    epoll_event events[JOBS_EVENT_BATCH];
+    int count = epoll_pwait(m_events, events, JOBS_EVENT_BATCH, -1, &waiting);
+    if (count == SYS_FAIL && errno != EINTR)
+    {
+      perror("smash error: epoll_pwait failed");
+      break;
+    }
+    for (int i = 0; i < count; i++)
+    {
+      hasInput = hasInput || events[i].data.u64 == 0;
+    }
+    reapJobs(events, count, 0);
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  epoll_ctl(m_events, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void JobsList::watchReports(int fd, Reporter *reporter)
+{
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = JOBS_REPORT_EVENT;
+  if (epoll_ctl(m_events, EPOLL_CTL_ADD, fd, &event) == SYS_FAIL)
+  {
+    perror("smash error: epoll_ctl failed");
+    return;
+  }
+  m_reporter = reporter;
+}
+
+void JobsList::printReports()
+{
+  if (m_reporter != nullptr)
+  {
+    m_reporter->printReports();
+  }
+}
+
+void JobsList::reapJobs(const epoll_event *events, int count, pid_t skip)
+{
+  for (int i = 0; i < count; i++)
+  {
+    if (events[i].data.u64 == JOBS_REPORT_EVENT)
+    {
+      printReports();
+      continue;
+    }
+    pid_t pid = static_cast<pid_t>(events[i].data.u64);
+    auto watched = m_exits.find(pid);
+    if (watched != m_exits.end())
+    {
+      // The process fd stays readable until the child is reaped, so it is taken out of the set:
+      watched->second.second = monotonicNs();
+      epoll_ctl(m_events, EPOLL_CTL_DEL, watched->second.first, nullptr);
+    }
+    auto found = m_byPid.find(pid);
+    if (pid == skip || found == m_byPid.end())
+    {
+      continue;
+    }
+    reapJob(m_slots[found->second]);
+  }
+}
+
+void JobsList::reapJob(JobEntry &job)
+{
+  int status = 0;
+  struct rusage usage = {};
+  pid_t reaped = wait4(job.m_pid, &status, WNOHANG, &usage);
+  if (reaped == 0)
+  {
+    return;
+  }
+  // A job reaped elsewhere is gone as well, but there is nothing to record about it:
+  if (reaped == job.m_pid)
+  {
+    m_done.push_back({job.m_id, job.m_pid, job.m_cmd, status, monotonicNs() - job.m_startNs, usage});
+    if (m_done.size() > JOBS_DONE_HISTORY)
+    {
+      m_done.pop_front();
+    }
+  }
+  removeJob(job);
+}
+
+void JobsList::removeJob(JobEntry &job)
+{
+  // Closing the process fd also takes it out of the event set:
+  if (job.m_pidfd != SYS_FAIL)
+  {
+    close(job.m_pidfd);
+  }
+  bool wasRunning = !job.m_isQueued;
+  if (wasRunning)
+  {
+    m_byPid.erase(job.m_pid);
+  }
+  else if (m_starters.erase(job.m_id) != 0)
+  {
+    dequeueJob(job);
+  }
+  release(job.m_cmd);
+  release(job.m_settings);
+  job = JobEntry();
+  // The largest ID is the one the next job follows, so it drops past the empty slots:
+  while (max_id > 0 && m_slots[max_id].m_id == 0)
+  {
+    max_id--;
+  }
+  if (m_slots.size() > static_cast<size_t>(2 * max_id + 16))
+  {
+    m_slots.resize(max_id + 1);
+  }
+  if (wasRunning)
+  {
+    admitJobs();
+  }
+}
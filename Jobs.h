@@ -0,0 +1,628 @@
+#ifndef SMASH_JOBS_H_
+#define SMASH_JOBS_H_
+
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "TextView.h"
+
+// The most finished jobs taken from the event set at a time:
+#define JOBS_EVENT_BATCH (64)
+// The most finished jobs jobs --done remembers:
+#define JOBS_DONE_HISTORY (100)
+// The event of the reports of another thread; no PID or descriptor of the input is this large:
+#define JOBS_REPORT_EVENT (UINT64_MAX)
+
+/*
+ * Opens a process fd for a child of the shell, above the descriptors a redirection can name.
+ * The fd stays bound to the child after its PID is reused. A failure is printed.
+ * @param pid - the PID of a child that was not reaped yet
+ * @return
+ *      int - the process fd, close-on-exec, or -1
+ */
+int openProcessFd(pid_t pid);
+
+/*
+ * Sends a signal to a process through its process fd, if it has one, so a process that took
+ * its PID cannot receive it. Async-signal-safe.
+ * @param pid - the PID of the process
+ * @param pidfd - its process fd, or -1 to send by PID
+ * @param signum - the signal number
+ * @return
+ *      int - 0, or -1 with errno set
+ */
+int signalProcess(pid_t pid, int pidfd, int signum);
+
+/*
+ * Sends a signal to the whole process group of a child of the shell, so the other stages of its
+ * pipeline and the processes it started receive it too. A child still in the shell's own group
+ * is signalled alone. Async-signal-safe.
+ * @param pid - the PID of the child, which need not lead its group
+ * @param pidfd - its process fd, or -1 to send by process group ID
+ * @param signum - the signal number
+ * @return
+ *      int - 0, or -1 with errno set
+ */
+int signalProcessGroup(pid_t pid, int pidfd, int signum);
+
+/*
+ *  JobStarter Class:
+ *  Starts a job that waited in the admission queue of a JobsList. It holds everything the job
+ *  needs, so starting it does not depend on the line the shell runs meanwhile.
+ */
+class JobStarter
+{
+public:
+  /*
+   * Destructor of the JobStarter class
+   */
+  virtual ~JobStarter() {}
+
+  /*
+   * Starts the job's process. A failure is printed.
+   * Receives no parameters
+   * @return
+   *      pid_t - the PID of the process, a child of the shell that leads its process group, or -1
+   */
+  virtual pid_t start() = 0;
+};
+
+/*
+ *  Reporter Class:
+ *  Prints on the shell's thread what another thread has to report, so it never interleaves with
+ *  the shell's own output. The other thread makes a descriptor readable when it leaves a report,
+ *  and a JobsList that watches the descriptor prints the reports whenever it waits.
+ */
+class Reporter
+{
+public:
+  /*
+   * Destructor of the Reporter class
+   */
+  virtual ~Reporter() {}
+
+  /*
+   * Prints the reports left so far, and makes the descriptor unreadable until the next one
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  virtual void printReports() = 0;
+};
+
+/*
+ *  JobsList Class:
+ *  This class represents the list of jobs in SmallShell.
+ *  Jobs are kept in a table indexed by job ID, with an index from PID to job ID, so a lookup
+ *  by either costs the same however many jobs there are. A job's CMD line is stored once for
+ *  all the jobs started by the same line.
+ *  Every job's process fd is in an epoll set, which becomes readable for exactly the jobs that
+ *  finished, so they are reaped without asking every job, also while the shell waits for a
+ *  command in the foreground or for input. Jobs are reaped only there and by removeFinishedJobs;
+ *  adding and looking up jobs does not poll the set.
+ *  The number of running jobs may be limited; a job added beyond the limit is queued, and the
+ *  queued jobs start in the order they were added as running jobs leave the list.
+ */
+class JobsList
+{
+public:
+  /*
+   *  JobEntry Class:
+   *  This class represents a job in the list of jobs in SmallShell.
+   */
+  class JobEntry
+  {
+  public:
+    /*
+     * Constructor of JobEntry class
+     * Receives no parameters.
+     * @return
+     *      A new instance of JobEntry, an empty slot of the table.
+     */
+    JobEntry()
+        : m_id(0), m_pid(0), m_pidfd(-1), m_cmd(nullptr), m_settings(nullptr), m_startNs(0), m_isStopped(false),
+          m_isQueued(false), m_queuePrev(0), m_queueNext(0) {}
+
+    /*
+     * Constructor of JobEntry class
+     * @param id - the given job's ID
+     * @param pid - the job's PID
+     * @param pidfd - the job's process fd, or -1
+     * @param cmd - the given CMD line, as stored by the list
+     * @param settings - the job's scheduling settings, described and stored by the list, or nullptr
+     * @param startNs - when the job started, on the monotonic clock in nanoseconds
+     * @param isStopped - whether the job has been stopped
+     * @param isQueued - whether the job waits in the admission queue
+     * @return
+     *      A new instance of JobEntry.
+     */
+    JobEntry(int id, pid_t pid, int pidfd, const char *cmd, const char *settings, int64_t startNs,
+             bool isStopped = false, bool isQueued = false);
+
+    /*
+     * Destructor of the JobEntry class
+     */
+    ~JobEntry() = default;
+
+    /*
+     * The internal fields associated with JobEntry:
+     * m_id: The job's ID, or 0 for an empty slot
+     * m_pid: The job's PID, or 0 for a queued job
+     * m_pidfd: The job's process fd, owned by the list, or -1
+     * m_cmd: The job's CMD line, owned by the list
+     * m_settings: The description of the job's scheduling settings, owned by the list, or nullptr
+     * m_startNs: When the job started, or was queued, on the monotonic clock in nanoseconds
+     * m_isStopped: Whether the job has been stopped
+     * m_isQueued: Whether the job waits in the admission queue
+     * m_queuePrev: The ID of the queued job before this one in the queue, or 0
+     * m_queueNext: The ID of the queued job after this one in the queue, or 0
+     */
+    int m_id;
+    pid_t m_pid;
+    int m_pidfd;
+    const char *m_cmd;
+    const char *m_settings;
+    int64_t m_startNs;
+    bool m_isStopped;
+    bool m_isQueued;
+    int m_queuePrev;
+    int m_queueNext;
+  };
+
+  /*
+   *  FinishedJob Struct:
+   *  A job that was reaped, with what it used.
+   *  m_id: The job's ID when it ran
+   *  m_pid: The job's PID
+   *  m_cmd: The job's CMD line
+   *  m_status: The job's wait status
+   *  m_wallNs: How long the job ran, in nanoseconds
+   *  m_usage: The CPU time and memory of the job and the children it waited for
+   */
+  struct FinishedJob
+  {
+    int m_id;
+    pid_t m_pid;
+    std::string m_cmd;
+    int m_status;
+    int64_t m_wallNs;
+    struct rusage m_usage;
+  };
+
+  /*
+   * Constructor of JobsList class
+   * Receives no parameters.
+   * @return
+   *      A new instance of JobsList.
+   */
+  JobsList();
+
+  /*
+   * Destructor of the JobsList class
+   */
+  ~JobsList();
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  JobsList(JobsList const &) = delete;
+  void operator=(JobsList const &) = delete;
+
+  /*
+   * Adds a job to the jobs list
+   * @param cmd - The CMD command received
+   * @param pid - The PID of the job to be added
+   * @param pidfd - The process fd of the job, which the list takes over, or -1
+   * @param isStopped - Whether the job has been stopped
+   * @param settings - The description of the job's scheduling settings, or nullptr for none
+   * @return
+   *    void
+   */
+  void addJob(const char *cmd, pid_t pid, int pidfd, bool isStopped = false, const char *settings = nullptr);
+
+  /*
+   * Adds a job to the jobs list that waits in the admission queue, to start once it is first
+   * in the queue and fewer jobs than the limit run
+   * @param cmd - The CMD command received
+   * @param starter - Starts the job, taken over by the list
+   * @param settings - The description of the job's scheduling settings, or nullptr for none
+   * @return
+   *    void
+   */
+  void queueJob(const char *cmd, std::unique_ptr<JobStarter> starter, const char *settings = nullptr);
+
+  /*
+   * Starts a queued job now, whatever the limit
+   * @param jobId - The job's ID, of a queued job in the list
+   * @return
+   *    bool - false if the job failed to start, and was removed
+   */
+  bool startQueuedJob(int jobId);
+
+  /*
+   * Sets the most jobs that may run at once, starting queued jobs if it grew. Jobs that run
+   * already are left running when it shrinks.
+   * @param maxRunning - The limit, or 0 for none
+   * @return
+   *    void
+   */
+  void setMaxRunning(size_t maxRunning);
+
+  /*
+   * Returns the most jobs that may run at once
+   * Receives no parameters.
+   * @return
+   *    size_t - The limit, or 0 for none
+   */
+  size_t getMaxRunning() const;
+
+  /*
+   * Determines whether a job added now has to be queued: as many jobs as the limit run, or
+   * others wait already
+   * Receives no parameters.
+   * @return
+   *    bool - whether the list is full
+   */
+  bool isFull() const;
+
+  /*
+   * Prints the list of jobs
+   * Receives no parameters.
+   * @return
+   *    void
+   */
+  void printJobsList();
+
+  /*
+   * Prints the list of jobs with their PIDs, whether they run, for how long, and their scheduling settings
+   * Receives no parameters.
+   * @return
+   *    void
+   */
+  void printJobsDetails();
+
+  /*
+   * Prints the most recently finished jobs, oldest first, with how they ended and what they used
+   * Receives no parameters.
+   * @return
+   *    void
+   */
+  void printFinishedJobs();
+
+  /*
+   * Retrieves the most recently finished jobs
+   * Receives no parameters.
+   * @return
+   *    const std::deque<FinishedJob>& - at most JOBS_DONE_HISTORY jobs, oldest first
+   */
+  const std::deque<FinishedJob> &getFinishedJobs() const;
+
+  /*
+   * Kills all jobs in the jobs list, with their process groups; the queued jobs are dropped.
+   * With a grace period, the jobs are sent SIGTERM first (and SIGCONT if stopped), and only those
+   * that did not finish within it are sent SIGKILL, and listed again.
+   * @param graceNs - The grace period in nanoseconds, or 0 to send SIGKILL at once
+   * @return
+   *    void
+   */
+  void killAllJobs(int64_t graceNs = 0);
+
+  /*
+   * Retrieves a specific job according to its ID
+   * @param jobId - The job's ID
+   * @return
+   *    JobEntry* - A pointer to the requested job, valid until a job is added, or nullptr
+   */
+  JobEntry *getJobById(int jobId);
+
+  /*
+   * Retrieves a specific job according to its PID
+   * @param pid - The job's PID
+   * @return
+   *    JobEntry* - A pointer to the requested job, valid until a job is added, or nullptr
+   */
+  JobEntry *getJobByPid(pid_t pid);
+
+  /*
+   * Removes a job from the jobs list according to its ID
+   * @param jobId - The job's ID
+   * @return
+   *    void
+   */
+  void removeJobById(int jobId);
+
+  /*
+   * Removes a job from the jobs list according to its ID, handing its process fd to the caller
+   * @param jobId - The job's ID, of a job in the list
+   * @return
+   *    int - The process fd of the job, which the caller closes, or -1
+   */
+  int takeJobById(int jobId);
+
+  /*
+   * Handles signals sent to a specific job, which are sent to its process group
+   * @param jobId - The job's ID
+   * @param signum - The signal number sent
+   * @return
+   *    void
+   */
+  void sigJobById(int jobId, int signum);
+
+  /*
+   * Sends a signal to every job whose ID is in a range, as sigJobById does
+   * @param first - The first job ID of the range
+   * @param last - The last job ID of the range
+   * @param signum - The signal number sent
+   * @return
+   *    int - The number of jobs in the range
+   */
+  int sigJobRange(int first, int last, int signum);
+
+  /*
+   * Determines whether the list of jobs is empty
+   * Receives no parameters.
+   * @return
+   *    bool - whether the jobs list is empty
+   */
+  bool isEmpty();
+
+  /*
+   * Returns the number of jobs in the list, the queued ones included
+   * Receives no parameters.
+   * @return
+   *    size_t - the number of jobs
+   */
+  size_t size() const;
+
+  /*
+   * Returns the current largest used ID in the jobs list
+   * Receives no parameters.
+   * @return
+   *    int - the current largest used ID in the jobs list
+   */
+  int getMaxId();
+
+  /*
+   * Reaps the jobs that finished, and removes them. Children that are not jobs are left
+   * to whoever waits for them.
+   * Receives no parameters.
+   * @return
+   *    void
+   */
+  void removeFinishedJobs();
+
+  /*
+   * Waits until a child that is not a job finishes or stops, reaping the jobs that finish
+   * meanwhile. SIGCHLD is blocked except during the wait, so a child that stops (which its
+   * process fd does not report) interrupts it, given a SIGCHLD handler is installed.
+   * @param pid - The PID of the child
+   * @param pidfd - The process fd of the child, or -1 to be woken by SIGCHLD only
+   * @param usage - receives the resource usage of the child if it finished, or nullptr
+   * @return
+   *    int - The wait status of the child, or -1 if waiting failed
+   */
+  int waitForChild(pid_t pid, int pidfd, struct rusage *usage = nullptr);
+
+  /*
+   * Notes when a child that is not a job finishes, whenever the list waits on its event set, so
+   * a child reaped only after another one is still timed to its end
+   * @param pid - The PID of the child
+   * @param pidfd - The process fd of the child, owned by the list until the time is taken
+   * @return
+   *    void
+   */
+  void watchExit(pid_t pid, int pidfd);
+
+  /*
+   * Stops watching a child, and returns when it was seen finishing
+   * @param pid - The PID of the child
+   * @return
+   *    int64_t - The monotonic time in nanoseconds, or 0 if it was not seen finishing
+   */
+  int64_t takeExitTime(pid_t pid);
+
+  /*
+   * Waits until the input is ready to be read, reaping the jobs that finish meanwhile, so they
+   * do not linger as zombies and the queued jobs start on time. Returns at once when no job is
+   * alive, when input read earlier is still buffered, or when the input is a regular file, which
+   * is always ready.
+   * @param fd - The descriptor the shell reads its commands from
+   * @param buffered - The buffer the commands are read through from fd
+   * @return
+   *    void
+   */
+  void waitForInput(int fd, std::streambuf &buffered);
+
+  /*
+   * Prints the reports of another thread whenever the list waits on its event set, once the
+   * descriptor is readable, and before every wait for input or for a child. A failure is printed.
+   * @param fd - The descriptor the other thread makes readable when it leaves a report
+   * @param reporter - Prints the reports; it outlives the list's waits
+   * @return
+   *    void
+   */
+  void watchReports(int fd, Reporter *reporter);
+
+private:
+  /*
+   * Puts a new job in the first slot after the largest used ID
+   * @param cmd - The CMD command received
+   * @param settings - The description of the job's scheduling settings, or nullptr for none
+   * @return
+   *    JobEntry& - The job, with its ID, CMD line and settings set
+   */
+  JobEntry &newJob(const char *cmd, const char *settings);
+
+  /*
+   *  StoredText Struct:
+   *  A string stored by intern.
+   *  text: The string, which the key of its entry points into
+   *  uses: The number of jobs using it
+   */
+  struct StoredText
+  {
+    std::unique_ptr<char[]> text;
+    int uses;
+  };
+
+  /*
+   * Stores a string once for all the jobs that use it
+   * @param text - The string
+   * @return
+   *    const char* - The stored string, until every job using it released it
+   */
+  const char *intern(const char *text);
+
+  /*
+   * Releases a string stored by intern for a job
+   * @param text - The stored string, or nullptr
+   * @return
+   *    void
+   */
+  void release(const char *text);
+
+  /*
+   * Adds a job at the end of the admission queue
+   * @param job - The job
+   * @return
+   *    void
+   */
+  void enqueueJob(JobEntry &job);
+
+  /*
+   * Takes a job out of the admission queue, wherever it is in it
+   * @param job - The job, which is in the queue
+   * @return
+   *    void
+   */
+  void dequeueJob(JobEntry &job);
+
+  /*
+   * Adds the process fd of a job to the event set
+   * @param job - The job
+   * @return
+   *    void
+   */
+  void watchJob(const JobEntry &job);
+
+  /*
+   * Starts a queued job that was taken out of the queue, or removes it if that fails
+   * @param job - The job
+   * @return
+   *    bool - whether it started
+   */
+  bool startJob(JobEntry &job);
+
+  /*
+   * Sends a signal to a job and reports it; a queued job is taken off the queue by SIGKILL and
+   * SIGTERM instead
+   * @param job - The job
+   * @param signum - The signal number sent
+   * @return
+   *    void
+   */
+  void signalJob(JobEntry &job, int signum);
+
+  /*
+   * Sends a signal to the process group of every job, listing them
+   * @param signum - The signal number sent
+   * @return
+   *    void
+   */
+  void signalAllJobs(int signum);
+
+  /*
+   * Reaps the jobs that finish until none is left or a deadline passes
+   * @param deadlineNs - The deadline, on the monotonic clock in nanoseconds
+   * @return
+   *    void
+   */
+  void waitForJobs(int64_t deadlineNs);
+
+  /*
+   * Starts the queued jobs, first in first out, while fewer jobs than the limit run
+   * Receives no parameters.
+   * @return
+   *    void
+   */
+  void admitJobs();
+
+  /*
+   * Empties the slot of a job and updates the indexes. A running job that leaves makes room
+   * for a queued one.
+   * @param job - The job
+   * @return
+   *    void
+   */
+  void removeJob(JobEntry &job);
+
+  /*
+   * Reaps a job whose process exited, recording what it used, and removes it. A job that has
+   * not finished yet is left alone.
+   * @param job - The job
+   * @return
+   *    void
+   */
+  void reapJob(JobEntry &job);
+
+  /*
+   * Reaps the finished jobs of events taken from the event set
+   * @param events - The events
+   * @param count - The number of events
+   * @param skip - The PID of a child that is not a job, whose event is ignored
+   * @return
+   *    void
+   */
+  void reapJobs(const epoll_event *events, int count, pid_t skip);
+
+  /*
+   * Prints the reports of another thread, if the list watches them
+   * Receives no parameters
+   * @return
+   *    void
+   */
+  void printReports();
+
+  /*
+   * The internal fields associated with JobsList:
+   * m_events: The epoll set of the process fds of the jobs, each with the job's PID, and of the descriptor
+   *           of the reports, with JOBS_REPORT_EVENT
+   * m_slots: The jobs, indexed by job ID; slot 0 is never used and an empty slot has ID 0
+   * m_byPid: The job ID of every job that started, by PID
+   * m_queueHead: The ID of the queued job to start first, or 0 if none is queued; the queued jobs are
+   *              linked through their slots, so one leaves the queue at once from anywhere in it
+   * m_queueTail: The ID of the queued job to start last, or 0
+   * m_queueSize: The number of queued jobs
+   * m_starters: The starter of every queued job, by job ID
+   * m_maxRunning: The most jobs that may run at once, or 0 for no limit
+   * m_commands: The CMD lines and settings of the jobs, each stored once, with the number of jobs using it,
+   *             by the stored string
+   * m_done: The most recently finished jobs, oldest first
+   * m_exits: The watched children that are not jobs, by PID: their process fd, and when they were seen finishing (or 0)
+   * m_reporter: Prints the reports of another thread, or nullptr
+   * max_id: The largest used jobs ID in the list
+   */
+  int m_events;
+  std::vector<JobEntry> m_slots;
+  std::unordered_map<pid_t, int> m_byPid;
+  int m_queueHead = 0;
+  int m_queueTail = 0;
+  size_t m_queueSize = 0;
+  std::unordered_map<int, std::unique_ptr<JobStarter>> m_starters;
+  size_t m_maxRunning = 0;
+  std::unordered_map<TextView, StoredText, TextViewHash> m_commands;
+  std::deque<FinishedJob> m_done;
+  std::unordered_map<pid_t, std::pair<int, int64_t>> m_exits;
+  Reporter *m_reporter = nullptr;
+  int max_id = 0;
+};
+
+#endif // SMASH_JOBS_H_
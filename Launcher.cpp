@@ -0,0 +1,462 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/ioprio.h>
+#include "Launcher.h"
+
+extern char **environ;
+
+// The signals the new process gets back at their default disposition:
+static const int resetSignals[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGPIPE, SIGCHLD, SIGALRM};
+
+LaunchSpec makeLaunchSpec(char *const *argv)
+{
+  LaunchSpec spec;
+  spec.path = nullptr;
+  spec.argv = argv;
+  spec.stdinFd = -1;
+  spec.stdoutFd = -1;
+  spec.stderrFd = -1;
+  spec.fdActions = nullptr;
+  spec.numFdActions = 0;
+  spec.processGroup = 0;
+  spec.tuning = nullptr;
+  return spec;
+}
+
+/*
+ * Applies scheduling settings to the calling process
+ * @param tuning - the settings
+ * @return
+ *      int - 0 on success, otherwise the errno of the failed setting
+ */
+static int applyTuning(const LaunchTuning &tuning)
+{
+  if (tuning.hasCpus && sched_setaffinity(0, sizeof(tuning.cpus), &tuning.cpus) == -1)
+  {
+    return errno;
+  }
+  if (tuning.hasNice && setpriority(PRIO_PROCESS, 0, tuning.nice) == -1)
+  {
+    return errno;
+  }
+  if (tuning.ioprio != 0 && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, tuning.ioprio) == -1)
+  {
+    return errno;
+  }
+  return 0;
+}
+
+/*
+ * Starts a program with posix_spawn; process group, descriptors and signals are all
+ * set up through spawn attributes and file actions
+ * @param spec - what to run and how
+ * @param pid - set to the PID of the new process
+ * @return
+ *      int - 0 on success, otherwise the errno of the failed step
+ */
+static int spawnProcess(const LaunchSpec &spec, pid_t &pid)
+{
+  posix_spawnattr_t attr;
+  posix_spawn_file_actions_t actions;
+  int err = posix_spawnattr_init(&attr);
+  if (err != 0)
+  {
+    return err;
+  }
+  err = posix_spawn_file_actions_init(&actions);
+  if (err != 0)
+  {
+    posix_spawnattr_destroy(&attr);
+    return err;
+  }
+
+  sigset_t emptyMask;
+  sigset_t defaults;
+  sigemptyset(&emptyMask);
+  sigemptyset(&defaults);
+  for (int sig : resetSignals)
+  {
+    sigaddset(&defaults, sig);
+  }
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+  posix_spawnattr_setpgroup(&attr, spec.processGroup);
+  posix_spawnattr_setsigmask(&attr, &emptyMask);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+
+  const int sources[] = {spec.stdinFd, spec.stdoutFd, spec.stderrFd};
+  for (int target = 0; target < 3 && err == 0; target++)
+  {
+    if (sources[target] != -1 && sources[target] != target)
+    {
+      err = posix_spawn_file_actions_adddup2(&actions, sources[target], target);
+    }
+  }
+  // A dup2 onto the same descriptor clears its close-on-exec flag:
+  for (int i = 0; i < spec.numFdActions && err == 0; i++)
+  {
+    const FdAction &action = spec.fdActions[i];
+    err = action.source == -1 ? posix_spawn_file_actions_addclose(&actions, action.target)
+                              : posix_spawn_file_actions_adddup2(&actions, action.source, action.target);
+  }
+  if (err == 0)
+  {
+    err = spec.path != nullptr ? posix_spawn(&pid, spec.path, &actions, &attr, spec.argv, environ)
+                               : posix_spawnp(&pid, spec.argv[0], &actions, &attr, spec.argv, environ);
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+  return err;
+}
+
+/*
+ * Starts a program with fork and exec. A close-on-exec pipe carries the errno of a
+ * failed step back to the shell, so failures are reported as they are with posix_spawn.
+ * @param spec - what to run and how
+ * @param pid - set to the PID of the new process
+ * @return
+ *      int - 0 on success, otherwise the errno of the failed step
+ */
+static int forkProcess(const LaunchSpec &spec, pid_t &pid)
+{
+  int report[2];
+  if (pipe2(report, O_CLOEXEC) == -1)
+  {
+    return errno;
+  }
+  pid_t child = fork();
+  if (child == -1)
+  {
+    int err = errno;
+    close(report[0]);
+    close(report[1]);
+    return err;
+  }
+  if (child == 0)
+  {
+    sigset_t emptyMask;
+    sigemptyset(&emptyMask);
+    int err = 0;
+    if (setpgid(0, spec.processGroup) == -1 || sigprocmask(SIG_SETMASK, &emptyMask, nullptr) == -1)
+    {
+      err = errno;
+    }
+    if (err == 0 && spec.tuning != nullptr)
+    {
+      err = applyTuning(*spec.tuning);
+    }
+    for (int sig : resetSignals)
+    {
+      signal(sig, SIG_DFL);
+    }
+    const int sources[] = {spec.stdinFd, spec.stdoutFd, spec.stderrFd};
+    for (int target = 0; target < 3 && err == 0; target++)
+    {
+      if (sources[target] != -1 && sources[target] != target && dup2(sources[target], target) == -1)
+      {
+        err = errno;
+      }
+    }
+    for (int i = 0; i < spec.numFdActions && err == 0; i++)
+    {
+      const FdAction &action = spec.fdActions[i];
+      int result;
+      if (action.source == -1)
+      {
+        result = close(action.target) == -1 && errno != EBADF ? -1 : 0;
+      }
+      else if (action.source == action.target)
+      {
+        result = fcntl(action.target, F_SETFD, 0);
+      }
+      else
+      {
+        result = dup2(action.source, action.target);
+      }
+      if (result == -1)
+      {
+        err = errno;
+      }
+    }
+    if (err == 0)
+    {
+      if (spec.path != nullptr)
+      {
+        execv(spec.path, spec.argv);
+      }
+      else
+      {
+        execvp(spec.argv[0], spec.argv);
+      }
+      err = errno;
+    }
+    // If the report cannot be written, the shell sees a program that exited with 127:
+    ssize_t written;
+    do
+    {
+      written = write(report[1], &err, sizeof(err));
+    } while (written == -1 && errno == EINTR);
+    _exit(127);
+  }
+
+  // Also set the group here, so it exists before the caller signals it or adds to it:
+  setpgid(child, spec.processGroup == 0 ? child : spec.processGroup);
+  close(report[1]);
+  int err = 0;
+  ssize_t got;
+  do
+  {
+    got = read(report[0], &err, sizeof(err));
+  } while (got == -1 && errno == EINTR);
+  close(report[0]);
+  if (got == sizeof(err))
+  {
+    waitpid(child, nullptr, 0);
+    return err;
+  }
+  pid = child;
+  return 0;
+}
+
+int launchProcess(const LaunchSpec &spec, LaunchMode mode, pid_t &pid)
+{
+  if (mode == LAUNCH_FORK || spec.tuning != nullptr)
+  {
+    return forkProcess(spec, pid);
+  }
+  return spawnProcess(spec, pid);
+}
+
+LaunchMode defaultLaunchMode()
+{
+  const char *mode = getenv(LAUNCH_MODE_ENV);
+  if (mode != nullptr && strcmp(mode, "fork") == 0)
+  {
+    return LAUNCH_FORK;
+  }
+  return LAUNCH_SPAWN;
+}
+
+LaunchTuning makeLaunchTuning()
+{
+  LaunchTuning tuning;
+  tuning.hasCpus = false;
+  CPU_ZERO(&tuning.cpus);
+  tuning.hasNice = false;
+  tuning.nice = 0;
+  tuning.ioprio = 0;
+  return tuning;
+}
+
+bool isTuned(const LaunchTuning &tuning)
+{
+  return tuning.hasCpus || tuning.hasNice || tuning.ioprio != 0;
+}
+
+/*
+ * Reads a decimal number at the start of a string
+ * @param text - the string; moved past the digits
+ * @param max - the largest number accepted
+ * @param number - set to the number
+ * @return
+ *      bool - false if there are no digits or the number is larger than max
+ */
+static bool readNumber(const char *&text, long max, long &number)
+{
+  if (*text < '0' || *text > '9')
+  {
+    return false;
+  }
+  number = 0;
+  while (*text >= '0' && *text <= '9')
+  {
+    number = number * 10 + (*text++ - '0');
+    if (number > max)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Parses a list of CPU numbers and ranges, such as "0,4-7"
+ * @param text - the list
+ * @param cpus - set to the CPUs of the list
+ * @return
+ *      bool - false if the list is invalid
+ */
+static bool parseCpuList(const char *text, cpu_set_t &cpus)
+{
+  CPU_ZERO(&cpus);
+  while (true)
+  {
+    long first;
+    long last;
+    if (!readNumber(text, CPU_SETSIZE - 1, first))
+    {
+      return false;
+    }
+    last = first;
+    if (*text == '-' && (!readNumber(++text, CPU_SETSIZE - 1, last) || last < first))
+    {
+      return false;
+    }
+    for (long cpu = first; cpu <= last; cpu++)
+    {
+      CPU_SET(cpu, &cpus);
+    }
+    if (*text == '\0')
+    {
+      return true;
+    }
+    if (*text++ != ',')
+    {
+      return false;
+    }
+  }
+}
+
+/*
+ * Parses an I/O priority: "idle", or "be" or "rt" optionally followed by ":LEVEL"
+ * @param text - the priority
+ * @param ioprio - set to the priority, as ioprio_set takes it
+ * @return
+ *      bool - false if the priority is invalid
+ */
+static bool parseIoPriority(const char *text, int &ioprio)
+{
+  if (strcmp(text, "idle") == 0)
+  {
+    ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0);
+    return true;
+  }
+  int ioClass;
+  if (strncmp(text, "be", 2) == 0)
+  {
+    ioClass = IOPRIO_CLASS_BE;
+  }
+  else if (strncmp(text, "rt", 2) == 0)
+  {
+    ioClass = IOPRIO_CLASS_RT;
+  }
+  else
+  {
+    return false;
+  }
+  text += 2;
+  long level = IOPRIO_NORM;
+  if (*text == ':' && !readNumber(++text, IOPRIO_NR_LEVELS - 1, level))
+  {
+    return false;
+  }
+  if (*text != '\0')
+  {
+    return false;
+  }
+  ioprio = IOPRIO_PRIO_VALUE(ioClass, level);
+  return true;
+}
+
+bool parseTuningOption(const char *option, const char *value, LaunchTuning &tuning)
+{
+  if (strcmp(option, "--cpus") == 0)
+  {
+    cpu_set_t cpus;
+    if (!parseCpuList(value, cpus))
+    {
+      return false;
+    }
+    tuning.cpus = cpus;
+    tuning.hasCpus = true;
+    return true;
+  }
+  if (strcmp(option, "--nice") == 0)
+  {
+    const char *digits = value[0] == '-' ? value + 1 : value;
+    long nice;
+    if (!readNumber(digits, 20, nice) || *digits != '\0' || (value[0] != '-' && nice > 19))
+    {
+      return false;
+    }
+    tuning.nice = static_cast<int>(value[0] == '-' ? -nice : nice);
+    tuning.hasNice = true;
+    return true;
+  }
+  if (strcmp(option, "--ioprio") == 0)
+  {
+    return parseIoPriority(value, tuning.ioprio);
+  }
+  return false;
+}
+
+LaunchTuning mergeTuning(const LaunchTuning &base, const LaunchTuning &over)
+{
+  LaunchTuning tuning = base;
+  if (over.hasCpus)
+  {
+    tuning.hasCpus = true;
+    tuning.cpus = over.cpus;
+  }
+  if (over.hasNice)
+  {
+    tuning.hasNice = true;
+    tuning.nice = over.nice;
+  }
+  if (over.ioprio != 0)
+  {
+    tuning.ioprio = over.ioprio;
+  }
+  return tuning;
+}
+
+std::string describeTuning(const LaunchTuning &tuning)
+{
+  std::string description;
+  if (tuning.hasCpus)
+  {
+    description += "cpus ";
+    const char *separator = "";
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+      if (!CPU_ISSET(cpu, &tuning.cpus))
+      {
+        continue;
+      }
+      int last = cpu;
+      while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &tuning.cpus))
+      {
+        last++;
+      }
+      description += separator + std::to_string(cpu);
+      if (last > cpu)
+      {
+        description += "-" + std::to_string(last);
+      }
+      separator = ",";
+      cpu = last;
+    }
+  }
+  if (tuning.hasNice)
+  {
+    description += std::string(description.empty() ? "" : " ") + "nice " + std::to_string(tuning.nice);
+  }
+  if (tuning.ioprio != 0)
+  {
+    static const char *const classes[] = {"none", "rt", "be", "idle"};
+    int ioClass = IOPRIO_PRIO_CLASS(tuning.ioprio);
+    description += std::string(description.empty() ? "" : " ") + "ioprio " + classes[ioClass];
+    if (ioClass != IOPRIO_CLASS_IDLE)
+    {
+      description += ":" + std::to_string(IOPRIO_PRIO_DATA(tuning.ioprio));
+    }
+  }
+  return description;
+}
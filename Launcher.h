@@ -0,0 +1,155 @@
+#ifndef SMASH_LAUNCHER_H_
+#define SMASH_LAUNCHER_H_
+
+#include <sys/types.h>
+#include <sched.h>
+#include <string>
+
+// The environment variable that selects the launch path at startup ("spawn" or "fork"):
+#define LAUNCH_MODE_ENV "SMASH_LAUNCH"
+
+/*
+ * The ways smash can start a program
+ * LAUNCH_SPAWN: posix_spawn, which shares the shell's memory until the exec (clone with CLONE_VM|CLONE_VFORK)
+ * LAUNCH_FORK: fork followed by exec in the child, which copies the shell's page tables
+ */
+enum LaunchMode
+{
+  LAUNCH_SPAWN,
+  LAUNCH_FORK
+};
+
+/*
+ *  FdAction Struct:
+ *  A descriptor to set in the new process.
+ *  source: The descriptor to copy, as numbered in the new process, or -1 to close target
+ *  target: The descriptor to set
+ */
+struct FdAction
+{
+  int source;
+  int target;
+};
+
+/*
+ *  LaunchTuning Struct:
+ *  Scheduling settings for the new process, applied before its program starts. Each one that
+ *  is not set is inherited from the shell.
+ *  hasCpus: Whether cpus is set
+ *  cpus: The CPUs the process may run on
+ *  hasNice: Whether nice is set
+ *  nice: The nice value of the process
+ *  ioprio: The I/O priority of the process, as ioprio_set takes it, or 0 (IOPRIO_CLASS_NONE) if it is not set
+ */
+struct LaunchTuning
+{
+  bool hasCpus;
+  cpu_set_t cpus;
+  bool hasNice;
+  int nice;
+  int ioprio;
+};
+
+/*
+ *  LaunchSpec Struct:
+ *  Everything the new process needs set up before its program starts.
+ *  path: The program to execute, or nullptr to look argv[0] up in PATH
+ *  argv: The arguments of the program, NULL-terminated
+ *  stdinFd: The descriptor to install as standard input, or -1 to inherit it
+ *  stdoutFd: The descriptor to install as standard output, or -1 to inherit it
+ *  stderrFd: The descriptor to install as standard error, or -1 to inherit it
+ *  fdActions: More descriptors to set, in order, after the three above (a command's redirections)
+ *  numFdActions: The number of entries in fdActions
+ *  processGroup: The process group to join, or 0 to lead a new one
+ *  tuning: The scheduling settings of the process, or nullptr to inherit the shell's. posix_spawn
+ *  cannot apply them, so a process with settings is always started with fork and exec.
+ *  The descriptors are expected to be close-on-exec, so only their copies reach the program.
+ */
+struct LaunchSpec
+{
+  const char *path;
+  char *const *argv;
+  int stdinFd;
+  int stdoutFd;
+  int stderrFd;
+  const FdAction *fdActions;
+  int numFdActions;
+  pid_t processGroup;
+  const LaunchTuning *tuning;
+};
+
+/*
+ * Returns a LaunchSpec that runs a program in a new process group with the shell's descriptors,
+ * looking it up in PATH
+ * @param argv - the program and its arguments, NULL-terminated
+ * @return
+ *      LaunchSpec - the spec
+ */
+LaunchSpec makeLaunchSpec(char *const *argv);
+
+/*
+ * Starts a program. The signal mask is emptied and the signals smash handles are reset to
+ * their defaults in the new process. Errors up to and including the exec are reported here,
+ * in the shell, with the same errno on both launch paths.
+ * @param spec - what to run and how
+ * @param mode - the launch path
+ * @param pid - set to the PID of the new process
+ * @return
+ *      int - 0 on success, otherwise the errno of the failed step
+ */
+int launchProcess(const LaunchSpec &spec, LaunchMode mode, pid_t &pid);
+
+/*
+ * Returns the launch path selected by LAUNCH_MODE_ENV, LAUNCH_SPAWN if it is unset
+ * Receives no parameters
+ * @return
+ *      LaunchMode - the launch path
+ */
+LaunchMode defaultLaunchMode();
+
+/*
+ * Returns a LaunchTuning that sets nothing
+ * Receives no parameters
+ * @return
+ *      LaunchTuning - the settings
+ */
+LaunchTuning makeLaunchTuning();
+
+/*
+ * Determines whether a LaunchTuning sets anything
+ * @param tuning - the settings
+ * @return
+ *      bool - whether any setting is set
+ */
+bool isTuned(const LaunchTuning &tuning);
+
+/*
+ * Sets one scheduling setting from a command line option:
+ * "--cpus LIST" (CPU numbers and ranges, such as 0,4-7), "--nice N" (-20 to 19), or
+ * "--ioprio CLASS" (idle, or be or rt optionally followed by :LEVEL, 0 to 7)
+ * @param option - the option
+ * @param value - its value
+ * @param tuning - the settings to change
+ * @return
+ *      bool - false if the option is unknown or its value is invalid; tuning is unchanged then
+ */
+bool parseTuningOption(const char *option, const char *value, LaunchTuning &tuning);
+
+/*
+ * Combines two sets of scheduling settings
+ * @param base - the settings used where over sets nothing
+ * @param over - the settings that win
+ * @return
+ *      LaunchTuning - the combined settings
+ */
+LaunchTuning mergeTuning(const LaunchTuning &base, const LaunchTuning &over);
+
+/*
+ * Describes scheduling settings the way the options set them, such as "cpus 0,4-7 nice 10 ioprio idle"
+ * @param tuning - the settings
+ * @return
+ *      std::string - the description, empty if nothing is set
+ */
+std::string describeTuning(const LaunchTuning &tuning);
+
+#endif // SMASH_LAUNCHER_H_
@@ -0,0 +1,1014 @@
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SMASH_HAVE_X86_SIMD 1
+#endif
+
+// The smallest page size, the granularity at which a read past the end of a line could fault:
+#define SMASH_PAGE_SIZE (4096)
+
+// Lines longer than this have their metacharacters counted before the offset table is allocated:
+#define CLASSIFIER_COUNT_THRESHOLD (256)
+#include "Parser.h"
+
+//-----------------------------------------------Helper Functions-------------------------------------------------------
+
+/*
+ * Checks whether a character is a whitespace separator
+ * @param c - the character
+ * @return
+ *      bool - whether c is whitespace
+ */
+static bool isWhitespace(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+/*
+ *  MetaTable Struct:
+ *  bits: The MetaChar bit of every character, 0 for characters that are not metacharacters
+ */
+struct MetaTable
+{
+  unsigned char bits[256];
+};
+
+/*
+ * Builds the metacharacter lookup table at compile time
+ * Receives no parameters
+ * @return
+ *      MetaTable - the table
+ */
+static constexpr MetaTable makeMetaTable()
+{
+  MetaTable table = {};
+  table.bits[(unsigned char)'>'] = META_GREATER;
+  table.bits[(unsigned char)'<'] = META_LESS;
+  table.bits[(unsigned char)'|'] = META_PIPE;
+  table.bits[(unsigned char)'&'] = META_AMPERSAND;
+  table.bits[(unsigned char)'*'] = META_STAR;
+  table.bits[(unsigned char)'?'] = META_QUESTION;
+  table.bits[(unsigned char)'['] = META_BRACKET;
+  table.bits[(unsigned char)'"'] = META_QUOTE;
+  table.bits[(unsigned char)'\''] = META_QUOTE;
+  return table;
+}
+
+static constexpr MetaTable metaTable = makeMetaTable();
+
+/*
+ * Returns the MetaChar bit of a character
+ * @param c - the character
+ * @return
+ *      unsigned - the bit, or 0 if c is not a metacharacter
+ */
+static inline unsigned metaBit(char c)
+{
+  return metaTable.bits[(unsigned char)c];
+}
+
+/*
+ * Copies the whitespace separated words of a part of a line into the arena, taking quoted text as it is
+ * and removing the quotes
+ * @param cmd_line - the CMD line
+ * @param from - the offset the part starts at
+ * @param to - the offset the part ends at
+ * @param out - the next free byte of the token buffer, advanced past the copied words
+ * @param tokens - the token array the words are appended to
+ * @param quoted - receives, for each word, whether any of it was quoted; nullptr if the line has no quotes
+ * @param numTokens - the number of entries in tokens, advanced by the number of words
+ * @return
+ *      void
+ */
+static void splitWords(const char *cmd_line, size_t from, size_t to, char *&out, char **tokens, bool *quoted,
+                       int &numTokens)
+{
+  // Work on local copies, since writes through out could otherwise alias the counters:
+  char *next = out;
+  int count = numTokens;
+  size_t i = from;
+  while (i < to)
+  {
+    if (isWhitespace(cmd_line[i]))
+    {
+      i++;
+      continue;
+    }
+    tokens[count] = next;
+    bool isQuoted = false;
+    while (i < to && !isWhitespace(cmd_line[i]))
+    {
+      char c = cmd_line[i++];
+      if (quoted == nullptr || (c != '"' && c != '\''))
+      {
+        *next++ = c;
+        continue;
+      }
+      isQuoted = true;
+      while (i < to && cmd_line[i] != c)
+      {
+        *next++ = cmd_line[i++];
+      }
+      i += i < to;
+    }
+    *next++ = '\0';
+    if (quoted != nullptr)
+    {
+      quoted[count] = isQuoted;
+    }
+    count++;
+  }
+  out = next;
+  numTokens = count;
+}
+
+/*
+ * Hashes a CMD line (FNV-1a) without copying it
+ * @param cmd_line - the CMD line
+ * @return
+ *      uint64_t - the hash of the line
+ */
+static uint64_t hashLine(const char *cmd_line)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char *c = (const unsigned char *)cmd_line; *c; c++)
+  {
+    hash ^= *c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+//-----------------------------------------------LineArena-----------------------------------------------
+
+LineArena::LineArena(char *buffer, size_t capacity, bool canGrow) : m_buffer(buffer), m_capacity(capacity), m_used(0),
+                                                                     m_canGrow(canGrow), m_spill(nullptr), m_spilledUsed(0) {}
+
+LineArena::~LineArena()
+{
+  reset();
+}
+
+void *LineArena::allocateFrom(char *buffer, size_t capacity, size_t &used, size_t size, size_t align)
+{
+  uintptr_t base = reinterpret_cast<uintptr_t>(buffer);
+  uintptr_t start = (base + used + align - 1) & ~(uintptr_t)(align - 1);
+  size_t offset = start - base;
+  if (offset > capacity || size > capacity - offset)
+  {
+    return nullptr;
+  }
+  used = offset + size;
+  return buffer + offset;
+}
+
+void *LineArena::allocate(size_t size, size_t align)
+{
+  if (m_spill == nullptr)
+  {
+    void *block = allocateFrom(m_buffer, m_capacity, m_used, size, align);
+    if (block != nullptr || !m_canGrow)
+    {
+      return block;
+    }
+  }
+  else
+  {
+    size_t before = m_spill->used;
+    void *block = allocateFrom(reinterpret_cast<char *>(m_spill + 1), m_spill->capacity, m_spill->used, size, align);
+    if (block != nullptr)
+    {
+      m_spilledUsed += m_spill->used - before;
+      return block;
+    }
+  }
+
+  // Spill into a new heap block, at least twice as large as the previous one:
+  size_t capacity = (m_spill == nullptr ? m_capacity : m_spill->capacity) * 2;
+  if (capacity < size + align)
+  {
+    capacity = size + align;
+  }
+  SpillBlock *spill = static_cast<SpillBlock *>(malloc(sizeof(SpillBlock) + capacity));
+  if (spill == nullptr)
+  {
+    return nullptr;
+  }
+  spill->next = m_spill;
+  spill->capacity = capacity;
+  spill->used = 0;
+  m_spill = spill;
+  void *block = allocateFrom(reinterpret_cast<char *>(spill + 1), capacity, spill->used, size, align);
+  m_spilledUsed += spill->used;
+  return block;
+}
+
+void LineArena::reset()
+{
+  while (m_spill != nullptr)
+  {
+    SpillBlock *next = m_spill->next;
+    free(m_spill);
+    m_spill = next;
+  }
+  m_spilledUsed = 0;
+  m_used = 0;
+}
+
+size_t LineArena::used() const
+{
+  return m_used + m_spilledUsed;
+}
+
+//-----------------------------------------------Classifier-----------------------------------------------
+
+/*
+ * Records the metacharacters of a chunk, given a bitmap of their positions.
+ * When cls has no offset table yet, they are only counted.
+ * @param cmd_line - the CMD line
+ * @param base - the offset of the chunk
+ * @param bits - bit i is set if cmd_line[base + i] is a metacharacter
+ * @param cls - the classification being filled
+ * @return
+ *      void
+ */
+static inline void recordChunk(const char *cmd_line, size_t base, uint32_t bits, LineClass &cls)
+{
+  if (cls.offsets == nullptr)
+  {
+    cls.numOffsets += __builtin_popcount(bits);
+    return;
+  }
+  while (bits)
+  {
+    size_t offset = base + __builtin_ctz(bits);
+    cls.offsets[cls.numOffsets++] = (uint32_t)offset;
+    cls.mask |= metaBit(cmd_line[offset]);
+    bits &= bits - 1;
+  }
+}
+
+/*
+ * Classifies a part of a line one character at a time.
+ * When cls has no offset table yet, the metacharacters are only counted.
+ * @param cmd_line - the CMD line
+ * @param from - the offset to start at
+ * @param length - the length of cmd_line
+ * @param cls - the classification being filled
+ * @return
+ *      void
+ */
+static void classifyScalar(const char *cmd_line, size_t from, size_t length, LineClass &cls)
+{
+  size_t numOffsets = cls.numOffsets;
+  unsigned mask = cls.mask;
+  if (cls.offsets == nullptr)
+  {
+    for (size_t i = from; i < length; i++)
+    {
+      numOffsets += metaBit(cmd_line[i]) != 0;
+    }
+    cls.numOffsets = numOffsets;
+    return;
+  }
+  // The offset is always stored and only kept if the character is a metacharacter:
+  for (size_t i = from; i < length; i++)
+  {
+    unsigned bit = metaBit(cmd_line[i]);
+    cls.offsets[numOffsets] = (uint32_t)i;
+    numOffsets += bit != 0;
+    mask |= bit;
+  }
+  cls.numOffsets = numOffsets;
+  cls.mask = mask;
+}
+
+#ifdef SMASH_HAVE_X86_SIMD
+
+/*
+ * Compares 16 characters with every metacharacter
+ * @param chunk - the characters
+ * @return
+ *      uint32_t - bit i is set if character i is a metacharacter
+ */
+__attribute__((target("sse2"), always_inline)) static inline uint32_t metaBits16(__m128i chunk)
+{
+  __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('>')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('<'))),
+                               _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('|')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('&'))));
+  found = _mm_or_si128(found, _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('*')),
+                                                        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('?'))),
+                                           _mm_cmpeq_epi8(chunk, _mm_set1_epi8('['))));
+  found = _mm_or_si128(found, _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\''))));
+  return (uint32_t)_mm_movemask_epi8(found);
+}
+
+/*
+ * Classifies a part of a line 16 characters at a time.
+ * A tail shorter than 16 characters is read with one full load when that load cannot
+ * cross into the next page (and so cannot fault), and the bits past the end are dropped.
+ * Always inlined, so that the AVX2 classifier gets a VEX encoded copy and does not pay
+ * for switching between AVX and legacy SSE code.
+ * @param cmd_line - the CMD line
+ * @param from - the offset to start at
+ * @param length - the length of cmd_line
+ * @param cls - the classification being filled
+ * @return
+ *      void
+ */
+__attribute__((target("sse2"), always_inline, no_sanitize_address)) static inline void
+classifyFrom16(const char *cmd_line, size_t from, size_t length, LineClass &cls)
+{
+  size_t i = from;
+  for (; i + 16 <= length; i += 16)
+  {
+    uint32_t bits = metaBits16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cmd_line + i)));
+    if (bits)
+    {
+      recordChunk(cmd_line, i, bits, cls);
+    }
+  }
+  if (i == length)
+  {
+    return;
+  }
+  if ((reinterpret_cast<uintptr_t>(cmd_line + i) & (SMASH_PAGE_SIZE - 1)) > SMASH_PAGE_SIZE - 16)
+  {
+    classifyScalar(cmd_line, i, length, cls);
+    return;
+  }
+  uint32_t bits = metaBits16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cmd_line + i)));
+  bits &= (1u << (length - i)) - 1;
+  if (bits)
+  {
+    recordChunk(cmd_line, i, bits, cls);
+  }
+}
+
+/*
+ * Classifies a line 16 characters at a time
+ * @param cmd_line - the CMD line
+ * @param length - the length of cmd_line
+ * @param cls - the classification being filled
+ * @return
+ *      void
+ */
+__attribute__((target("sse2"), no_sanitize_address)) static void classifySse2(const char *cmd_line, size_t length,
+                                                                              LineClass &cls)
+{
+  classifyFrom16(cmd_line, 0, length, cls);
+}
+
+/*
+ * Classifies a line 32 characters at a time
+ * @param cmd_line - the CMD line
+ * @param length - the length of cmd_line
+ * @param cls - the classification being filled
+ * @return
+ *      void
+ */
+__attribute__((target("avx2"), no_sanitize_address)) static void classifyAvx2(const char *cmd_line, size_t length, LineClass &cls)
+{
+  const __m256i greater = _mm256_set1_epi8('>');
+  const __m256i less = _mm256_set1_epi8('<');
+  const __m256i pipe = _mm256_set1_epi8('|');
+  const __m256i ampersand = _mm256_set1_epi8('&');
+  const __m256i star = _mm256_set1_epi8('*');
+  const __m256i question = _mm256_set1_epi8('?');
+  const __m256i bracket = _mm256_set1_epi8('[');
+  const __m256i doubleQuote = _mm256_set1_epi8('"');
+  const __m256i singleQuote = _mm256_set1_epi8('\'');
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32)
+  {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cmd_line + i));
+    __m256i found = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, greater), _mm256_cmpeq_epi8(chunk, less)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, pipe), _mm256_cmpeq_epi8(chunk, ampersand)));
+    found = _mm256_or_si256(found, _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, star),
+                                                                   _mm256_cmpeq_epi8(chunk, question)),
+                                                   _mm256_cmpeq_epi8(chunk, bracket)));
+    found = _mm256_or_si256(found, _mm256_or_si256(_mm256_cmpeq_epi8(chunk, doubleQuote), _mm256_cmpeq_epi8(chunk, singleQuote)));
+    uint32_t bits = (uint32_t)_mm256_movemask_epi8(found);
+    if (bits)
+    {
+      recordChunk(cmd_line, i, bits, cls);
+    }
+  }
+  classifyFrom16(cmd_line, i, length, cls);
+}
+
+#endif
+
+ClassifierIsa bestClassifierIsa()
+{
+#ifdef SMASH_HAVE_X86_SIMD
+  static const ClassifierIsa best = __builtin_cpu_supports("avx2")   ? CLASSIFIER_AVX2
+                                    : __builtin_cpu_supports("sse2") ? CLASSIFIER_SSE2
+                                                                     : CLASSIFIER_SCALAR;
+  return best;
+#else
+  return CLASSIFIER_SCALAR;
+#endif
+}
+
+/*
+ * Runs the classifier of an instruction set over a whole line
+ * @param isa - the instruction set
+ * @param cmd_line - the CMD line
+ * @param length - the length of cmd_line
+ * @param cls - the classification to fill, with mask and numOffsets cleared
+ * @return
+ *      void
+ */
+static void runClassifier(ClassifierIsa isa, const char *cmd_line, size_t length, LineClass &cls)
+{
+  switch (isa)
+  {
+#ifdef SMASH_HAVE_X86_SIMD
+  case CLASSIFIER_AVX2:
+    classifyAvx2(cmd_line, length, cls);
+    break;
+  case CLASSIFIER_SSE2:
+    classifySse2(cmd_line, length, cls);
+    break;
+#endif
+  default:
+    classifyScalar(cmd_line, 0, length, cls);
+    break;
+  }
+}
+
+bool classifyLineWith(ClassifierIsa isa, const char *cmd_line, size_t length, LineArena &arena, LineClass &cls)
+{
+  // A short line gets an offset table large enough for any content. A long line is
+  // counted first, so the table does not grow the arena by four bytes per character:
+  size_t tableSize = length + 1;
+  cls.mask = 0;
+  cls.numOffsets = 0;
+  if (length > CLASSIFIER_COUNT_THRESHOLD)
+  {
+    cls.offsets = nullptr;
+    runClassifier(isa, cmd_line, length, cls);
+    tableSize = cls.numOffsets + 1;
+    cls.numOffsets = 0;
+  }
+  cls.offsets = static_cast<uint32_t *>(arena.allocate(tableSize * sizeof(uint32_t), alignof(uint32_t)));
+  if (cls.offsets == nullptr)
+  {
+    return false;
+  }
+  runClassifier(isa, cmd_line, length, cls);
+  return true;
+}
+
+bool classifyLine(const char *cmd_line, size_t length, LineArena &arena, LineClass &cls)
+{
+  return classifyLineWith(bestClassifierIsa(), cmd_line, length, arena, cls);
+}
+
+//-----------------------------------------------Parser-----------------------------------------------
+
+// Placeholders that mark the end of a pipeline stage in the token array:
+static char pipeMarker[] = "|";
+static char pipeStderrMarker[] = "|&";
+
+/*
+ * Checks whether a position ends a word (whitespace, an operator or the end of the line)
+ * @param cmd_line - the CMD line
+ * @param i - the position
+ * @param end - where the line ends
+ * @return
+ *      bool - whether a word ends at i
+ */
+static bool isWordEnd(const char *cmd_line, size_t i, size_t end)
+{
+  return i >= end || isWhitespace(cmd_line[i]) || cmd_line[i] == '|' || cmd_line[i] == '<' || cmd_line[i] == '>';
+}
+
+/*
+ * Checks whether a character is a decimal digit
+ * @param c - the character
+ * @return
+ *      bool - whether c is a digit
+ */
+static bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+bool parseCommandLine(const char *cmd_line, LineArena &arena, ParsedLine &line)
+{
+  line.args = nullptr;
+  line.numArgs = 0;
+  line.stages = nullptr;
+  line.numStages = 0;
+  line.isBackground = false;
+  line.metaMask = 0;
+  line.numHereDocuments = 0;
+
+  size_t length = strlen(cmd_line);
+  LineClass cls;
+  if (!classifyLine(cmd_line, length, arena, cls))
+  {
+    return false;
+  }
+  line.metaMask = cls.mask;
+
+  // Ignore trailing whitespace and the background sign, which is then the last metacharacter:
+  size_t end = length;
+  while (end > 0 && isWhitespace(cmd_line[end - 1]))
+  {
+    end--;
+  }
+  size_t numOffsets = cls.numOffsets;
+  if (end > 0 && cmd_line[end - 1] == '&')
+  {
+    line.isBackground = true;
+    end--;
+    numOffsets--;
+  }
+
+  // Every character takes at most two bytes (itself and a terminator), and there is
+  // at most one token (a word or a stage marker) per character:
+  char *out = static_cast<char *>(arena.allocate(2 * end + 1, 1));
+  char **tokens = static_cast<char **>(arena.allocate((end + 1) * sizeof(char *)));
+  bool *quoted = nullptr;
+  if (cls.mask & META_QUOTE)
+  {
+    quoted = static_cast<bool *>(arena.allocate((end + 1) * sizeof(bool), alignof(bool)));
+  }
+  if (out == nullptr || tokens == nullptr || ((cls.mask & META_QUOTE) && quoted == nullptr))
+  {
+    return false;
+  }
+  // Every redirection operator adds at most two redirections; wordIndex keeps the index of
+  // the word each one takes as its file (-1 if none), and stageIndex the stage it belongs to:
+  size_t maxRedirections = (cls.mask & (META_GREATER | META_LESS)) ? 2 * numOffsets : 0;
+  Redirection *redirections = nullptr;
+  int *wordIndex = nullptr;
+  int *stageIndex = nullptr;
+  if (maxRedirections > 0)
+  {
+    redirections = static_cast<Redirection *>(arena.allocate(maxRedirections * sizeof(Redirection)));
+    wordIndex = static_cast<int *>(arena.allocate(maxRedirections * sizeof(int), alignof(int)));
+    stageIndex = static_cast<int *>(arena.allocate(maxRedirections * sizeof(int), alignof(int)));
+    if (redirections == nullptr || wordIndex == nullptr || stageIndex == nullptr)
+    {
+      return false;
+    }
+  }
+
+  // Only "|", "<" and ">" split words, and not between quotes; the text between them is split on whitespace:
+  int numTokens = 0;
+  int numPipes = 0;
+  int numRedirections = 0;
+  int waiting = -1;
+  size_t pos = 0;
+  size_t quotedEnd = 0;
+  for (size_t k = 0; k < numOffsets; k++)
+  {
+    size_t offset = cls.offsets[k];
+    char c = cmd_line[offset];
+    if (offset < pos || offset < quotedEnd)
+    {
+      continue;
+    }
+    if (c == '"' || c == '\'')
+    {
+      const char *closing = static_cast<const char *>(memchr(cmd_line + offset + 1, c, end - offset - 1));
+      quotedEnd = closing == nullptr ? end : closing - cmd_line + 1;
+      continue;
+    }
+    if (c != '>' && c != '<' && c != '|')
+    {
+      continue;
+    }
+    // "&>" redirects both outputs, and a lone digit before "<" or ">" names the descriptor:
+    size_t opStart = offset;
+    int fd = c == '<' ? 0 : 1;
+    bool isBoth = false;
+    bool startsWord = offset > pos && (offset - 1 == pos || isWhitespace(cmd_line[offset - 2]));
+    if (c == '>' && startsWord && cmd_line[offset - 1] == '&')
+    {
+      isBoth = true;
+      opStart--;
+    }
+    else if (c != '|' && startsWord && isDigit(cmd_line[offset - 1]))
+    {
+      fd = cmd_line[offset - 1] - '0';
+      opStart--;
+    }
+    splitWords(cmd_line, pos, opStart, out, tokens, quoted, numTokens);
+    if (waiting != -1 && wordIndex[waiting] == numTokens)
+    {
+      wordIndex[waiting] = -1;
+    }
+    waiting = -1;
+    pos = offset + 1;
+
+    if (c == '|')
+    {
+      bool isStderr = pos < end && cmd_line[pos] == '&';
+      pos += isStderr;
+      tokens[numTokens++] = isStderr ? pipeStderrMarker : pipeMarker;
+      numPipes++;
+      continue;
+    }
+    RedirectionType type = c == '<' ? REDIRECT_INPUT : REDIRECT_OVERWRITE;
+    if (c == '>' && pos < end && cmd_line[pos] == '>')
+    {
+      type = REDIRECT_APPEND;
+      pos++;
+    }
+    else if (c == '<' && pos < end && cmd_line[pos] == '<')
+    {
+      bool isString = pos + 1 < end && cmd_line[pos + 1] == '<';
+      type = isString ? REDIRECT_HERESTRING : REDIRECT_HEREDOC;
+      pos += 1 + isString;
+    }
+    else if (!isBoth && pos < end && cmd_line[pos] == '&')
+    {
+      // "n>&m" copies a descriptor and "n>&-" closes it; any other word after ">&" is a file, as after "&>":
+      pos++;
+      if (pos < end && (isDigit(cmd_line[pos]) || cmd_line[pos] == '-') && isWordEnd(cmd_line, pos + 1, end))
+      {
+        Redirection &redirection = redirections[numRedirections];
+        redirection.fd = fd;
+        redirection.type = cmd_line[pos] == '-' ? REDIRECT_CLOSE : REDIRECT_DUP;
+        redirection.target = nullptr;
+        redirection.sourceFd = cmd_line[pos] == '-' ? -1 : cmd_line[pos] - '0';
+        redirection.hereIndex = -1;
+        wordIndex[numRedirections] = -1;
+        stageIndex[numRedirections++] = numPipes;
+        pos++;
+        continue;
+      }
+      isBoth = c == '>';
+    }
+    Redirection &redirection = redirections[numRedirections];
+    redirection.fd = isBoth ? 1 : fd;
+    redirection.type = type;
+    redirection.target = nullptr;
+    redirection.sourceFd = -1;
+    redirection.hereIndex = type == REDIRECT_HEREDOC || type == REDIRECT_HERESTRING ? line.numHereDocuments++ : -1;
+    wordIndex[numRedirections] = numTokens;
+    stageIndex[numRedirections] = numPipes;
+    waiting = numRedirections++;
+    if (isBoth)
+    {
+      Redirection &copy = redirections[numRedirections];
+      copy.fd = 2;
+      copy.type = REDIRECT_DUP;
+      copy.target = nullptr;
+      copy.sourceFd = 1;
+      copy.hereIndex = -1;
+      wordIndex[numRedirections] = -1;
+      stageIndex[numRedirections++] = numPipes;
+    }
+  }
+  splitWords(cmd_line, pos, end, out, tokens, quoted, numTokens);
+  if (waiting != -1 && wordIndex[waiting] == numTokens)
+  {
+    wordIndex[waiting] = -1;
+  }
+  tokens[numTokens] = nullptr;
+
+  line.stages = static_cast<PipelineStage *>(arena.allocate((numPipes + 1) * sizeof(PipelineStage)));
+  if (line.stages == nullptr)
+  {
+    return false;
+  }
+  line.numStages = numPipes + 1;
+  for (int stage = 0; stage <= numPipes; stage++)
+  {
+    line.stages[stage].quoted = nullptr;
+    line.stages[stage].pipeStderr = false;
+    line.stages[stage].redirections = nullptr;
+    line.stages[stage].numRedirections = 0;
+  }
+  if (numPipes == 0 && numRedirections == 0)
+  {
+    line.stages[0].args = tokens;
+    line.stages[0].numArgs = numTokens;
+    line.stages[0].quoted = quoted;
+    line.args = tokens;
+    line.numArgs = numTokens;
+    return true;
+  }
+
+  // Drop the words that are redirection targets, and end every stage with a NULL:
+  int next = 0;
+  while (next < numRedirections && wordIndex[next] == -1)
+  {
+    next++;
+  }
+  for (int r = 0; r < numRedirections; r++)
+  {
+    PipelineStage &owner = line.stages[stageIndex[r]];
+    if (owner.numRedirections++ == 0)
+    {
+      owner.redirections = redirections + r;
+    }
+    if (wordIndex[r] != -1)
+    {
+      redirections[r].target = tokens[wordIndex[r]];
+    }
+  }
+  int stage = 0;
+  int written = 0;
+  int stageStart = 0;
+  line.stages[0].args = tokens;
+  line.stages[0].quoted = quoted;
+  for (int i = 0; i < numTokens; i++)
+  {
+    if (tokens[i] == pipeMarker || tokens[i] == pipeStderrMarker)
+    {
+      line.stages[stage].pipeStderr = tokens[i] == pipeStderrMarker;
+      line.stages[stage].numArgs = written - stageStart;
+      tokens[written++] = nullptr;
+      stage++;
+      stageStart = written;
+      line.stages[stage].args = tokens + written;
+      line.stages[stage].quoted = quoted == nullptr ? nullptr : quoted + written;
+    }
+    else if (next < numRedirections && wordIndex[next] == i)
+    {
+      do
+      {
+        next++;
+      } while (next < numRedirections && wordIndex[next] == -1);
+    }
+    else
+    {
+      if (quoted != nullptr)
+      {
+        quoted[written] = quoted[i];
+      }
+      tokens[written++] = tokens[i];
+    }
+  }
+  line.stages[stage].numArgs = written - stageStart;
+  tokens[written] = nullptr;
+  line.args = tokens;
+  line.numArgs = line.stages[0].numArgs;
+  return true;
+}
+
+//-----------------------------------------------PlanCache-----------------------------------------------
+
+/*
+ * Returns the number of bytes copyParsedLine needs for a parsed line
+ * @param cmd_line - the CMD line the line was parsed from, which is copied with it
+ * @param line - the parsed line
+ * @return
+ *      size_t - the number of bytes
+ */
+static size_t parsedLineSize(const char *cmd_line, const ParsedLine &line)
+{
+  // The arrays come first, each a multiple of the pointer alignment, so no padding is needed between them:
+  static_assert(sizeof(PipelineStage) % alignof(char *) == 0, "stages would misalign the arguments");
+  static_assert(sizeof(Redirection) % alignof(char *) == 0, "redirections would misalign what follows");
+  size_t numArgs = 0;
+  size_t numRedirections = 0;
+  size_t text = strlen(cmd_line) + 1;
+  for (int i = 0; i < line.numStages; i++)
+  {
+    const PipelineStage &stage = line.stages[i];
+    numArgs += stage.numArgs + 1;
+    numRedirections += stage.numRedirections;
+    for (int j = 0; j < stage.numArgs; j++)
+    {
+      text += strlen(stage.args[j]) + 1;
+    }
+    for (int j = 0; j < stage.numRedirections; j++)
+    {
+      text += stage.redirections[j].target == nullptr ? 0 : strlen(stage.redirections[j].target) + 1;
+    }
+  }
+  bool isQuoted = line.numStages > 0 && line.stages[0].quoted != nullptr;
+  return line.numStages * sizeof(PipelineStage) + numArgs * sizeof(char *) + numRedirections * sizeof(Redirection) +
+         (isQuoted ? numArgs * sizeof(bool) : 0) + text;
+}
+
+/*
+ * Copies a string into a buffer
+ * @param text - the string
+ * @param out - the buffer, advanced past the copy
+ * @return
+ *      char* - the copy
+ */
+static char *copyText(const char *text, char *&out)
+{
+  size_t size = strlen(text) + 1;
+  char *copy = static_cast<char *>(memcpy(out, text, size));
+  out += size;
+  return copy;
+}
+
+/*
+ * Copies a parsed line, and the CMD line it was parsed from, into a block of parsedLineSize bytes
+ * @param cmd_line - the CMD line
+ * @param line - the parsed line
+ * @param block - the block, aligned for a pointer
+ * @param copy - receives the copied line
+ * @return
+ *      const char* - the copy of cmd_line
+ */
+static const char *copyParsedLine(const char *cmd_line, const ParsedLine &line, char *block, ParsedLine &copy)
+{
+  size_t numArgs = 0;
+  size_t numRedirections = 0;
+  for (int i = 0; i < line.numStages; i++)
+  {
+    numArgs += line.stages[i].numArgs + 1;
+    numRedirections += line.stages[i].numRedirections;
+  }
+  PipelineStage *stages = reinterpret_cast<PipelineStage *>(block);
+  char **args = reinterpret_cast<char **>(stages + line.numStages);
+  Redirection *redirections = reinterpret_cast<Redirection *>(args + numArgs);
+  bool *quoted = reinterpret_cast<bool *>(redirections + numRedirections);
+  bool isQuoted = line.numStages > 0 && line.stages[0].quoted != nullptr;
+  char *text = reinterpret_cast<char *>(quoted + (isQuoted ? numArgs : 0));
+
+  const char *key = copyText(cmd_line, text);
+  for (int i = 0; i < line.numStages; i++)
+  {
+    const PipelineStage &from = line.stages[i];
+    PipelineStage &to = stages[i];
+    to = from;
+    to.args = args;
+    to.quoted = isQuoted ? quoted : nullptr;
+    to.redirections = from.numRedirections == 0 ? nullptr : redirections;
+    for (int j = 0; j < from.numArgs; j++)
+    {
+      args[j] = copyText(from.args[j], text);
+    }
+    args[from.numArgs] = nullptr;
+    if (isQuoted)
+    {
+      memcpy(quoted, from.quoted, from.numArgs * sizeof(bool));
+      quoted[from.numArgs] = false;
+      quoted += from.numArgs + 1;
+    }
+    for (int j = 0; j < from.numRedirections; j++)
+    {
+      redirections[j] = from.redirections[j];
+      if (from.redirections[j].target != nullptr)
+      {
+        redirections[j].target = copyText(from.redirections[j].target, text);
+      }
+    }
+    args += from.numArgs + 1;
+    redirections += from.numRedirections;
+  }
+  copy = line;
+  copy.stages = stages;
+  copy.args = line.numStages > 0 ? stages[0].args : nullptr;
+  return key;
+}
+
+PlanCache::PlanCache(size_t capacity) : m_entries(capacity), m_newest(-1), m_oldest(-1), m_size(0),
+                                        m_capacity(capacity), m_hits(0), m_misses(0)
+{
+  size_t indexSize = 1;
+  while (indexSize < 2 * capacity)
+  {
+    indexSize *= 2;
+  }
+  m_index.assign(indexSize, -1);
+}
+
+size_t PlanCache::findPosition(uint64_t hash) const
+{
+  size_t mask = m_index.size() - 1;
+  size_t position = hash & mask;
+  while (m_index[position] != -1 && m_entries[m_index[position]].hash != hash)
+  {
+    position = (position + 1) & mask;
+  }
+  return position;
+}
+
+void PlanCache::erasePosition(size_t position)
+{
+  // Linear probing has no tombstones: an entry that probed past the hole is moved back into it.
+  size_t mask = m_index.size() - 1;
+  size_t next = position;
+  while (true)
+  {
+    next = (next + 1) & mask;
+    if (m_index[next] == -1)
+    {
+      break;
+    }
+    size_t home = m_entries[m_index[next]].hash & mask;
+    if (((next - home) & mask) >= ((next - position) & mask))
+    {
+      m_index[position] = m_index[next];
+      position = next;
+    }
+  }
+  m_index[position] = -1;
+}
+
+void PlanCache::unlink(int slot)
+{
+  Entry &entry = m_entries[slot];
+  (entry.newer == -1 ? m_newest : m_entries[entry.newer].older) = entry.older;
+  (entry.older == -1 ? m_oldest : m_entries[entry.older].newer) = entry.newer;
+}
+
+void PlanCache::pushNewest(int slot)
+{
+  Entry &entry = m_entries[slot];
+  entry.newer = -1;
+  entry.older = m_newest;
+  (m_newest == -1 ? m_oldest : m_entries[m_newest].newer) = slot;
+  m_newest = slot;
+}
+
+const CommandPlan *PlanCache::lookup(const char *cmd_line)
+{
+  int slot = m_capacity == 0 ? -1 : m_index[findPosition(hashLine(cmd_line))];
+  if (slot == -1 || strcmp(m_entries[slot].line, cmd_line) != 0)
+  {
+    m_misses++;
+    return nullptr;
+  }
+  m_hits++;
+  if (slot != m_newest)
+  {
+    unlink(slot);
+    pushNewest(slot);
+  }
+  return &m_entries[slot].plan;
+}
+
+const CommandPlan *PlanCache::insert(const char *cmd_line, const CommandPlan &parsed)
+{
+  if (m_capacity == 0)
+  {
+    return nullptr;
+  }
+  size_t size = parsedLineSize(cmd_line, parsed.line);
+  std::unique_ptr<char[]> storage(new char[size]);
+  uint64_t hash = hashLine(cmd_line);
+  size_t position = findPosition(hash);
+  int slot = m_index[position];
+  if (slot != -1)
+  {
+    // Another line with the same hash is replaced:
+    unlink(slot);
+  }
+  else if (m_size < m_capacity)
+  {
+    slot = m_size++;
+  }
+  else
+  {
+    slot = m_oldest;
+    unlink(slot);
+    erasePosition(findPosition(m_entries[slot].hash));
+    position = findPosition(hash);
+  }
+  m_index[position] = slot;
+
+  Entry &entry = m_entries[slot];
+  entry.hash = hash;
+  entry.storage = std::move(storage);
+  entry.line = copyParsedLine(cmd_line, parsed.line, entry.storage.get(), entry.plan.line);
+  entry.plan.kind = parsed.kind;
+  entry.plan.builtin = parsed.builtin;
+  pushNewest(slot);
+  return &entry.plan;
+}
+
+void PlanCache::clear()
+{
+  std::fill(m_index.begin(), m_index.end(), -1);
+  m_newest = -1;
+  m_oldest = -1;
+  m_size = 0;
+}
+
+size_t PlanCache::size() const
+{
+  return m_size;
+}
+
+size_t PlanCache::capacity() const
+{
+  return m_capacity;
+}
+
+unsigned long PlanCache::hits() const
+{
+  return m_hits;
+}
+
+unsigned long PlanCache::misses() const
+{
+  return m_misses;
+}
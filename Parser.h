@@ -0,0 +1,466 @@
+#ifndef SMASH_PARSER_H_
+#define SMASH_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <vector>
+
+#define LINE_ARENA_SIZE (8192)
+#define PLAN_CACHE_CAPACITY (512)
+
+//-------------------------------------Line Arena-------------------------------------
+
+/*
+ *  LineArena Class:
+ *  A bump allocator over a caller-provided buffer. Everything parsed out of a
+ *  single command line lives here, and the whole arena is reset before the next line.
+ *  Short lines fit in the buffer; long lines spill into heap blocks that are freed on reset.
+ */
+class LineArena
+{
+public:
+  /*
+   * Constructor of LineArena class
+   * @param buffer - the memory the arena hands out
+   * @param capacity - the size of buffer in bytes
+   * @param canGrow - whether the arena may spill into the heap once buffer is full
+   * @return
+   *      A new instance of LineArena.
+   */
+  LineArena(char *buffer, size_t capacity, bool canGrow = true);
+
+  /*
+   * Destructor of the LineArena class
+   */
+  ~LineArena();
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  LineArena(LineArena const &) = delete;
+  void operator=(LineArena const &) = delete;
+
+  /*
+   * Allocates a block from the arena
+   * @param size - the number of bytes requested
+   * @param align - the required alignment of the block
+   * @return
+   *      void* - the block, or nullptr if the arena is exhausted and cannot grow
+   */
+  void *allocate(size_t size, size_t align = alignof(void *));
+
+  /*
+   * Releases everything allocated since the last reset
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void reset();
+
+  /*
+   * Returns the number of bytes currently handed out, including alignment padding.
+   * A single buffer of this size (plus the alignment of each allocation) holds them all.
+   * Receives no parameters
+   * @return
+   *      size_t - the number of used bytes
+   */
+  size_t used() const;
+
+private:
+  /*
+   *  SpillBlock Struct:
+   *  A heap block used once the caller's buffer is full. The data follows the header.
+   *  next: The previously spilled block
+   *  capacity: The number of data bytes in the block
+   *  used: The offset of the next free data byte
+   */
+  struct SpillBlock
+  {
+    SpillBlock *next;
+    size_t capacity;
+    size_t used;
+  };
+
+  /*
+   * Allocates a block from a buffer
+   * @param buffer - the buffer
+   * @param capacity - the size of buffer
+   * @param used - the offset of the next free byte in buffer, advanced on success
+   * @param size - the number of bytes requested
+   * @param align - the required alignment of the block
+   * @return
+   *      void* - the block, or nullptr if it does not fit
+   */
+  static void *allocateFrom(char *buffer, size_t capacity, size_t &used, size_t size, size_t align);
+
+  /*
+   * The internal fields associated with LineArena:
+   * m_buffer: The memory backing the arena
+   * m_capacity: The size of m_buffer
+   * m_used: The offset of the next free byte in m_buffer
+   * m_canGrow: Whether the arena may spill into the heap
+   * m_spill: The most recently spilled block, nullptr if the line fit in m_buffer
+   * m_spilledUsed: The number of bytes handed out from spilled blocks
+   */
+  char *m_buffer;
+  size_t m_capacity;
+  size_t m_used;
+  bool m_canGrow;
+  SpillBlock *m_spill;
+  size_t m_spilledUsed;
+};
+
+//-------------------------------------Line Classifier-------------------------------------
+
+/*
+ * The shell metacharacters found by the classifier, one bit each
+ */
+enum MetaChar
+{
+  META_GREATER = 1 << 0,   // '>'
+  META_LESS = 1 << 1,      // '<'
+  META_PIPE = 1 << 2,      // '|'
+  META_AMPERSAND = 1 << 3, // '&'
+  META_STAR = 1 << 4,      // '*'
+  META_QUESTION = 1 << 5,  // '?'
+  META_BRACKET = 1 << 6,   // '['
+  META_QUOTE = 1 << 7      // '"' or '\''
+};
+
+#define META_GLOB (META_STAR | META_QUESTION | META_BRACKET)
+
+/*
+ * The instruction sets the classifier can run on
+ */
+enum ClassifierIsa
+{
+  CLASSIFIER_SCALAR,
+  CLASSIFIER_SSE2,
+  CLASSIFIER_AVX2
+};
+
+/*
+ *  LineClass Struct:
+ *  The metacharacters of a command line, found in a single pass.
+ *  mask: The MetaChar bits of every metacharacter in the line
+ *  offsets: The offset of each metacharacter in the line, in increasing order
+ *  numOffsets: The number of entries in offsets
+ */
+struct LineClass
+{
+  unsigned mask;
+  uint32_t *offsets;
+  size_t numOffsets;
+};
+
+/*
+ * Finds every shell metacharacter of a command line in one vectorized pass,
+ * using the best instruction set the CPU supports
+ * @param cmd_line - the CMD line
+ * @param length - the length of cmd_line
+ * @param arena - the arena that receives the offset table
+ * @param cls - the structure to fill
+ * @return
+ *      bool - false if the arena could not make room for the offset table
+ */
+bool classifyLine(const char *cmd_line, size_t length, LineArena &arena, LineClass &cls);
+
+/*
+ * Same as classifyLine, on a given instruction set (for tests and benchmarks)
+ * @param isa - the instruction set; it must be supported by the CPU
+ * @param cmd_line - the CMD line
+ * @param length - the length of cmd_line
+ * @param arena - the arena that receives the offset table
+ * @param cls - the structure to fill
+ * @return
+ *      bool - false if the arena could not make room for the offset table
+ */
+bool classifyLineWith(ClassifierIsa isa, const char *cmd_line, size_t length, LineArena &arena, LineClass &cls);
+
+/*
+ * Returns the best instruction set the classifier can use on this CPU
+ * Receives no parameters
+ * @return
+ *      ClassifierIsa - the instruction set
+ */
+ClassifierIsa bestClassifierIsa();
+
+//-------------------------------------Parsed Line-------------------------------------
+
+/*
+ * The kinds of redirection smash supports
+ * REDIRECT_INPUT: "n<file" (n defaults to 0)
+ * REDIRECT_OVERWRITE: "n>file" (n defaults to 1)
+ * REDIRECT_APPEND: "n>>file"
+ * REDIRECT_DUP: "n>&m" or "n<&m", which makes n a copy of m
+ * REDIRECT_CLOSE: "n>&-" or "n<&-"
+ * REDIRECT_HEREDOC: "n<<word", which reads the following input lines up to one that is word
+ * REDIRECT_HERESTRING: "n<<<word", which reads word and a newline
+ * "&>file" and "&>>file" are stored as "1>file" (or "1>>file") followed by "2>&1".
+ */
+enum RedirectionType
+{
+  REDIRECT_INPUT,
+  REDIRECT_OVERWRITE,
+  REDIRECT_APPEND,
+  REDIRECT_DUP,
+  REDIRECT_CLOSE,
+  REDIRECT_HEREDOC,
+  REDIRECT_HERESTRING
+};
+
+// The highest descriptor a redirection can name; the shell keeps its own descriptors above it:
+#define REDIRECT_MAX_FD (9)
+
+/*
+ *  Redirection Struct:
+ *  One redirection of a command. A command's redirections apply in the order of the line.
+ *  fd: The descriptor that is redirected
+ *  type: What the descriptor becomes
+ *  target: The file to open for REDIRECT_INPUT, REDIRECT_OVERWRITE and REDIRECT_APPEND, the delimiter of
+ *          REDIRECT_HEREDOC or the word of REDIRECT_HERESTRING; nullptr if it is missing
+ *  sourceFd: The descriptor to copy for REDIRECT_DUP
+ *  hereIndex: The position of a REDIRECT_HEREDOC or REDIRECT_HERESTRING among those of the line
+ */
+struct Redirection
+{
+  int fd;
+  RedirectionType type;
+  const char *target;
+  int sourceFd;
+  int hereIndex;
+};
+
+/*
+ *  PipelineStage Struct:
+ *  One command of a pipeline.
+ *  args: The arguments of the command, NULL-terminated
+ *  numArgs: The number of entries in args
+ *  pipeStderr: Whether the stage is followed by "|&" (its stderr is piped to the next stage instead of its stdout)
+ *  redirections: The redirections of the command, applied after the pipes are connected
+ *  numRedirections: The number of entries in redirections
+ *  quoted: For each of args, whether any of it was quoted, which keeps its wildcards from being expanded;
+ *          nullptr if the line has no quotes
+ */
+struct PipelineStage
+{
+  char **args;
+  int numArgs;
+  const bool *quoted;
+  bool pipeStderr;
+  const Redirection *redirections;
+  int numRedirections;
+};
+
+/*
+ *  ParsedLine Struct:
+ *  The result of splitting a command line. All pointers point into a LineArena.
+ *  args: The arguments of the command (or of the first stage of a pipeline), NULL-terminated
+ *  numArgs: The number of entries in args
+ *  stages: The stages of the pipeline, in order; a line without a pipe has a single stage holding args
+ *  numStages: The number of entries in stages
+ *  isBackground: Whether the line ends with the background sign
+ *  metaMask: The MetaChar bits of every metacharacter in the line
+ *  numHereDocuments: The number of REDIRECT_HEREDOC and REDIRECT_HERESTRING redirections in the line
+ */
+struct ParsedLine
+{
+  char **args;
+  int numArgs;
+  PipelineStage *stages;
+  int numStages;
+  bool isBackground;
+  unsigned metaMask;
+  int numHereDocuments;
+};
+
+/*
+ * Splits a command line into arguments. The line is classified once by classifyLine,
+ * and only the metacharacters it finds are visited; the text between them is split on whitespace.
+ * Pipes and redirections are recognized even when they are not surrounded by spaces, and
+ * a trailing background sign is removed. Every "|" or "|&" starts a new pipeline stage.
+ * Text between single or double quotes is taken as it is, spaces and metacharacters included, and the
+ * quotes are removed; an unterminated quote runs to the end of the line.
+ * A redirection takes the word after it as its file (the delimiter of "<<", the string of "<<<");
+ * a single digit right before it (after whitespace) names the descriptor. The bodies of here-documents
+ * are not part of the line; they are read by whoever runs it.
+ * @param cmd_line - the CMD line received
+ * @param arena - the arena that receives the tokens
+ * @param line - the structure to fill
+ * @return
+ *      bool - false if the arena could not make room for the line
+ */
+bool parseCommandLine(const char *cmd_line, LineArena &arena, ParsedLine &line);
+
+//-------------------------------------Plan Cache-------------------------------------
+
+/*
+ * The command a parsed line dispatches to
+ */
+enum CommandKind
+{
+  CMD_EMPTY,
+  CMD_REDIRECTION,
+  CMD_PIPE,
+  CMD_BUILTIN,
+  CMD_EXTERNAL
+};
+
+struct BuiltinEntry;
+
+/*
+ *  CommandPlan Struct:
+ *  A fully parsed command line, ready to be executed.
+ *  line: The arguments, redirections, background sign and pipe split of the line
+ *  kind: The command the line dispatches to
+ *  builtin: The built-in command to run when kind is CMD_BUILTIN
+ */
+struct CommandPlan
+{
+  ParsedLine line;
+  CommandKind kind;
+  const BuiltinEntry *builtin;
+};
+
+/*
+ *  PlanCache Class:
+ *  An LRU cache of command plans keyed by the raw CMD line, so lines that repeat
+ *  (scripts, loops) skip parsing and dispatch. The slots of the plans and the hash index are
+ *  allocated up front; a miss allocates only the block the plan is copied into.
+ */
+class PlanCache
+{
+public:
+  /*
+   * Constructor of PlanCache class
+   * @param capacity - the maximal number of cached plans
+   * @return
+   *      A new instance of PlanCache.
+   */
+  explicit PlanCache(size_t capacity = PLAN_CACHE_CAPACITY);
+
+  /*
+   * Destructor of the PlanCache class
+   */
+  ~PlanCache() = default;
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  PlanCache(PlanCache const &) = delete;
+  void operator=(PlanCache const &) = delete;
+
+  /*
+   * Looks up the plan of a CMD line and marks it as the most recently used.
+   * Counts a hit or a miss.
+   * @param cmd_line - the CMD line received
+   * @return
+   *      const CommandPlan* - the cached plan, or nullptr on a miss
+   */
+  const CommandPlan *lookup(const char *cmd_line);
+
+  /*
+   * Adds the plan of a CMD line, evicting the least recently used plan if the cache is full.
+   * The parsed line is copied, with the CMD line itself, into a single block of the exact size it takes,
+   * so the arena it was parsed in can be reset.
+   * @param cmd_line - the CMD line received
+   * @param parsed - the plan of cmd_line
+   * @return
+   *      const CommandPlan* - the cached plan, or nullptr if it could not be added
+   */
+  const CommandPlan *insert(const char *cmd_line, const CommandPlan &parsed);
+
+  /*
+   * Removes all the cached plans. The counters are kept, and so is the memory of the plans
+   * until their slots are reused, as the line being run may be using it.
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void clear();
+
+  /*
+   * Getters for the size and the counters of the cache
+   */
+  size_t size() const;
+  size_t capacity() const;
+  unsigned long hits() const;
+  unsigned long misses() const;
+
+private:
+  /*
+   *  Entry Struct:
+   *  hash: The hash of line
+   *  line: The raw CMD line (the key), kept in storage
+   *  storage: The memory the plan and its key live in
+   *  plan: The cached plan
+   *  newer: The slot of the entry used right after this one, -1 for the most recently used
+   *  older: The slot of the entry used right before this one, -1 for the least recently used
+   */
+  struct Entry
+  {
+    uint64_t hash;
+    const char *line;
+    std::unique_ptr<char[]> storage;
+    CommandPlan plan;
+    int newer;
+    int older;
+  };
+
+  /*
+   * Finds the position of a hash in the index
+   * @param hash - the hash of a CMD line
+   * @return
+   *      size_t - the position holding the slot of hash, or the empty position where it would go
+   */
+  size_t findPosition(uint64_t hash) const;
+
+  /*
+   * Removes the entry at a position of the index, moving back the entries that probed past it
+   * @param position - the position
+   * @return
+   *      void
+   */
+  void erasePosition(size_t position);
+
+  /*
+   * Takes an entry out of the LRU order
+   * @param slot - the slot of the entry
+   * @return
+   *      void
+   */
+  void unlink(int slot);
+
+  /*
+   * Makes an entry the most recently used
+   * @param slot - the slot of the entry
+   * @return
+   *      void
+   */
+  void pushNewest(int slot);
+
+  /*
+   * The internal fields associated with PlanCache:
+   * m_entries: The slots of the cached plans, allocated up front; the first m_size are in use
+   * m_index: An open-addressing table from the hash of a CMD line to its slot, -1 where empty;
+   *          its size is a power of two at least twice the capacity
+   * m_newest: The slot of the most recently used entry, -1 if the cache is empty
+   * m_oldest: The slot of the least recently used entry, -1 if the cache is empty
+   * m_size: The number of cached plans
+   * m_capacity: The maximal number of cached plans
+   * m_hits: The number of lookups that found a plan
+   * m_misses: The number of lookups that did not find a plan
+   */
+  std::vector<Entry> m_entries;
+  std::vector<int> m_index;
+  int m_newest;
+  int m_oldest;
+  size_t m_size;
+  size_t m_capacity;
+  unsigned long m_hits;
+  unsigned long m_misses;
+};
+
+#endif // SMASH_PARSER_H_
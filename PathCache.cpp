@@ -0,0 +1,201 @@
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <iterator>
+#include "PathCache.h"
+
+PathCache::PathCache() : m_firstRelative(SIZE_MAX), m_checkedDirs(0), m_isLineStarted(false), m_hits(0), m_misses(0)
+{
+  syncPath();
+}
+
+void PathCache::syncPath()
+{
+  const char *path = getenv("PATH");
+  if (path == nullptr)
+  {
+    path = PATH_CACHE_DEFAULT_PATH;
+  }
+  if (!m_dirs.empty() && m_path == path)
+  {
+    return;
+  }
+  m_path = path;
+  m_dirs.clear();
+  m_entries.clear();
+  m_firstRelative = SIZE_MAX;
+  m_checkedDirs = 0;
+  const char *start = path;
+  while (true)
+  {
+    const char *end = strchr(start, ':');
+    size_t length = end == nullptr ? strlen(start) : (size_t)(end - start);
+    Dir dir;
+    dir.name = length == 0 ? std::string(".") : std::string(start, length);
+    dir.exists = false;
+    dir.mtime.tv_sec = 0;
+    dir.mtime.tv_nsec = 0;
+    dir.isRacy = true;
+    if (dir.name[0] != '/' && m_firstRelative == SIZE_MAX)
+    {
+      m_firstRelative = m_dirs.size();
+    }
+    m_dirs.push_back(dir);
+    if (end == nullptr)
+    {
+      break;
+    }
+    start = end + 1;
+  }
+}
+
+bool PathCache::refreshDir(Dir &dir, time_t now)
+{
+  struct stat st;
+  bool exists = stat(dir.name.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+  bool changed = dir.isRacy || exists != dir.exists ||
+                 (exists && (st.st_mtim.tv_sec != dir.mtime.tv_sec || st.st_mtim.tv_nsec != dir.mtime.tv_nsec));
+  dir.exists = exists;
+  dir.isRacy = false;
+  if (exists)
+  {
+    // File system timestamps advance in clock ticks, so a change made in the same second
+    // may not move mtime; such a directory is checked again on every line until it settles:
+    dir.mtime = st.st_mtim;
+    dir.isRacy = st.st_mtim.tv_sec >= now - 1;
+  }
+  return changed;
+}
+
+void PathCache::search(const char *name, Entry &entry) const
+{
+  entry.hits = 0;
+  entry.path.clear();
+  std::string candidate;
+  for (size_t i = 0; i < m_dirs.size(); i++)
+  {
+    if (!m_dirs[i].exists)
+    {
+      continue;
+    }
+    candidate = m_dirs[i].name;
+    candidate += '/';
+    candidate += name;
+    struct stat st;
+    if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(candidate.c_str(), X_OK) == 0)
+    {
+      entry.path = candidate;
+      entry.dirIndex = i;
+      return;
+    }
+  }
+  entry.dirIndex = m_dirs.size();
+}
+
+void PathCache::checkDirs(size_t count)
+{
+  if (count <= m_checkedDirs)
+  {
+    return;
+  }
+  time_t now = time(nullptr);
+  size_t changed = SIZE_MAX;
+  for (size_t i = m_checkedDirs; i < count; i++)
+  {
+    if (refreshDir(m_dirs[i], now) && changed == SIZE_MAX)
+    {
+      changed = i;
+    }
+  }
+  m_checkedDirs = count;
+  // A change in directory i drops every entry whose search reached directory i:
+  if (changed != SIZE_MAX)
+  {
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+      it = it->second.dirIndex >= changed ? m_entries.erase(it) : std::next(it);
+    }
+  }
+}
+
+const char *PathCache::lookup(const char *name)
+{
+  if (strchr(name, '/') != nullptr)
+  {
+    return name;
+  }
+  if (!m_isLineStarted)
+  {
+    syncPath();
+    m_isLineStarted = true;
+  }
+
+  // An entry holds while none of the directories searched for it changed:
+  TextView key = {name, strlen(name)};
+  auto found = m_entries.find(key);
+  if (found != m_entries.end())
+  {
+    size_t searched = std::min(found->second.dirIndex + 1, m_dirs.size());
+    if (searched > m_checkedDirs)
+    {
+      checkDirs(searched);
+      found = m_entries.find(key);
+    }
+  }
+  if (found != m_entries.end())
+  {
+    m_hits++;
+    found->second.hits++;
+    return found->second.path.empty() ? nullptr : found->second.path.c_str();
+  }
+  checkDirs(m_dirs.size());
+
+  m_misses++;
+  Entry entry;
+  search(name, entry);
+  // A search that reached a relative directory depends on the current directory, so it is not kept:
+  if (entry.dirIndex >= m_firstRelative)
+  {
+    m_uncached = entry.path;
+    return m_uncached.empty() ? nullptr : m_uncached.c_str();
+  }
+  entry.name.reset(new char[key.length + 1]);
+  memcpy(entry.name.get(), name, key.length + 1);
+  key.text = entry.name.get();
+  Entry &stored = m_entries.emplace(key, std::move(entry)).first->second;
+  return stored.path.empty() ? nullptr : stored.path.c_str();
+}
+
+void PathCache::startLine()
+{
+  m_checkedDirs = 0;
+  m_isLineStarted = false;
+}
+
+void PathCache::forget(const char *name)
+{
+  m_entries.erase(TextView{name, strlen(name)});
+}
+
+void PathCache::clear()
+{
+  m_entries.clear();
+}
+
+const std::unordered_map<TextView, PathCache::Entry, TextViewHash> &PathCache::entries() const
+{
+  return m_entries;
+}
+
+unsigned long PathCache::hits() const
+{
+  return m_hits;
+}
+
+unsigned long PathCache::misses() const
+{
+  return m_misses;
+}
@@ -0,0 +1,180 @@
+#ifndef SMASH_PATH_CACHE_H_
+#define SMASH_PATH_CACHE_H_
+
+#include <stddef.h>
+#include <time.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "TextView.h"
+
+// The search path used when PATH is unset, as execvp does:
+#define PATH_CACHE_DEFAULT_PATH "/bin:/usr/bin"
+
+/*
+ *  PathCache Class:
+ *  Remembers where each command name was found in PATH, and which names were not found,
+ *  so launching a program does not search PATH again. An entry is dropped when PATH changes,
+ *  or when the modification time of a PATH directory it was searched in changes, or when the
+ *  program it names fails to launch (see forget). The directories are checked at most once
+ *  per command line (see startLine), and the entries are found by the name as given, so a
+ *  lookup answered from the cache costs no system call after the first and no allocation.
+ */
+class PathCache
+{
+public:
+  /*
+   *  Entry Struct:
+   *  name: The command name, which the key of the entry points into
+   *  path: The program the name runs, empty if the name was not found
+   *  dirIndex: The index of the PATH directory the program is in (the number of directories if it was not found)
+   *  hits: The number of lookups answered by the entry
+   */
+  struct Entry
+  {
+    std::unique_ptr<char[]> name;
+    std::string path;
+    size_t dirIndex;
+    unsigned long hits;
+  };
+
+  /*
+   * Constructor of PathCache class
+   * Receives no parameters
+   * @return
+   *      A new instance of PathCache.
+   */
+  PathCache();
+
+  /*
+   * Destructor of the PathCache class
+   */
+  ~PathCache() = default;
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  PathCache(PathCache const &) = delete;
+  void operator=(PathCache const &) = delete;
+
+  /*
+   * Finds the program a command name runs, searching PATH only if the name is not cached.
+   * Counts a hit or a miss. Names that contain a '/' are not looked up.
+   * @param name - the command name
+   * @return
+   *      const char* - the program to execute, valid until the cache changes, or nullptr if
+   *                    the name is not found in PATH
+   */
+  const char *lookup(const char *name);
+
+  /*
+   * Starts a new command line: the next lookups check the directories of PATH again, each at
+   * most once until the next call, and see a change to PATH.
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void startLine();
+
+  /*
+   * Drops the entry of a command name, so the next lookup searches PATH again. For a program that
+   * could not be run where it was found, which a change to the file itself (not to its directory) causes.
+   * @param name - the command name
+   * @return
+   *      void
+   */
+  void forget(const char *name);
+
+  /*
+   * Removes all the entries. The counters are kept.
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void clear();
+
+  /*
+   * Getters for the entries and the counters of the cache
+   */
+  const std::unordered_map<TextView, Entry, TextViewHash> &entries() const;
+  unsigned long hits() const;
+  unsigned long misses() const;
+
+private:
+  /*
+   *  Dir Struct:
+   *  name: The directory, as written in PATH ("." for an empty element)
+   *  exists: Whether the directory existed when it was last checked
+   *  mtime: The modification time of the directory when it was last checked
+   *  isRacy: Whether mtime was too recent to prove that nothing changed since (the clock may not have ticked yet)
+   */
+  struct Dir
+  {
+    std::string name;
+    bool exists;
+    struct timespec mtime;
+    bool isRacy;
+  };
+
+  /*
+   * Reloads the directories and drops every entry if PATH changed since they were read
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void syncPath();
+
+  /*
+   * Checks whether a directory changed since it was last checked, and records its current state.
+   * A racy directory is checked again on the next line, not on every lookup.
+   * @param dir - the directory
+   * @param now - the current time, in seconds
+   * @return
+   *      bool - whether the directory may have changed
+   */
+  static bool refreshDir(Dir &dir, time_t now);
+
+  /*
+   * Searches PATH for a command name
+   * @param name - the command name
+   * @param entry - set to the result of the search
+   * @return
+   *      void
+   */
+  void search(const char *name, Entry &entry) const;
+
+  /*
+   * Checks the directories of PATH up to an index that were not checked during this line, and drops
+   * the entries whose search reached a directory that changed
+   * @param count - the number of directories, from the first, that must be checked
+   * @return
+   *      void
+   */
+  void checkDirs(size_t count);
+
+  /*
+   * The internal fields associated with PathCache:
+   * m_path: The value of PATH the directories were read from
+   * m_dirs: The directories of PATH, in search order
+   * m_firstRelative: The index of the first relative directory of PATH (whose content depends on the
+   *                  current directory), SIZE_MAX if there is none
+   * m_checkedDirs: The number of directories, from the first, checked since the line started
+   * m_isLineStarted: Whether PATH was read since the line started
+   * m_entries: Maps a command name, viewed in its entry, to where it was found
+   * m_hits: The number of lookups answered from the cache
+   * m_misses: The number of lookups that searched PATH
+   * m_uncached: The result of the last search that could not be kept
+   */
+  std::string m_path;
+  std::vector<Dir> m_dirs;
+  size_t m_firstRelative;
+  size_t m_checkedDirs;
+  bool m_isLineStarted;
+  std::unordered_map<TextView, Entry, TextViewHash> m_entries;
+  unsigned long m_hits;
+  unsigned long m_misses;
+  std::string m_uncached;
+};
+
+#endif // SMASH_PATH_CACHE_H_
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <iostream>
+#include "Redirector.h"
+
+int moveAboveRedirections(int fd)
+{
+  if (fd == -1 || fd >= REDIRECT_FIRST_SHELL_FD)
+  {
+    return fd;
+  }
+  int moved = fcntl(fd, F_DUPFD_CLOEXEC, REDIRECT_FIRST_SHELL_FD);
+  close(fd);
+  if (moved == -1)
+  {
+    perror("smash error: fcntl failed");
+  }
+  return moved;
+}
+
+int createMemoryFile(const char *name)
+{
+  int fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd == -1)
+  {
+    perror("smash error: memfd_create failed");
+    return -1;
+  }
+  return moveAboveRedirections(fd);
+}
+
+/*
+ * Writes data to a here-document. On failure the failure is printed and the memfd is closed.
+ * @param fd - the memfd, or -1 to discard the data
+ * @param data - the data
+ * @param length - the length of data
+ * @return
+ *      void
+ */
+static void writeHereDocument(int &fd, const char *data, size_t length)
+{
+  while (fd != -1 && length > 0)
+  {
+    ssize_t written = write(fd, data, length);
+    if (written == -1 && errno == EINTR)
+    {
+      continue;
+    }
+    if (written == -1)
+    {
+      perror("smash error: write failed");
+      close(fd);
+      fd = -1;
+      return;
+    }
+    data += written;
+    length -= written;
+  }
+}
+
+/*
+ * Seals a written here-document so nothing can change it, and rewinds it for its reader
+ * @param fd - the memfd, or -1
+ * @return
+ *      int - the memfd, or -1
+ */
+static int sealHereDocument(int fd)
+{
+  if (fd == -1)
+  {
+    return -1;
+  }
+  // A kernel without seals still gets a working here-document:
+  fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+  lseek(fd, 0, SEEK_SET);
+  return fd;
+}
+
+int readHereDocument(std::istream &input, const char *delimiter)
+{
+  int fd = createMemoryFile("smash-here-document");
+  size_t delimiterLength = strlen(delimiter);
+  // The buffer is emptied while a line as long as the delimiter still fits, so that line is never split:
+  std::vector<char> buffer(std::max<size_t>(HERE_DOCUMENT_BUFFER, delimiterLength + 2));
+  size_t used = 0;
+  bool isLineStart = true;
+  while (true)
+  {
+    if (buffer.size() - used < delimiterLength + 2)
+    {
+      writeHereDocument(fd, buffer.data(), used);
+      used = 0;
+    }
+    char *line = buffer.data() + used;
+    input.getline(line, buffer.size() - used);
+    std::streamsize count = input.gcount();
+    if (count == 0)
+    {
+      break;
+    }
+    // A line that did not fit is stored in pieces; only a whole line can be the delimiter:
+    bool isPiece = input.fail();
+    size_t stored = count - (!isPiece && !input.eof());
+    if (isLineStart && !isPiece && stored == delimiterLength && memcmp(line, delimiter, stored) == 0)
+    {
+      break;
+    }
+    used += stored;
+    if (isPiece)
+    {
+      input.clear();
+    }
+    else
+    {
+      buffer[used++] = '\n';
+    }
+    isLineStart = !isPiece;
+  }
+  writeHereDocument(fd, buffer.data(), used);
+  return sealHereDocument(fd);
+}
+
+int makeHereString(const char *word)
+{
+  int fd = createMemoryFile("smash-here-document");
+  writeHereDocument(fd, word, strlen(word));
+  writeHereDocument(fd, "\n", 1);
+  return sealHereDocument(fd);
+}
+
+Redirector::Redirector() {}
+
+Redirector::~Redirector()
+{
+  restoreShell();
+  for (int fd : m_opened)
+  {
+    close(fd);
+  }
+}
+
+bool Redirector::open(const Redirection *redirections, int count, const int *hereDocuments)
+{
+  for (int i = 0; i < count; i++)
+  {
+    const Redirection &redirection = redirections[i];
+    if (redirection.type == REDIRECT_DUP || redirection.type == REDIRECT_CLOSE)
+    {
+      m_actions.push_back({redirection.sourceFd, redirection.fd});
+      continue;
+    }
+    if (redirection.target == nullptr)
+    {
+      errno = ENOENT;
+      perror("smash error: open failed");
+      return false;
+    }
+    if (redirection.type == REDIRECT_HEREDOC || redirection.type == REDIRECT_HERESTRING)
+    {
+      // A here-document that could not be made was reported when it was read:
+      int fd = hereDocuments != nullptr ? hereDocuments[redirection.hereIndex] : -1;
+      if (fd == -1)
+      {
+        return false;
+      }
+      m_actions.push_back({fd, redirection.fd});
+      continue;
+    }
+    int flags = O_CLOEXEC;
+    if (redirection.type == REDIRECT_INPUT)
+    {
+      flags |= O_RDONLY;
+    }
+    else
+    {
+      flags |= O_WRONLY | O_CREAT | (redirection.type == REDIRECT_APPEND ? O_APPEND : O_TRUNC);
+    }
+    int fd = ::open(redirection.target, flags, 0777);
+    if (fd == -1)
+    {
+      perror("smash error: open failed");
+      return false;
+    }
+    // Out of the way of the descriptors the following actions may set:
+    fd = moveAboveRedirections(fd);
+    if (fd == -1)
+    {
+      return false;
+    }
+    m_opened.push_back(fd);
+    m_actions.push_back({fd, redirection.fd});
+  }
+  return true;
+}
+
+void Redirector::addAction(int source, int target)
+{
+  m_actions.push_back({source, target});
+}
+
+const FdAction *Redirector::actions() const
+{
+  return m_actions.data();
+}
+
+int Redirector::numActions() const
+{
+  return static_cast<int>(m_actions.size());
+}
+
+bool Redirector::applyToShell()
+{
+  for (const FdAction &action : m_actions)
+  {
+    bool isSaved = false;
+    for (const SavedFd &saved : m_saved)
+    {
+      isSaved = isSaved || saved.target == action.target;
+    }
+    if (!isSaved)
+    {
+      int copy = fcntl(action.target, F_DUPFD_CLOEXEC, REDIRECT_FIRST_SHELL_FD);
+      if (copy == -1 && errno != EBADF)
+      {
+        perror("smash error: fcntl failed");
+        restoreShell();
+        return false;
+      }
+      m_saved.push_back({action.target, copy});
+    }
+    // Output written before the switch belongs to the old descriptor:
+    if (action.target == STDOUT_FILENO)
+    {
+      std::cout.flush();
+      fflush(stdout);
+    }
+    if (action.source == -1)
+    {
+      close(action.target);
+    }
+    else if (action.source != action.target && dup2(action.source, action.target) == -1)
+    {
+      perror("smash error: dup2 failed");
+      restoreShell();
+      return false;
+    }
+  }
+  return true;
+}
+
+void Redirector::restoreShell()
+{
+  if (m_saved.empty())
+  {
+    return;
+  }
+  std::cout.flush();
+  fflush(stdout);
+  for (auto saved = m_saved.rbegin(); saved != m_saved.rend(); ++saved)
+  {
+    if (saved->copy == -1)
+    {
+      close(saved->target);
+    }
+    else
+    {
+      dup2(saved->copy, saved->target);
+      close(saved->copy);
+    }
+  }
+  m_saved.clear();
+}
@@ -0,0 +1,149 @@
+#ifndef SMASH_REDIRECTOR_H_
+#define SMASH_REDIRECTOR_H_
+
+#include <istream>
+#include <vector>
+#include "Parser.h"
+#include "Launcher.h"
+
+// The lowest descriptor the shell moves the files it opens for redirections to:
+#define REDIRECT_FIRST_SHELL_FD (REDIRECT_MAX_FD + 1)
+// The buffer the body of a here-document is collected in before it is written:
+#define HERE_DOCUMENT_BUFFER (65536)
+
+/*
+ * Moves a descriptor the shell keeps above the descriptors a redirection can name, so
+ * redirections applied to the shell leave it alone. A failure is printed.
+ * @param fd - the descriptor, or -1
+ * @return
+ *      int - the descriptor, close-on-exec, or -1 (the original descriptor is closed either way)
+ */
+int moveAboveRedirections(int fd);
+
+/*
+ * Creates an empty memfd that can be sealed, above the descriptors a redirection can name.
+ * A failure is printed.
+ * @param name - the name of the memfd, shown in /proc
+ * @return
+ *      int - the memfd, close-on-exec, or -1
+ */
+int createMemoryFile(const char *name);
+
+/*
+ * Reads the body of a here-document into a sealed memfd: the lines of the input up to one that is
+ * the delimiter (or up to its end). The lines are read straight into one buffer, which is written to
+ * the memfd whenever it fills, so a large body is never held whole. The lines are consumed even if
+ * the memfd cannot be created. A failure is printed.
+ * @param input - the input the command line came from
+ * @param delimiter - the line that ends the body
+ * @return
+ *      int - the memfd, close-on-exec, above REDIRECT_MAX_FD and positioned at its start, or -1
+ */
+int readHereDocument(std::istream &input, const char *delimiter);
+
+/*
+ * Writes a here-string (the word and a newline) into a sealed memfd. A failure is printed.
+ * @param word - the word
+ * @return
+ *      int - the memfd, close-on-exec, above REDIRECT_MAX_FD and positioned at its start, or -1
+ */
+int makeHereString(const char *word);
+
+/*
+ *  Redirector Class:
+ *  Resolves the redirections of a command into descriptor actions. The files are opened by
+ *  the shell, close-on-exec and above every descriptor a redirection can name, so the actions
+ *  can be handed to launchProcess for a program, or applied to the shell itself around a
+ *  built-in command and undone afterwards.
+ */
+class Redirector
+{
+public:
+  /*
+   * Constructor of Redirector class
+   * Receives no parameters
+   * @return
+   *      A new instance of Redirector.
+   */
+  Redirector();
+
+  /*
+   * Destructor of the Redirector class. Restores the shell's descriptors if they were
+   * redirected, and closes the files.
+   */
+  ~Redirector();
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  Redirector(Redirector const &) = delete;
+  void operator=(Redirector const &) = delete;
+
+  /*
+   * Opens the files of a command's redirections. A failure is printed.
+   * Here-documents are not opened; the command reads the memfd of its line that was made for each.
+   * @param redirections - the redirections
+   * @param count - the number of redirections
+   * @param hereDocuments - the memfds of the here-documents of the line, by hereIndex (-1 for one that failed)
+   * @return
+   *      bool - false if a file could not be opened
+   */
+  bool open(const Redirection *redirections, int count, const int *hereDocuments = nullptr);
+
+  /*
+   * Adds an action for a descriptor the caller keeps open. Actions apply in the order they were added,
+   * so one added before open is overridden by the command's own redirections.
+   * @param source - the descriptor to copy, or -1 to close the target
+   * @param target - the descriptor that is set
+   * @return
+   *      void
+   */
+  void addAction(int source, int target);
+
+  /*
+   * Getters for the actions the redirections resolved to, in order
+   */
+  const FdAction *actions() const;
+  int numActions() const;
+
+  /*
+   * Applies the actions to the shell's own descriptors, saving the ones it replaces.
+   * A failure is printed, and what was applied is undone.
+   * Receives no parameters
+   * @return
+   *      bool - false if an action failed
+   */
+  bool applyToShell();
+
+  /*
+   * Flushes the standard streams and puts back the descriptors applyToShell replaced
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void restoreShell();
+
+private:
+  /*
+   *  SavedFd Struct:
+   *  target: A descriptor of the shell that was redirected
+   *  copy: A copy of what it was, or -1 if it was closed
+   */
+  struct SavedFd
+  {
+    int target;
+    int copy;
+  };
+
+  /*
+   * The internal fields associated with Redirector:
+   * m_actions: The descriptor actions, in the order of the redirections
+   * m_opened: The files opened for the redirections (not the here-documents, which the line owns)
+   * m_saved: The shell's descriptors replaced by applyToShell, in the order they were replaced
+   */
+  std::vector<FdAction> m_actions;
+  std::vector<int> m_opened;
+  std::vector<SavedFd> m_saved;
+};
+
+#endif // SMASH_REDIRECTOR_H_
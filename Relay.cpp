@@ -0,0 +1,343 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <algorithm>
+#include <system_error>
+#include "Relay.h"
+
+int makePipe(int fds[2], int size)
+{
+  if (pipe2(fds, O_CLOEXEC) == -1)
+  {
+    return -1;
+  }
+  if (size > 0)
+  {
+    fcntl(fds[1], F_SETPIPE_SZ, size);
+  }
+  return 0;
+}
+
+/*
+ * Returns the monotonic time
+ * Receives no parameters
+ * @return
+ *      int64_t - the time in nanoseconds
+ */
+static int64_t monotonicNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/*
+ * Waits until a descriptor is ready, adding the time spent blocked to a counter.
+ * A descriptor that is ready at once costs no clock reads.
+ * @param fd - the descriptor
+ * @param events - the poll events to wait for
+ * @param waitNs - the counter
+ * @return
+ *      void
+ */
+static void waitReady(int fd, short events, int64_t &waitNs)
+{
+  struct pollfd entry = {fd, events, 0};
+  if (poll(&entry, 1, 0) != 0)
+  {
+    return;
+  }
+  int64_t start = monotonicNs();
+  while (poll(&entry, 1, -1) == -1 && errno == EINTR)
+  {
+  }
+  waitNs += monotonicNs() - start;
+}
+
+/*
+ * Closes a descriptor if it is open, and marks it closed
+ * @param fd - the descriptor
+ * @return
+ *      void
+ */
+static void closeFd(int &fd)
+{
+  if (fd != -1)
+  {
+    close(fd);
+    fd = -1;
+  }
+}
+
+Relay::Relay(int input, int output, bool ownsOutput) : m_input(input), m_output(output), m_ownsOutput(ownsOutput),
+                                                       m_outputCanSplice(true), m_stats{0, 0, 0} {}
+
+Relay::~Relay()
+{
+  if (m_thread.joinable())
+  {
+    m_thread.detach();
+  }
+  closeAll();
+}
+
+void Relay::addCopy(int fd)
+{
+  Copy copy;
+  copy.fd = fd;
+  copy.scratch[0] = copy.scratch[1] = -1;
+  copy.canSplice = true;
+  m_copies.push_back(copy);
+}
+
+int Relay::start()
+{
+  // Every scratch pipe gets the capacity of the input, so one tee(2) fills each of them alike:
+  int capacity = fcntl(m_input, F_GETPIPE_SZ);
+  int smallest = capacity;
+  for (Copy &copy : m_copies)
+  {
+    if (pipe2(copy.scratch, O_CLOEXEC) == -1)
+    {
+      int err = errno;
+      closeAll();
+      return err;
+    }
+    if (capacity > 0)
+    {
+      fcntl(copy.scratch[1], F_SETPIPE_SZ, capacity);
+    }
+    smallest = std::min(smallest, fcntl(copy.scratch[1], F_GETPIPE_SZ));
+  }
+  for (Copy &copy : m_copies)
+  {
+    if (fcntl(copy.scratch[1], F_GETPIPE_SZ) != smallest)
+    {
+      fcntl(copy.scratch[1], F_SETPIPE_SZ, smallest);
+    }
+  }
+
+  // The thread starts with every signal blocked, so the shell's handlers run on the shell's thread
+  // and a write to a closed pipe fails with EPIPE instead of killing the shell:
+  sigset_t all;
+  sigset_t previous;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &previous);
+  int err = 0;
+  try
+  {
+    m_thread = std::thread(&Relay::run, shared_from_this());
+  }
+  catch (const std::system_error &error)
+  {
+    err = error.code().value();
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  if (err != 0)
+  {
+    closeAll();
+  }
+  return err;
+}
+
+void Relay::join()
+{
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+}
+
+void Relay::detach()
+{
+  if (m_thread.joinable())
+  {
+    m_thread.detach();
+  }
+}
+
+const RelayStats &Relay::stats() const
+{
+  return m_stats;
+}
+
+void Relay::run()
+{
+  while (pump())
+  {
+  }
+  closeAll();
+}
+
+bool Relay::pump()
+{
+  waitReady(m_input, POLLIN, m_stats.inputWaitNs);
+  if (m_copies.empty())
+  {
+    ssize_t moved = m_outputCanSplice
+                        ? splice(m_input, nullptr, m_output, nullptr, RELAY_MAX_CHUNK, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)
+                        : copyThroughBuffer(m_input, m_output, RELAY_MAX_CHUNK);
+    if (moved > 0)
+    {
+      m_stats.bytes += moved;
+      return true;
+    }
+    if (moved == 0)
+    {
+      return false;
+    }
+    if (errno == EINVAL && m_outputCanSplice)
+    {
+      m_outputCanSplice = false;
+      return true;
+    }
+    if (errno == EAGAIN)
+    {
+      // The input has data, so the output is full:
+      waitReady(m_output, POLLOUT, m_stats.outputWaitNs);
+      return true;
+    }
+    return errno == EINTR;
+  }
+
+  // Copy the data into every scratch pipe without consuming it, then consume it into the main output:
+  ssize_t len = 0;
+  bool isFirst = true;
+  for (Copy &copy : m_copies)
+  {
+    if (copy.fd == -1)
+    {
+      continue;
+    }
+    ssize_t copied;
+    do
+    {
+      copied = tee(m_input, copy.scratch[1], isFirst ? RELAY_MAX_CHUNK : len, SPLICE_F_NONBLOCK);
+    } while (copied == -1 && errno == EINTR);
+    if (isFirst)
+    {
+      if (copied == 0 || (copied == -1 && errno != EAGAIN))
+      {
+        return false;
+      }
+      if (copied == -1)
+      {
+        return true;
+      }
+      len = copied;
+      isFirst = false;
+    }
+    else if (copied != len)
+    {
+      // Unreachable while the scratch pipes are alike; rather drop the copy than write part of the data:
+      closeFd(copy.fd);
+      continue;
+    }
+    drainCopy(copy, copied);
+  }
+  if (isFirst)
+  {
+    // Writing every copy failed; relay the rest of the stream without them:
+    for (Copy &copy : m_copies)
+    {
+      closeFd(copy.scratch[0]);
+      closeFd(copy.scratch[1]);
+    }
+    m_copies.clear();
+    return true;
+  }
+  return moveToOutput(len);
+}
+
+bool Relay::moveToOutput(size_t len)
+{
+  while (len > 0)
+  {
+    ssize_t moved = m_outputCanSplice
+                        ? splice(m_input, nullptr, m_output, nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)
+                        : copyThroughBuffer(m_input, m_output, len);
+    if (moved > 0)
+    {
+      m_stats.bytes += moved;
+      len -= moved;
+    }
+    else if (moved == -1 && errno == EINVAL && m_outputCanSplice)
+    {
+      m_outputCanSplice = false;
+    }
+    else if (moved == -1 && errno == EAGAIN)
+    {
+      waitReady(m_output, POLLOUT, m_stats.outputWaitNs);
+    }
+    else if (moved == 0 || errno != EINTR)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Relay::drainCopy(Copy &copy, size_t len)
+{
+  while (len > 0)
+  {
+    ssize_t moved = copy.canSplice ? splice(copy.scratch[0], nullptr, copy.fd, nullptr, len, SPLICE_F_MOVE)
+                                   : copyThroughBuffer(copy.scratch[0], copy.fd, len);
+    if (moved > 0)
+    {
+      len -= moved;
+    }
+    else if (moved == -1 && errno == EINVAL && copy.canSplice)
+    {
+      copy.canSplice = false;
+    }
+    else if (moved == 0 || errno != EINTR)
+    {
+      // The scratch pipe keeps what was not written, but it is never used again:
+      closeFd(copy.fd);
+      return;
+    }
+  }
+}
+
+ssize_t Relay::copyThroughBuffer(int from, int to, size_t len)
+{
+  if (m_buffer.empty())
+  {
+    m_buffer.resize(RELAY_COPY_BUFFER);
+  }
+  ssize_t got = read(from, m_buffer.data(), std::min(len, m_buffer.size()));
+  if (got <= 0)
+  {
+    return got;
+  }
+  ssize_t done = 0;
+  while (done < got)
+  {
+    ssize_t written = write(to, m_buffer.data() + done, got - done);
+    if (written == -1 && errno != EINTR)
+    {
+      return -1;
+    }
+    done += written == -1 ? 0 : written;
+  }
+  return got;
+}
+
+void Relay::closeAll()
+{
+  closeFd(m_input);
+  if (m_ownsOutput)
+  {
+    closeFd(m_output);
+  }
+  for (Copy &copy : m_copies)
+  {
+    closeFd(copy.fd);
+    closeFd(copy.scratch[0]);
+    closeFd(copy.scratch[1]);
+  }
+}
@@ -0,0 +1,208 @@
+#ifndef SMASH_RELAY_H_
+#define SMASH_RELAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// The most a relay moves in one splice call:
+#define RELAY_MAX_CHUNK (1 << 20)
+// The buffer used for outputs that do not support splice:
+#define RELAY_COPY_BUFFER (65536)
+
+/*
+ *  PipeOptions Struct:
+ *  How pipelines set up the pipes between their stages.
+ *  size: The capacity requested for every pipe with F_SETPIPE_SZ, or 0 for the system default
+ *  relay: Whether the shell relays the data between stages, to count it and time the stalls
+ */
+struct PipeOptions
+{
+  int size;
+  bool relay;
+};
+
+/*
+ * Creates a close-on-exec pipe and requests a capacity for it. A capacity that cannot be
+ * granted is not an error; the pipe keeps its default capacity.
+ * @param fds - receives the read and write ends
+ * @param size - the capacity to request, or 0 to keep the default
+ * @return
+ *      int - 0 on success, -1 if the pipe could not be created
+ */
+int makePipe(int fds[2], int size);
+
+/*
+ *  RelayStats Struct:
+ *  bytes: The bytes moved from the input to the main output
+ *  inputWaitNs: The time spent waiting for data on the input, in nanoseconds
+ *  outputWaitNs: The time spent waiting for room on the main output, in nanoseconds
+ */
+struct RelayStats
+{
+  unsigned long long bytes;
+  int64_t inputWaitNs;
+  int64_t outputWaitNs;
+};
+
+/*
+ *  Relay Class:
+ *  Moves a stream from a pipe to a main output, and copies it to any number of other
+ *  descriptors, on a thread of its own. Data moves with splice and tee(2), so it does not
+ *  pass through user space unless an output does not support splice.
+ *  The relay closes its input, its copies and (if it owns it) its main output when the
+ *  input ends or the main output is closed by its reader.
+ */
+class Relay : public std::enable_shared_from_this<Relay>
+{
+public:
+  /*
+   * Constructor of Relay class
+   * @param input - the read end of a pipe; the relay takes ownership of it
+   * @param output - the main output
+   * @param ownsOutput - whether the relay closes the main output when it is done
+   * @return
+   *      A new instance of Relay.
+   */
+  Relay(int input, int output, bool ownsOutput);
+
+  /*
+   * Destructor of the Relay class. Closes the descriptors of a relay that never started.
+   */
+  ~Relay();
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  Relay(Relay const &) = delete;
+  void operator=(Relay const &) = delete;
+
+  /*
+   * Adds a descriptor that receives a copy of the stream; the relay takes ownership of it.
+   * Must be called before start.
+   * @param fd - the descriptor
+   * @return
+   *      void
+   */
+  void addCopy(int fd);
+
+  /*
+   * Starts the relay thread. On failure every descriptor the relay owns is closed.
+   * The relay must be owned by a shared_ptr, which the thread shares until it ends.
+   * Receives no parameters
+   * @return
+   *      int - 0 on success, otherwise the errno of the failed step
+   */
+  int start();
+
+  /*
+   * Waits for the relay to finish
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void join();
+
+  /*
+   * Lets the relay finish on its own, without anyone waiting for it
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void detach();
+
+  /*
+   * Getter for the counters of the relay, final once it was joined
+   */
+  const RelayStats &stats() const;
+
+private:
+  /*
+   *  Copy Struct:
+   *  fd: The descriptor that receives the copy, -1 once writing to it failed
+   *  scratch: The pipe the stream is teed into before it is spliced into fd
+   *  canSplice: Whether fd accepts splice; cleared on the first EINVAL
+   */
+  struct Copy
+  {
+    int fd;
+    int scratch[2];
+    bool canSplice;
+  };
+
+  /*
+   * Moves data until the input ends or the main output is closed, then closes the descriptors
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void run();
+
+  /*
+   * Moves the data that is available on the input
+   * Receives no parameters
+   * @return
+   *      bool - false once the relay is done
+   */
+  bool pump();
+
+  /*
+   * Moves exactly len bytes from the input to the main output
+   * @param len - the number of bytes, all of them already in the input
+   * @return
+   *      bool - false if the main output failed
+   */
+  bool moveToOutput(size_t len);
+
+  /*
+   * Empties the scratch pipe of a copy into its descriptor
+   * @param copy - the copy
+   * @param len - the number of bytes in the scratch pipe
+   * @return
+   *      void
+   */
+  void drainCopy(Copy &copy, size_t len);
+
+  /*
+   * Moves up to len bytes from a pipe to a descriptor through a user space buffer
+   * @param from - the pipe, which must have data
+   * @param to - the descriptor
+   * @param len - the most to move
+   * @return
+   *      ssize_t - the number of bytes moved, or -1 on failure
+   */
+  ssize_t copyThroughBuffer(int from, int to, size_t len);
+
+  /*
+   * Closes every descriptor the relay owns
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void closeAll();
+
+  /*
+   * The internal fields associated with Relay:
+   * m_input: The pipe the stream comes from
+   * m_output: The main output
+   * m_ownsOutput: Whether the relay closes the main output
+   * m_outputCanSplice: Whether the main output accepts splice; cleared on the first EINVAL
+   * m_copies: The descriptors that receive copies of the stream
+   * m_buffer: The buffer for outputs that do not support splice, allocated when first needed
+   * m_stats: The counters of the relay
+   * m_thread: The relay thread
+   */
+  int m_input;
+  int m_output;
+  bool m_ownsOutput;
+  bool m_outputCanSplice;
+  std::vector<Copy> m_copies;
+  std::vector<char> m_buffer;
+  RelayStats m_stats;
+  std::thread m_thread;
+};
+
+#endif // SMASH_RELAY_H_
@@ -0,0 +1,91 @@
+#ifndef SMASH_TEST_SUPPORT_H_
+#define SMASH_TEST_SUPPORT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+
+/*
+ * The fixture the unit tests share: checks that count their failures instead of stopping the test,
+ * and a scratch directory for tests that work on files. Every test_* program includes it once.
+ */
+
+/*
+ * Returns the number of checks that failed so far
+ * Receives no parameters
+ * @return
+ *      int& - the count
+ */
+inline int &testFailures()
+{
+  static int failures = 0;
+  return failures;
+}
+
+/*
+ * Reports a failed check
+ * @param what - a description of the mismatch
+ * @return
+ *      void
+ */
+inline void fail(const std::string &what)
+{
+  std::cerr << "FAILED: " << what << std::endl;
+  testFailures()++;
+}
+
+/*
+ * Creates an empty scratch directory under /tmp
+ * @param name - the name of the test, which the directory is named after
+ * @return
+ *      string - the canonical path of the directory; the test exits if it cannot be created
+ */
+inline std::string makeScratchDir(const std::string &name)
+{
+  std::string dirTemplate = "/tmp/smash_" + name + "_XXXXXX";
+  if (mkdtemp(&dirTemplate[0]) == nullptr)
+  {
+    perror("mkdtemp");
+    exit(1);
+  }
+  // The temporary directory may itself be reached through a link:
+  char *canonical = realpath(dirTemplate.c_str(), nullptr);
+  std::string dir = canonical == nullptr ? dirTemplate : canonical;
+  free(canonical);
+  return dir;
+}
+
+/*
+ * Removes a scratch directory and everything in it, leaving it first if the test works in it
+ * @param dir - the directory
+ * @return
+ *      void
+ */
+inline void removeScratchDir(const std::string &dir)
+{
+  std::string cleanup = "rm -rf " + dir;
+  if (chdir("/") != 0 || system(cleanup.c_str()) != 0)
+  {
+    fail("could not remove " + dir);
+  }
+}
+
+/*
+ * Reports the outcome of a test
+ * @param name - the name of the test
+ * @return
+ *      int - the exit status of the test
+ */
+inline int finishTest(const std::string &name)
+{
+  if (testFailures() != 0)
+  {
+    return 1;
+  }
+  std::cout << name << " ++PASSED++" << std::endl;
+  return 0;
+}
+
+#endif // SMASH_TEST_SUPPORT_H_
@@ -0,0 +1,42 @@
+#ifndef SMASH_TEXT_VIEW_H_
+#define SMASH_TEXT_VIEW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  TextView Struct:
+ *  A string that is not copied, to look up stored strings by without building a std::string.
+ *  text: The characters of the string
+ *  length: The number of characters
+ */
+struct TextView
+{
+  const char *text;
+  size_t length;
+
+  bool operator==(const TextView &other) const
+  {
+    return length == other.length && memcmp(text, other.text, length) == 0;
+  }
+};
+
+/*
+ *  TextViewHash Struct:
+ *  Hashes a TextView (FNV-1a).
+ */
+struct TextViewHash
+{
+  size_t operator()(const TextView &view) const
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < view.length; i++)
+    {
+      hash = (hash ^ static_cast<unsigned char>(view.text[i])) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+  }
+};
+
+#endif // SMASH_TEXT_VIEW_H_
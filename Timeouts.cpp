@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <system_error>
+#include <vector>
+#include "Timeouts.h"
+#include "Jobs.h"
+#include "Redirector.h"
+
+#define SYS_FAIL -1
+
+using namespace std;
+
+/*
+ * Returns the monotonic time
+ * Receives no parameters
+ * @return
+ *      int64_t - the time in nanoseconds
+ */
+static int64_t monotonicNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+Timeouts::Timeouts(JobsList &jobs) : m_nextKey(0), m_timerFd(SYS_FAIL), m_reportFd(SYS_FAIL), m_jobs(jobs),
+                                     m_isStopping(false) {}
+
+Timeouts::~Timeouts()
+{
+  {
+    lock_guard<mutex> guard(m_lock);
+    m_isStopping = true;
+    if (m_timerFd != SYS_FAIL)
+    {
+      struct itimerspec soon = {};
+      soon.it_value.tv_nsec = 1;
+      timerfd_settime(m_timerFd, 0, &soon, nullptr);
+    }
+  }
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+  for (const auto &entry : m_timeouts)
+  {
+    close(entry.second.pidfd);
+  }
+  if (m_timerFd != SYS_FAIL)
+  {
+    close(m_timerFd);
+    close(m_reportFd);
+  }
+}
+
+bool Timeouts::add(pid_t pid, int64_t delayNs, const char *cmd)
+{
+  int pidfd = openProcessFd(pid);
+  if (pidfd == SYS_FAIL)
+  {
+    return false;
+  }
+  lock_guard<mutex> guard(m_lock);
+  if (m_timerFd == SYS_FAIL && !start())
+  {
+    close(pidfd);
+    return false;
+  }
+  uint64_t key = m_nextKey++;
+  m_timeouts[key] = {pid, pidfd, cmd};
+  m_wheel.schedule(key, (monotonicNs() + delayNs + TIMEOUT_TICK_NS - 1) / TIMEOUT_TICK_NS);
+  arm();
+  return true;
+}
+
+size_t Timeouts::size()
+{
+  lock_guard<mutex> guard(m_lock);
+  return m_timeouts.size();
+}
+
+bool Timeouts::start()
+{
+  int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (timerFd == SYS_FAIL)
+  {
+    perror("smash error: timerfd_create failed");
+    return false;
+  }
+  timerFd = moveAboveRedirections(timerFd);
+  if (timerFd == SYS_FAIL)
+  {
+    return false;
+  }
+  int reportFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (reportFd == SYS_FAIL)
+  {
+    perror("smash error: eventfd failed");
+    close(timerFd);
+    return false;
+  }
+  reportFd = moveAboveRedirections(reportFd);
+  if (reportFd == SYS_FAIL)
+  {
+    close(timerFd);
+    return false;
+  }
+  m_wheel = TimerWheel(monotonicNs() / TIMEOUT_TICK_NS);
+  // The thread starts with every signal blocked, so the shell's handlers run on the shell's thread:
+  sigset_t all;
+  sigset_t previous;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &previous);
+  int err = 0;
+  try
+  {
+    m_thread = thread(&Timeouts::run, this);
+  }
+  catch (const system_error &error)
+  {
+    err = error.code().value();
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  if (err != 0)
+  {
+    errno = err;
+    perror("smash error: pthread_create failed");
+    close(timerFd);
+    close(reportFd);
+    return false;
+  }
+  m_timerFd = timerFd;
+  m_reportFd = reportFd;
+  m_jobs.watchReports(m_reportFd, this);
+  return true;
+}
+
+void Timeouts::printReports()
+{
+  string reports;
+  {
+    lock_guard<mutex> guard(m_lock);
+    if (m_reports.empty())
+    {
+      return;
+    }
+    reports.swap(m_reports);
+    // Cleared with the reports taken, so a report left after this makes it readable again:
+    uint64_t count;
+    if (read(m_reportFd, &count, sizeof(count)) == SYS_FAIL && errno != EAGAIN)
+    {
+      perror("smash error: read failed");
+    }
+  }
+  cout << reports << flush;
+}
+
+void Timeouts::arm()
+{
+  struct itimerspec when = {};
+  int64_t next = m_wheel.nextTick();
+  if (next != -1)
+  {
+    int64_t ns = next * TIMEOUT_TICK_NS;
+    when.it_value.tv_sec = ns / 1000000000;
+    when.it_value.tv_nsec = ns % 1000000000;
+  }
+  if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &when, nullptr) == SYS_FAIL)
+  {
+    perror("smash error: timerfd_settime failed");
+  }
+}
+
+void Timeouts::run()
+{
+  // The timerfd is set once the thread holds the lock, so it is read only after start returned:
+  {
+    lock_guard<mutex> guard(m_lock);
+  }
+  while (true)
+  {
+    uint64_t expirations;
+    if (read(m_timerFd, &expirations, sizeof(expirations)) == SYS_FAIL)
+    {
+      perror("smash error: read failed");
+      return;
+    }
+    vector<Timeout> fired;
+    {
+      lock_guard<mutex> guard(m_lock);
+      if (m_isStopping)
+      {
+        return;
+      }
+      vector<uint64_t> expired;
+      m_wheel.advance(monotonicNs() / TIMEOUT_TICK_NS, expired);
+      for (uint64_t key : expired)
+      {
+        auto found = m_timeouts.find(key);
+        fired.push_back(found->second);
+        m_timeouts.erase(found);
+      }
+      arm();
+    }
+    bool isReported = false;
+    for (const Timeout &timeout : fired)
+    {
+      expire(timeout, isReported);
+      close(timeout.pidfd);
+    }
+  }
+}
+
+void Timeouts::expire(const Timeout &timeout, bool &isReported)
+{
+  // A leader that exited is left alone, even before the shell reaped it:
+  siginfo_t info = {};
+  if (waitid(P_PIDFD, timeout.pidfd, &info, WEXITED | WNOHANG | WNOWAIT) == SYS_FAIL || info.si_pid != 0)
+  {
+    return;
+  }
+  // Left first, so the shell cannot go on with a command in the foreground before the report:
+  {
+    lock_guard<mutex> guard(m_lock);
+    if (!isReported)
+    {
+      m_reports += "smash: got an alarm\n";
+      isReported = true;
+    }
+    m_reports += "smash: " + timeout.cmd + " timed out!\n";
+  }
+  uint64_t one = 1;
+  if (write(m_reportFd, &one, sizeof(one)) == SYS_FAIL)
+  {
+    perror("smash error: write failed");
+  }
+  if (signalProcessGroup(timeout.pid, timeout.pidfd, SIGKILL) == SYS_FAIL)
+  {
+    perror("smash error: kill failed");
+  }
+}
@@ -0,0 +1,151 @@
+#ifndef SMASH_TIMEOUTS_H_
+#define SMASH_TIMEOUTS_H_
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "Jobs.h"
+#include "TimerWheel.h"
+
+// The length of a tick of the timeout wheel, in nanoseconds; deadlines are rounded up to it:
+#define TIMEOUT_TICK_NS (10000000)
+
+/*
+ *  Timeouts Class:
+ *  Kills the process groups of commands run by timeout when their deadlines pass, and reports
+ *  them as they fire, also while the shell waits for input. The deadlines are kept in a
+ *  TimerWheel, and a single timerfd is set to the next tick the wheel needs, so thousands of
+ *  timeouts cost one descriptor besides their process fds and wake the shell only when
+ *  something is due. The wheel belongs to a thread of its own, started by the first timeout,
+ *  with every signal blocked. The thread kills, but leaves the reports to the shell's thread
+ *  through an eventfd in the event set of the jobs, so they are printed between the shell's
+ *  own lines.
+ */
+class Timeouts : public Reporter
+{
+public:
+  /*
+   * Constructor of Timeouts class
+   * @param jobs - the jobs whose waits print the reports; it outlives the timeouts
+   * @return
+   *      A new instance of Timeouts.
+   */
+  explicit Timeouts(JobsList &jobs);
+
+  /*
+   * Destructor of the Timeouts class
+   * Stops the thread; the timeouts that did not fire are dropped.
+   */
+  ~Timeouts();
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  Timeouts(Timeouts const &) = delete;
+  void operator=(Timeouts const &) = delete;
+
+  /*
+   * Kills a process group with SIGKILL once a delay passes, unless its leader finished by then.
+   * A failure is printed.
+   * @param pid - the PID of a child of the shell that leads its process group and was not reaped yet
+   * @param delayNs - the delay, in nanoseconds
+   * @param cmd - the CMD line to report
+   * @return
+   *      bool - false if the timeout could not be set
+   */
+  bool add(pid_t pid, int64_t delayNs, const char *cmd);
+
+  /*
+   * Returns the number of timeouts that did not fire yet
+   * Receives no parameters.
+   * @return
+   *      size_t - the number of timeouts
+   */
+  size_t size();
+
+  /*
+   * Prints the commands whose timers expired since the last call. Called on the shell's thread.
+   * Receives no parameters.
+   * @return
+   *      void
+   */
+  void printReports() override;
+
+private:
+  /*
+   *  Timeout Struct:
+   *  A command whose process group is killed when its timer expires.
+   *  pid: The PID of the leader of the process group
+   *  pidfd: The process fd of the leader, owned by the timeout
+   *  cmd: The CMD line to report
+   */
+  struct Timeout
+  {
+    pid_t pid;
+    int pidfd;
+    std::string cmd;
+  };
+
+  /*
+   * Creates the timerfd and the eventfd of the reports, and starts the thread. Called with m_lock held.
+   * Receives no parameters.
+   * @return
+   *      bool - false if any failed; the failure was printed
+   */
+  bool start();
+
+  /*
+   * Sets the timerfd to the next tick the wheel needs, or disarms it. Called with m_lock held.
+   * Receives no parameters.
+   * @return
+   *      void
+   */
+  void arm();
+
+  /*
+   * The thread: waits for the timerfd, and kills and reports the commands whose timers expired
+   * Receives no parameters.
+   * @return
+   *      void
+   */
+  void run();
+
+  /*
+   * Leaves the report of a command whose timer expired and kills its process group, unless its
+   * leader finished
+   * @param timeout - the command
+   * @param isReported - whether the alarm was reported already; set once it is
+   * @return
+   *      void
+   */
+  void expire(const Timeout &timeout, bool &isReported);
+
+  /*
+   * The internal fields associated with Timeouts:
+   * m_lock: Guards the fields below, shared by the shell and the thread
+   * m_wheel: The timers of the timeouts, in ticks of TIMEOUT_TICK_NS on the monotonic clock
+   * m_timeouts: The timeouts, by the key of their timer
+   * m_nextKey: The key of the next timer
+   * m_timerFd: The timerfd the thread waits for, or -1 before the thread starts
+   * m_reportFd: The eventfd the thread makes readable when it leaves a report, or -1 before the thread starts
+   * m_reports: The reports the shell did not print yet
+   * m_jobs: The jobs whose waits print the reports
+   * m_isStopping: Set to make the thread end
+   * m_thread: The thread
+   */
+  std::mutex m_lock;
+  TimerWheel m_wheel;
+  std::unordered_map<uint64_t, Timeout> m_timeouts;
+  uint64_t m_nextKey;
+  int m_timerFd;
+  int m_reportFd;
+  std::string m_reports;
+  JobsList &m_jobs;
+  bool m_isStopping;
+  std::thread m_thread;
+};
+
+#endif // SMASH_TIMEOUTS_H_
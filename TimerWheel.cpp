@@ -0,0 +1,200 @@
+#include <algorithm>
+#include "TimerWheel.h"
+
+/*
+ * Rotates a word of slot bits to the right
+ * @param bits - the word
+ * @param count - how far, below 64
+ * @return
+ *      uint64_t - the rotated word
+ */
+static uint64_t rotateRight(uint64_t bits, int count)
+{
+  return (bits >> count) | (bits << ((64 - count) & 63));
+}
+
+/*
+ * Finds how many slots after the current one the next occupied slot of a level is
+ * @param bits - the occupied slots of the level, not all clear
+ * @param current - the current slot of the level
+ * @return
+ *      int - between 1 and TIMER_WHEEL_SLOTS, which stands for the current slot itself
+ */
+static int slotsToNext(uint64_t bits, int64_t current)
+{
+  return __builtin_ctzll(rotateRight(bits, (current + 1) & (TIMER_WHEEL_SLOTS - 1))) + 1;
+}
+
+TimerWheel::TimerWheel(int64_t now) : m_now(now)
+{
+  std::fill(m_heads, m_heads + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS, -1);
+  std::fill(m_occupied, m_occupied + TIMER_WHEEL_LEVELS, 0);
+}
+
+void TimerWheel::schedule(uint64_t key, int64_t deadline)
+{
+  auto found = m_byKey.find(key);
+  int index;
+  if (found != m_byKey.end())
+  {
+    index = found->second;
+    unlink(index);
+  }
+  else if (!m_free.empty())
+  {
+    index = m_free.back();
+    m_free.pop_back();
+  }
+  else
+  {
+    index = static_cast<int>(m_timers.size());
+    m_timers.push_back(Timer());
+  }
+  m_timers[index].key = key;
+  // The current tick was handled already:
+  m_timers[index].deadline = std::max(deadline, m_now + 1);
+  m_byKey[key] = index;
+  insert(index);
+}
+
+bool TimerWheel::cancel(uint64_t key)
+{
+  auto found = m_byKey.find(key);
+  if (found == m_byKey.end())
+  {
+    return false;
+  }
+  unlink(found->second);
+  m_free.push_back(found->second);
+  m_byKey.erase(found);
+  return true;
+}
+
+void TimerWheel::advance(int64_t now, std::vector<uint64_t> &expired)
+{
+  while (m_now < now)
+  {
+    int64_t next = nextTick();
+    if (next == -1 || next > now)
+    {
+      // No slot is reached on the way, so every timer stays where it is:
+      m_now = now;
+      return;
+    }
+    m_now = next;
+    if ((m_now & (TIMER_WHEEL_SLOTS - 1)) == 0)
+    {
+      cascade(1);
+    }
+    int slot = m_now & (TIMER_WHEEL_SLOTS - 1);
+    while (m_heads[slot] != -1)
+    {
+      int index = m_heads[slot];
+      unlink(index);
+      m_free.push_back(index);
+      m_byKey.erase(m_timers[index].key);
+      expired.push_back(m_timers[index].key);
+    }
+  }
+}
+
+int64_t TimerWheel::nextTick() const
+{
+  if (m_byKey.empty())
+  {
+    return -1;
+  }
+  int64_t next = INT64_MAX;
+  if (m_occupied[0] != 0)
+  {
+    next = m_now + slotsToNext(m_occupied[0], m_now & (TIMER_WHEEL_SLOTS - 1));
+  }
+  // A slot of a higher level is reached when the level below completes a turn into it:
+  for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+  {
+    if (m_occupied[level] == 0)
+    {
+      continue;
+    }
+    int shift = TIMER_WHEEL_SLOT_BITS * level;
+    int64_t turn = m_now >> shift;
+    next = std::min(next, (turn + slotsToNext(m_occupied[level], turn & (TIMER_WHEEL_SLOTS - 1))) << shift);
+  }
+  return next;
+}
+
+int64_t TimerWheel::now() const
+{
+  return m_now;
+}
+
+size_t TimerWheel::size() const
+{
+  return m_byKey.size();
+}
+
+void TimerWheel::insert(int index)
+{
+  Timer &timer = m_timers[index];
+  // A timer beyond the last level waits at its far end, and moves on from there:
+  const int64_t reach = (static_cast<int64_t>(1) << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+  int64_t deadline = std::min(timer.deadline, m_now + reach);
+  int64_t delta = deadline - m_now;
+  int level = 0;
+  while (level + 1 < TIMER_WHEEL_LEVELS && delta >= static_cast<int64_t>(1) << (TIMER_WHEEL_SLOT_BITS * (level + 1)))
+  {
+    level++;
+  }
+  int position = (deadline >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+  int slot = level * TIMER_WHEEL_SLOTS + position;
+  timer.slot = slot;
+  timer.prev = -1;
+  timer.next = m_heads[slot];
+  if (timer.next != -1)
+  {
+    m_timers[timer.next].prev = index;
+  }
+  m_heads[slot] = index;
+  m_occupied[level] |= static_cast<uint64_t>(1) << position;
+}
+
+void TimerWheel::unlink(int index)
+{
+  Timer &timer = m_timers[index];
+  if (timer.prev != -1)
+  {
+    m_timers[timer.prev].next = timer.next;
+  }
+  else
+  {
+    m_heads[timer.slot] = timer.next;
+  }
+  if (timer.next != -1)
+  {
+    m_timers[timer.next].prev = timer.prev;
+  }
+  if (m_heads[timer.slot] == -1)
+  {
+    m_occupied[timer.slot / TIMER_WHEEL_SLOTS] &= ~(static_cast<uint64_t>(1) << (timer.slot % TIMER_WHEEL_SLOTS));
+  }
+}
+
+void TimerWheel::cascade(int level)
+{
+  int position = (m_now >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+  // The levels above may move timers into this slot:
+  if (position == 0 && level + 1 < TIMER_WHEEL_LEVELS)
+  {
+    cascade(level + 1);
+  }
+  int slot = level * TIMER_WHEEL_SLOTS + position;
+  int index = m_heads[slot];
+  m_heads[slot] = -1;
+  m_occupied[level] &= ~(static_cast<uint64_t>(1) << position);
+  while (index != -1)
+  {
+    int next = m_timers[index].next;
+    insert(index);
+    index = next;
+  }
+}
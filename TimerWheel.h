@@ -0,0 +1,151 @@
+#ifndef SMASH_TIMER_WHEEL_H_
+#define SMASH_TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+// The number of slots of each level, as a power of two:
+#define TIMER_WHEEL_SLOT_BITS (6)
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+// The number of levels; a timer further away than the levels reach waits on the last one:
+#define TIMER_WHEEL_LEVELS (4)
+
+/*
+ *  TimerWheel Class:
+ *  Deadlines, counted in ticks, kept in a hierarchical timer wheel. Level 0 has a slot for
+ *  each of the next TIMER_WHEEL_SLOTS ticks, and every slot of a higher level covers a whole
+ *  turn of the level below it; when time reaches a slot of a higher level, its timers are
+ *  spread over the levels below. Scheduling and cancelling cost the same however many timers
+ *  there are, and finding the next tick that needs attention looks at one word per level.
+ *  Timers are named by a key chosen by the caller.
+ */
+class TimerWheel
+{
+public:
+  /*
+   * Constructor of TimerWheel class
+   * @param now - the current tick
+   * @return
+   *      A new instance of TimerWheel.
+   */
+  explicit TimerWheel(int64_t now = 0);
+
+  /*
+   * Destructor of the TimerWheel class
+   */
+  ~TimerWheel() = default;
+
+  /*
+   * Schedules a timer, replacing a timer with the same key. A deadline that passed already
+   * expires on the next tick.
+   * @param key - names the timer
+   * @param deadline - the tick the timer expires at
+   * @return
+   *      void
+   */
+  void schedule(uint64_t key, int64_t deadline);
+
+  /*
+   * Cancels a timer
+   * @param key - names the timer
+   * @return
+   *      bool - false if there was no such timer
+   */
+  bool cancel(uint64_t key);
+
+  /*
+   * Moves the wheel forward, collecting the timers whose deadline was reached
+   * @param now - the current tick; a tick before the wheel's changes nothing
+   * @param expired - receives the keys of the expired timers, in the order they expired
+   * @return
+   *      void
+   */
+  void advance(int64_t now, std::vector<uint64_t> &expired);
+
+  /*
+   * Returns the tick the wheel has to be moved to next: when a timer expires, or when timers
+   * have to move to a lower level. Timers never expire before it.
+   * Receives no parameters
+   * @return
+   *      int64_t - the tick, or -1 if there are no timers
+   */
+  int64_t nextTick() const;
+
+  /*
+   * Returns the tick the wheel was last moved to
+   * Receives no parameters
+   * @return
+   *      int64_t - the tick
+   */
+  int64_t now() const;
+
+  /*
+   * Returns the number of timers
+   * Receives no parameters
+   * @return
+   *      size_t - the number of timers
+   */
+  size_t size() const;
+
+private:
+  /*
+   *  Timer Struct:
+   *  A scheduled timer, linked into the list of its slot.
+   *  key: Names the timer
+   *  deadline: The tick the timer expires at
+   *  slot: The slot holding the timer, numbered across the levels
+   *  prev: The previous timer of the slot, or -1
+   *  next: The next timer of the slot, or -1
+   */
+  struct Timer
+  {
+    uint64_t key;
+    int64_t deadline;
+    int slot;
+    int prev;
+    int next;
+  };
+
+  /*
+   * Links a timer into the slot its deadline belongs to
+   * @param index - the timer
+   * @return
+   *      void
+   */
+  void insert(int index);
+
+  /*
+   * Unlinks a timer from its slot
+   * @param index - the timer
+   * @return
+   *      void
+   */
+  void unlink(int index);
+
+  /*
+   * Moves the timers of the current slot of a level to the levels below, the levels above first
+   * @param level - the level, 1 or more
+   * @return
+   *      void
+   */
+  void cascade(int level);
+
+  /*
+   * The internal fields associated with TimerWheel:
+   * m_now: The tick the wheel was last moved to
+   * m_timers: The timers, including unused entries
+   * m_free: The unused entries of m_timers
+   * m_byKey: The entry of every timer, by key
+   * m_heads: The first timer of every slot, or -1
+   * m_occupied: For every level, a bit for each slot that holds timers
+   */
+  int64_t m_now;
+  std::vector<Timer> m_timers;
+  std::vector<int> m_free;
+  std::unordered_map<uint64_t, int> m_byKey;
+  int m_heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+  uint64_t m_occupied[TIMER_WHEEL_LEVELS];
+};
+
+#endif // SMASH_TIMER_WHEEL_H_
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "WorkingDir.h"
+#include "Redirector.h"
+
+#define SYS_FAIL -1
+
+/*
+ * Reads the target of a symbolic link, however long
+ * @param path - the link
+ * @param target - receives the target
+ * @return
+ *      bool - false if the link cannot be read; errno is set
+ */
+static bool readLink(const std::string &path, std::string &target)
+{
+  std::vector<char> buffer(256);
+  while (true)
+  {
+    ssize_t length = readlink(path.c_str(), buffer.data(), buffer.size());
+    if (length == SYS_FAIL)
+    {
+      return false;
+    }
+    if (static_cast<size_t>(length) < buffer.size())
+    {
+      target.assign(buffer.data(), length);
+      return true;
+    }
+    buffer.resize(buffer.size() * 2);
+  }
+}
+
+WorkingDir::WorkingDir() : m_isKnown(false) {}
+
+WorkingDir::~WorkingDir()
+{
+  clearStack();
+}
+
+const std::string &WorkingDir::path()
+{
+  if (!m_isKnown)
+  {
+    char *cwd = getcwd(nullptr, 0);
+    if (cwd == nullptr)
+    {
+      perror("smash error: getcwd failed");
+      m_path.clear();
+      return m_path;
+    }
+    m_path = cwd;
+    free(cwd);
+    m_isKnown = true;
+  }
+  return m_path;
+}
+
+const std::string &WorkingDir::previous() const
+{
+  return m_previous;
+}
+
+bool WorkingDir::change(const char *dir)
+{
+  // A relative directory is resolved from the current one, and it becomes the previous one, so it has to be known
+  // before leaving it:
+  path();
+  if (chdir(dir) == SYS_FAIL)
+  {
+    perror("smash error: chdir failed");
+    return false;
+  }
+  std::string resolved;
+  if ((dir[0] != '/' && !m_isKnown) || !resolve(m_path, dir, resolved))
+  {
+    // The path could not be followed again (it changed since chdir did); the kernel knows where it led:
+    char *cwd = getcwd(nullptr, 0);
+    if (cwd == nullptr)
+    {
+      perror("smash error: getcwd failed");
+      m_previous = m_isKnown ? m_path : std::string();
+      m_isKnown = false;
+      return true;
+    }
+    resolved = cwd;
+    free(cwd);
+  }
+  moveTo(resolved);
+  return true;
+}
+
+bool WorkingDir::changeBack()
+{
+  if (m_previous.empty())
+  {
+    return false;
+  }
+  if (chdir(m_previous.c_str()) == SYS_FAIL)
+  {
+    perror("smash error: chdir failed");
+    return false;
+  }
+  std::string to = m_previous;
+  moveTo(to);
+  return true;
+}
+
+bool WorkingDir::push(const char *dir)
+{
+  if (dir == nullptr && m_stack.empty())
+  {
+    return false;
+  }
+  std::string from = path();
+  int fd = openCurrent();
+  if (fd == SYS_FAIL)
+  {
+    return false;
+  }
+  if (dir != nullptr)
+  {
+    if (!change(dir))
+    {
+      close(fd);
+      return false;
+    }
+    m_stack.push_back({from, fd});
+    return true;
+  }
+  Entry &top = m_stack.back();
+  if (fchdir(top.fd) == SYS_FAIL)
+  {
+    perror("smash error: fchdir failed");
+    close(fd);
+    return false;
+  }
+  close(top.fd);
+  std::string to = top.path;
+  top = {from, fd};
+  moveTo(to);
+  return true;
+}
+
+bool WorkingDir::pop()
+{
+  if (m_stack.empty())
+  {
+    return false;
+  }
+  Entry top = m_stack.back();
+  if (fchdir(top.fd) == SYS_FAIL)
+  {
+    perror("smash error: fchdir failed");
+    return false;
+  }
+  close(top.fd);
+  m_stack.pop_back();
+  moveTo(top.path);
+  return true;
+}
+
+void WorkingDir::clearStack()
+{
+  for (const Entry &entry : m_stack)
+  {
+    close(entry.fd);
+  }
+  m_stack.clear();
+}
+
+void WorkingDir::listStack(std::vector<std::string> &dirs)
+{
+  dirs.push_back(path());
+  for (auto entry = m_stack.rbegin(); entry != m_stack.rend(); ++entry)
+  {
+    dirs.push_back(entry->path);
+  }
+}
+
+size_t WorkingDir::depth() const
+{
+  return m_stack.size();
+}
+
+bool WorkingDir::resolve(const std::string &base, const char *path, std::string &resolved)
+{
+  // The resolved prefix has no trailing '/', so the root is empty; a link puts its target before the rest:
+  std::string result = path[0] == '/' || base == "/" ? std::string() : base;
+  std::string rest = path;
+  size_t position = 0;
+  int links = 0;
+  while (position < rest.size())
+  {
+    size_t end = rest.find('/', position);
+    if (end == std::string::npos)
+    {
+      end = rest.size();
+    }
+    std::string name = rest.substr(position, end - position);
+    position = end + 1;
+    if (name.empty() || name == ".")
+    {
+      continue;
+    }
+    if (name == "..")
+    {
+      // The prefix is canonical, so its parent is the last component taken off:
+      size_t slash = result.rfind('/');
+      result.erase(slash == std::string::npos ? 0 : slash);
+      continue;
+    }
+    std::string candidate = result + "/" + name;
+    struct stat st;
+    if (lstat(candidate.c_str(), &st) == SYS_FAIL)
+    {
+      return false;
+    }
+    if (!S_ISLNK(st.st_mode))
+    {
+      result.swap(candidate);
+      continue;
+    }
+    std::string target;
+    if (++links > WORKING_DIR_MAX_LINKS)
+    {
+      errno = ELOOP;
+      return false;
+    }
+    if (!readLink(candidate, target))
+    {
+      return false;
+    }
+    if (!target.empty() && target[0] == '/')
+    {
+      result.clear();
+    }
+    rest = position < rest.size() ? target + "/" + rest.substr(position) : target;
+    position = 0;
+  }
+  resolved = result.empty() ? "/" : result;
+  return true;
+}
+
+int WorkingDir::openCurrent()
+{
+  int fd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+  if (fd == SYS_FAIL)
+  {
+    perror("smash error: open failed");
+    return SYS_FAIL;
+  }
+  return moveAboveRedirections(fd);
+}
+
+void WorkingDir::moveTo(const std::string &path)
+{
+  m_previous = m_isKnown ? m_path : std::string();
+  m_path = path;
+  m_isKnown = true;
+}
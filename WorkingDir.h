@@ -0,0 +1,168 @@
+#ifndef SMASH_WORKING_DIR_H_
+#define SMASH_WORKING_DIR_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// The number of symbolic links followed while resolving one path, as the kernel allows:
+#define WORKING_DIR_MAX_LINKS (40)
+
+/*
+ *  WorkingDir Class:
+ *  Keeps the current directory of the shell as a canonical path, with no "." or ".." components
+ *  and no symbolic links, of any length. The path is read with getcwd only once; every change
+ *  of directory resolves the new path from the current one, so reading it costs no system call.
+ *  Also keeps the directory stack of pushd and popd, each directory held open with O_PATH, so
+ *  returning to one costs a single fchdir however deep it is.
+ */
+class WorkingDir
+{
+public:
+  /*
+   * Constructor of WorkingDir class
+   * Receives no parameters
+   * @return
+   *      A new instance of WorkingDir.
+   */
+  WorkingDir();
+
+  /*
+   * Destructor of the WorkingDir class
+   * Closes the directories of the stack.
+   */
+  ~WorkingDir();
+
+  /*
+   * Disable copy constructor and assignment operator
+   */
+  WorkingDir(WorkingDir const &) = delete;
+  void operator=(WorkingDir const &) = delete;
+
+  /*
+   * Returns the current directory, reading it with getcwd if it is not known yet. A failure is printed.
+   * Receives no parameters
+   * @return
+   *      const string& - the canonical current directory, or an empty string if it cannot be read
+   */
+  const std::string &path();
+
+  /*
+   * Returns the directory before the last change
+   * Receives no parameters
+   * @return
+   *      const string& - the previous directory, or an empty string if the directory never changed
+   */
+  const std::string &previous() const;
+
+  /*
+   * Changes the current directory. A failure is printed.
+   * @param dir - the new directory, absolute or relative to the current one
+   * @return
+   *      bool - false if the directory did not change
+   */
+  bool change(const char *dir);
+
+  /*
+   * Changes back to the previous directory, which becomes the previous one in turn. A failure is printed.
+   * Receives no parameters
+   * @return
+   *      bool - false if the directory did not change, or there is no previous directory
+   */
+  bool changeBack();
+
+  /*
+   * Pushes the current directory on the stack and changes to another one. A failure is printed.
+   * @param dir - the new directory, or nullptr to exchange the current directory with the top of the stack
+   * @return
+   *      bool - false if the directory did not change
+   */
+  bool push(const char *dir);
+
+  /*
+   * Pops the top of the stack and changes to it. A failure is printed.
+   * Receives no parameters
+   * @return
+   *      bool - false if the directory did not change
+   */
+  bool pop();
+
+  /*
+   * Closes every directory of the stack
+   * Receives no parameters
+   * @return
+   *      void
+   */
+  void clearStack();
+
+  /*
+   * Returns the directories of the stack
+   * @param dirs - receives the current directory, then the stack from its top down
+   * @return
+   *      void
+   */
+  void listStack(std::vector<std::string> &dirs);
+
+  /*
+   * Returns the number of directories on the stack
+   * Receives no parameters
+   * @return
+   *      size_t - the number of directories, not counting the current one
+   */
+  size_t depth() const;
+
+  /*
+   * Resolves a path against a canonical directory, as the kernel does: ".." goes up from where
+   * the components before it led, symbolic links included. Only the components named by the
+   * path are looked at, with one lstat each.
+   * @param base - a canonical absolute directory
+   * @param path - the path to resolve
+   * @param resolved - receives the canonical path
+   * @return
+   *      bool - false if a component cannot be resolved; errno is set
+   */
+  static bool resolve(const std::string &base, const char *path, std::string &resolved);
+
+private:
+  /*
+   *  Entry Struct:
+   *  A directory on the stack.
+   *  path: The canonical path of the directory when it was pushed
+   *  fd: An O_PATH descriptor of the directory
+   */
+  struct Entry
+  {
+    std::string path;
+    int fd;
+  };
+
+  /*
+   * Opens the current directory with O_PATH, above the descriptors a redirection can name. A failure is printed.
+   * Receives no parameters
+   * @return
+   *      int - the descriptor, or -1
+   */
+  static int openCurrent();
+
+  /*
+   * Records a change to a directory that is already current
+   * @param path - the canonical path of the new current directory
+   * @return
+   *      void
+   */
+  void moveTo(const std::string &path);
+
+  /*
+   * The internal fields associated with WorkingDir:
+   * m_isKnown: Whether m_path holds the current directory
+   * m_path: The canonical current directory
+   * m_previous: The directory before the last change, empty until the first one
+   * m_stack: The directory stack, its top last
+   */
+  bool m_isKnown;
+  std::string m_path;
+  std::string m_previous;
+  std::vector<Entry> m_stack;
+};
+
+#endif // SMASH_WORKING_DIR_H_
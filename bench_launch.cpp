@@ -0,0 +1,97 @@
+#include <time.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include "Launcher.h"
+
+using namespace std;
+
+#define BENCH_ROUNDS (5)
+#define BENCH_LAUNCHES (200)
+
+/*
+ * Returns the current time of the monotonic clock
+ * Receives no parameters
+ * @return
+ *      double - the time in nanoseconds
+ */
+static double nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Measures how long it takes to launch /bin/true, both until launchProcess returns
+ * and until the program has exited and been reaped. The best of BENCH_ROUNDS rounds is reported.
+ * @param name - the name of the benchmark
+ * @param mode - the launch path
+ * @return
+ *      void
+ */
+static void benchLaunch(const string &name, LaunchMode mode)
+{
+  char program[] = "/bin/true";
+  char *argv[] = {program, nullptr};
+  LaunchSpec spec = makeLaunchSpec(argv);
+  double bestLaunch = 0;
+  double bestTotal = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    double launch = 0;
+    double start = nowNs();
+    for (int i = 0; i < BENCH_LAUNCHES; i++)
+    {
+      double before = nowNs();
+      pid_t pid;
+      if (launchProcess(spec, mode, pid) != 0)
+      {
+        cout << name << ": launch failed" << endl;
+        return;
+      }
+      launch += nowNs() - before;
+      waitpid(pid, nullptr, 0);
+    }
+    double total = (nowNs() - start) / BENCH_LAUNCHES;
+    launch /= BENCH_LAUNCHES;
+    if (round == 0 || launch < bestLaunch)
+    {
+      bestLaunch = launch;
+    }
+    if (round == 0 || total < bestTotal)
+    {
+      bestTotal = total;
+    }
+  }
+  cout << left << setw(24) << name << fixed << setprecision(1) << bestLaunch / 1000 << " us/launch, "
+       << bestTotal / 1000 << " us/launch+wait" << endl;
+}
+
+int main()
+{
+  // Fork copies the page tables of the whole shell, so measure with a growing resident set:
+  size_t residentMb[] = {0, 64, 512};
+  char *ballast = nullptr;
+  for (size_t mb : residentMb)
+  {
+    if (mb != 0)
+    {
+      free(ballast);
+      ballast = static_cast<char *>(malloc(mb << 20));
+      if (ballast == nullptr)
+      {
+        cout << "cannot allocate " << mb << " MB" << endl;
+        return 1;
+      }
+      memset(ballast, 1, mb << 20);
+    }
+    benchLaunch("spawn +" + to_string(mb) + "MB", LAUNCH_SPAWN);
+    benchLaunch("fork +" + to_string(mb) + "MB", LAUNCH_FORK);
+  }
+  free(ballast);
+  return 0;
+}
@@ -0,0 +1,164 @@
+#include <time.h>
+#include <string.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include "Parser.h"
+
+using namespace std;
+
+#define BENCH_ROUNDS (7)
+
+static volatile int sink = 0;
+
+/*
+ * Returns the current time of the monotonic clock
+ * Receives no parameters
+ * @return
+ *      double - the time in nanoseconds
+ */
+static double nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Measures the time it takes to parse a set of lines into a reused arena.
+ * The best of BENCH_ROUNDS rounds is reported.
+ * @param name - the name of the benchmark
+ * @param lines - the lines to parse
+ * @param numLines - the number of lines
+ * @param iterations - how many times each round parses the whole set
+ * @return
+ *      void
+ */
+static void benchParse(const char *name, const char **lines, int numLines, int iterations)
+{
+  char buffer[LINE_ARENA_SIZE];
+  LineArena arena(buffer, sizeof(buffer));
+  ParsedLine parsed;
+  double best = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    double start = nowNs();
+    for (int i = 0; i < iterations; i++)
+    {
+      for (int j = 0; j < numLines; j++)
+      {
+        arena.reset();
+        if (!parseCommandLine(lines[j], arena, parsed))
+        {
+          cout << name << ": rejected" << endl;
+          return;
+        }
+        sink += parsed.numArgs;
+      }
+    }
+    double perLine = (nowNs() - start) / ((double)iterations * numLines);
+    if (round == 0 || perLine < best)
+    {
+      best = perLine;
+    }
+  }
+  cout << left << setw(24) << name << fixed << setprecision(1) << best << " ns/line" << endl;
+}
+
+/*
+ * Measures the time it takes to find the metacharacters of a line, either with the
+ * per-character searches the shell used to make or with a single classifier pass.
+ * The best of BENCH_ROUNDS rounds is reported.
+ * @param name - the name of the benchmark
+ * @param line - the line to search
+ * @param isa - the instruction set of the classifier, or -1 for the per-character searches
+ * @param iterations - how many times each round searches the line
+ * @return
+ *      void
+ */
+static void benchClassify(const char *name, const string &line, int isa, int iterations)
+{
+  if (isa > (int)bestClassifierIsa())
+  {
+    cout << left << setw(24) << name << "unsupported" << endl;
+    return;
+  }
+  char buffer[LINE_ARENA_SIZE];
+  LineArena arena(buffer, sizeof(buffer));
+  LineClass cls;
+  double best = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    double start = nowNs();
+    for (int i = 0; i < iterations; i++)
+    {
+      if (isa < 0)
+      {
+        const char *cmd_line = line.c_str();
+        string cmd_s = string(cmd_line);
+        sink += strstr(cmd_line, ">>") != nullptr;
+        sink += strstr(cmd_line, ">") != nullptr;
+        sink += strchr(cmd_line, '|') != nullptr;
+        sink += strstr(cmd_line, "|&") != nullptr;
+        sink += cmd_s.find('*') != string::npos;
+        sink += cmd_s.find('?') != string::npos;
+        sink += (int)cmd_s.find_last_not_of(" \n\r\t\f\v");
+        sink += cmd_s.find('&') != string::npos;
+      }
+      else
+      {
+        arena.reset();
+        classifyLineWith((ClassifierIsa)isa, line.c_str(), line.size(), arena, cls);
+        sink += cls.mask;
+      }
+    }
+    double perLine = (nowNs() - start) / iterations;
+    if (round == 0 || perLine < best)
+    {
+      best = perLine;
+    }
+  }
+  cout << left << setw(24) << name << fixed << setprecision(1) << best << " ns/line" << endl;
+}
+
+int main()
+{
+  const char *shortLines[] = {"showpid", "pwd", "cd ..", "sleep 100 &", "chprompt hello", "jobs",
+                              "echo hello > out.txt", "ls -l | grep txt", "kill -9 3", "chmod 777 file"};
+  benchParse("parse short", shortLines, sizeof(shortLines) / sizeof(shortLines[0]), 200000);
+
+  string medium;
+  for (int i = 0; i < 20; i++)
+  {
+    medium += "argument" + to_string(i) + " ";
+  }
+  const char *mediumLines[] = {medium.c_str()};
+  benchParse("parse 20 args", mediumLines, 1, 200000);
+
+  string longLine;
+  for (int i = 0; i < 2000; i++)
+  {
+    longLine += "argument" + to_string(i) + " ";
+  }
+  const char *longLines[] = {longLine.c_str()};
+  benchParse("parse 2000 args", longLines, 1, 2000);
+
+  // A long line with its only metacharacters at the very end, so every search scans all of it:
+  string sizes[] = {"1k", "16k"};
+  size_t lengths[] = {1024, 16384};
+  for (int i = 0; i < 2; i++)
+  {
+    string line;
+    while (line.size() < lengths[i] - 8)
+    {
+      line += "argument ";
+    }
+    line += "> out &";
+    int iterations = (int)(20000000 / lengths[i]);
+    benchClassify(("strchr/find " + sizes[i]).c_str(), line, -1, iterations);
+    benchClassify(("classify scalar " + sizes[i]).c_str(), line, CLASSIFIER_SCALAR, iterations);
+    benchClassify(("classify sse2 " + sizes[i]).c_str(), line, CLASSIFIER_SSE2, iterations);
+    benchClassify(("classify avx2 " + sizes[i]).c_str(), line, CLASSIFIER_AVX2, iterations);
+  }
+  return 0;
+}
@@ -0,0 +1,393 @@
+#include <time.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Commands.h"
+#include "Jobs.h"
+#include "Launcher.h"
+#include "Parser.h"
+
+using namespace std;
+
+/*
+ * Benchmarks of the shell's command core: parsing, dispatch, the jobs list and launching.
+ * Every result is printed as a line of JSON, so runs of different releases can be compared by a script:
+ *   {"bench":"jobs.get_by_id","n":1000,"ns_per_op":41.2}
+ * n is the size the benchmark ran at: the number of lines parsed, of jobs in the list, or of
+ * megabytes the shell had resident while launching. The best of BENCH_ROUNDS rounds is reported.
+ * A prefix given as the only argument runs just the benchmarks whose names start with it.
+ */
+
+#define BENCH_ROUNDS (5)
+#define BENCH_LAUNCHES (200)
+// Above the largest PID Linux can hand out (PID_MAX_LIMIT), so no fake job can be mistaken for a process:
+#define BENCH_FIRST_PID (1 << 23)
+
+#define BENCH_BUILTIN_NAME(name, cls, flags) name,
+
+static volatile long sink = 0;
+static const char *selected = "";
+
+/*
+ * Returns the current time of the monotonic clock
+ * Receives no parameters
+ * @return
+ *      double - the time in nanoseconds
+ */
+static double nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Checks whether a benchmark was asked for
+ * @param bench - the name of the benchmark
+ * @return
+ *      bool - true if the name starts with the selected prefix
+ */
+static bool isSelected(const string &bench)
+{
+  return bench.compare(0, strlen(selected), selected) == 0;
+}
+
+/*
+ * Prints the result of a benchmark as a line of JSON
+ * @param bench - the name of the benchmark
+ * @param n - the size it ran at
+ * @param nsPerOp - the best time of one operation, in nanoseconds
+ * @return
+ *      void
+ */
+static void report(const string &bench, long n, double nsPerOp)
+{
+  char value[32];
+  snprintf(value, sizeof(value), "%.1f", nsPerOp);
+  cout << "{\"bench\":\"" << bench << "\",\"n\":" << n << ",\"ns_per_op\":" << value << "}" << endl;
+}
+
+/*
+ * Times an operation over BENCH_ROUNDS rounds and reports the best round
+ * @param bench - the name of the benchmark
+ * @param n - the size it runs at
+ * @param ops - how many operations a round makes
+ * @param round - runs one round
+ * @return
+ *      void
+ */
+template <typename Round>
+static void timeRounds(const string &bench, long n, long ops, Round round)
+{
+  if (!isSelected(bench))
+  {
+    return;
+  }
+  double best = 0;
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+  {
+    double start = nowNs();
+    round();
+    double perOp = (nowNs() - start) / ops;
+    if (i == 0 || perOp < best)
+    {
+      best = perOp;
+    }
+  }
+  report(bench, n, best);
+}
+
+/*
+ * Measures parseCommandLine, the first step of every line the shell runs
+ * @param name - the name of the benchmark
+ * @param lines - the lines to parse
+ * @param iterations - how many times each round parses all of them
+ * @return
+ *      void
+ */
+static void benchParse(const string &name, const vector<string> &lines, int iterations)
+{
+  char buffer[LINE_ARENA_SIZE];
+  LineArena arena(buffer, sizeof(buffer));
+  ParsedLine parsed;
+  timeRounds(name, lines.size(), (long)iterations * lines.size(), [&]()
+  {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (const string &line : lines)
+      {
+        arena.reset();
+        parseCommandLine(line.c_str(), arena, parsed);
+        sink += parsed.numArgs;
+      }
+    }
+  });
+}
+
+/*
+ * Measures how a line reaches its command: the built-in table, classification of a parsed line,
+ * the plan cache, and creating the command object for lines that do not run a built-in command
+ * @param lines - the lines to dispatch
+ * @param iterations - how many times each round dispatches all of them
+ * @return
+ *      void
+ */
+static void benchDispatch(const vector<string> &lines, int iterations)
+{
+  SmallShell &shell = SmallShell::getInstance();
+  const char *names[] = {SMASH_BUILTINS(BENCH_BUILTIN_NAME) "sleep", "ls", "grep"};
+  long numNames = sizeof(names) / sizeof(names[0]);
+  timeRounds("dispatch.find_builtin", numNames, iterations * numNames, [&]()
+  {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (const char *name : names)
+      {
+        sink += findBuiltin(name) != nullptr;
+      }
+    }
+  });
+
+  // Plans are parsed once, so only the classification is timed:
+  vector<char> buffer(LINE_ARENA_SIZE * lines.size());
+  vector<CommandPlan> plans(lines.size());
+  for (size_t j = 0; j < lines.size(); j++)
+  {
+    LineArena arena(buffer.data() + j * LINE_ARENA_SIZE, LINE_ARENA_SIZE);
+    parseCommandLine(lines[j].c_str(), arena, plans[j].line);
+  }
+  timeRounds("dispatch.classify", lines.size(), (long)iterations * lines.size(), [&]()
+  {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (CommandPlan &plan : plans)
+      {
+        SmallShell::classifyCommand(plan);
+        sink += plan.kind;
+      }
+    }
+  });
+
+  timeRounds("dispatch.plan_cached", lines.size(), (long)iterations * lines.size(), [&]()
+  {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (const string &line : lines)
+      {
+        sink += shell.planCommand(line.c_str())->kind;
+      }
+    }
+  });
+
+  // A miss parses the line once and copies the parse into the cache; the cache is too small for any line to hit:
+  PlanCache misses(1);
+  char missBuffer[LINE_ARENA_SIZE];
+  LineArena missArena(missBuffer, sizeof(missBuffer));
+  CommandPlan missed;
+  timeRounds("dispatch.plan_miss", lines.size(), (long)iterations * lines.size(), [&]()
+  {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (const string &line : lines)
+      {
+        if (misses.lookup(line.c_str()) == nullptr)
+        {
+          missArena.reset();
+          parseCommandLine(line.c_str(), missArena, missed.line);
+          SmallShell::classifyCommand(missed);
+          sink += misses.insert(line.c_str(), missed)->kind;
+        }
+      }
+    }
+  });
+
+  // The whole path from a line to the command that executes it, as executeCommand takes it:
+  timeRounds("dispatch.create", lines.size(), (long)iterations * lines.size(), [&]()
+  {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (const string &line : lines)
+      {
+        const CommandPlan *plan = shell.planCommand(line.c_str());
+        if (plan->kind == CMD_BUILTIN)
+        {
+          sink += plan->builtin->flags;
+          continue;
+        }
+        Command *cmd = shell.CreateCommand(line.c_str(), *plan);
+        sink += cmd != nullptr;
+        delete cmd;
+      }
+    }
+  });
+}
+
+/*
+ * Measures adding, finding and removing jobs in a list of a given size. The jobs have no process,
+ * so what is timed is the bookkeeping of the list; lookups do not poll for jobs that finished.
+ * @param numJobs - the number of jobs in the list
+ * @return
+ *      void
+ */
+static void benchJobs(int numJobs)
+{
+  // Jobs are found and removed in a random order, so no access pattern favours the list:
+  vector<int> order(numJobs);
+  for (int i = 0; i < numJobs; i++)
+  {
+    order[i] = i;
+  }
+  shuffle(order.begin(), order.end(), mt19937(numJobs));
+  string cmd = "sleep 100 &";
+  double best[4] = {0, 0, 0, 0};
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    JobsList jobs;
+    double times[5];
+    times[0] = nowNs();
+    for (int i = 0; i < numJobs; i++)
+    {
+      jobs.addJob(cmd.c_str(), BENCH_FIRST_PID + i, -1);
+    }
+    times[1] = nowNs();
+    for (int i : order)
+    {
+      sink += jobs.getJobById(i + 1) != nullptr;
+    }
+    times[2] = nowNs();
+    for (int i : order)
+    {
+      sink += jobs.getJobByPid(BENCH_FIRST_PID + i) != nullptr;
+    }
+    times[3] = nowNs();
+    for (int i : order)
+    {
+      jobs.removeJobById(i + 1);
+    }
+    times[4] = nowNs();
+    for (int phase = 0; phase < 4; phase++)
+    {
+      double perOp = (times[phase + 1] - times[phase]) / numJobs;
+      if (round == 0 || perOp < best[phase])
+      {
+        best[phase] = perOp;
+      }
+    }
+  }
+  const char *names[] = {"jobs.add", "jobs.get_by_id", "jobs.get_by_pid", "jobs.remove"};
+  for (int phase = 0; phase < 4; phase++)
+  {
+    if (isSelected(names[phase]))
+    {
+      report(names[phase], numJobs, best[phase]);
+    }
+  }
+}
+
+/*
+ * Measures launching /bin/true, both until launchProcess returns and until the program
+ * has exited and been reaped
+ * @param name - the name of the launch path
+ * @param mode - the launch path
+ * @param residentMb - the megabytes the shell has resident
+ * @return
+ *      void
+ */
+static void benchLaunch(const string &name, LaunchMode mode, long residentMb)
+{
+  string bench = "launch." + name;
+  if (!isSelected(bench))
+  {
+    return;
+  }
+  char program[] = "/bin/true";
+  char *argv[] = {program, nullptr};
+  LaunchSpec spec = makeLaunchSpec(argv);
+  double bestLaunch = 0;
+  double bestTotal = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    double launch = 0;
+    double start = nowNs();
+    for (int i = 0; i < BENCH_LAUNCHES; i++)
+    {
+      double before = nowNs();
+      pid_t pid;
+      if (launchProcess(spec, mode, pid) != 0)
+      {
+        cerr << bench << ": launch failed" << endl;
+        return;
+      }
+      launch += nowNs() - before;
+      waitpid(pid, nullptr, 0);
+    }
+    double total = (nowNs() - start) / BENCH_LAUNCHES;
+    launch /= BENCH_LAUNCHES;
+    if (round == 0 || launch < bestLaunch)
+    {
+      bestLaunch = launch;
+    }
+    if (round == 0 || total < bestTotal)
+    {
+      bestTotal = total;
+    }
+  }
+  report(bench, residentMb, bestLaunch);
+  report(bench + "_wait", residentMb, bestTotal);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc > 2)
+  {
+    cerr << "usage: " << argv[0] << " [benchmark prefix]" << endl;
+    return 1;
+  }
+  if (argc == 2)
+  {
+    selected = argv[1];
+  }
+
+  vector<string> shortLines = {"showpid", "pwd", "cd ..", "sleep 100 &", "chprompt hello", "jobs",
+                               "echo hello > out.txt", "ls -l | grep txt", "kill -9 3", "chmod 777 file"};
+  benchParse("parse.short", shortLines, 100000);
+  string longLine;
+  for (int i = 0; i < 200; i++)
+  {
+    longLine += "argument" + to_string(i) + " ";
+  }
+  benchParse("parse.200_args", {longLine}, 5000);
+
+  benchDispatch(shortLines, 100000);
+
+  for (int numJobs = 10; numJobs <= 100000; numJobs *= 10)
+  {
+    benchJobs(numJobs);
+  }
+
+  // Fork copies the page tables of the whole shell, so launches are also measured with a large resident set:
+  long residentMb[] = {0, 256};
+  char *ballast = nullptr;
+  for (long mb : residentMb)
+  {
+    if (mb != 0)
+    {
+      ballast = static_cast<char *>(malloc(mb << 20));
+      if (ballast == nullptr)
+      {
+        cerr << "cannot allocate " << mb << " MB" << endl;
+        return 1;
+      }
+      memset(ballast, 1, mb << 20);
+    }
+    benchLaunch("spawn", LAUNCH_SPAWN, mb);
+    benchLaunch("fork", LAUNCH_FORK, mb);
+  }
+  free(ballast);
+  return 0;
+}
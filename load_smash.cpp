@@ -0,0 +1,512 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Histogram.h"
+
+using namespace std;
+
+/*
+ * A load generator that runs one large command stream through smash, bash and dash and compares them.
+ * The stream mixes background sleeps, redirections, pipes and built-in commands, in the form of
+ * test_input1.txt. Every command is followed by a marker command, and the next command is only sent
+ * once the marker's output came back, so the time between them is the latency of the command.
+ * Each shell gets a row per kind of command in a CSV file of its own run:
+ *   shell,kind,commands,seconds,commands_per_s,p50_us,p90_us,p99_us,max_us,peak_rss_kb
+ * seconds is the time the shell spent on the commands of that kind, and peak_rss_kb is the largest
+ * resident set of the shell process itself, not of the programs it ran.
+ */
+
+#define LOAD_DEFAULT_COMMANDS (5000)
+// How long a command may take before the shell is considered stuck:
+#define LOAD_COMMAND_TIMEOUT_MS (10000)
+#define LOAD_READ_SIZE (4096)
+
+#define SYS_FAIL -1
+
+/*
+ * The kinds of command a stream mixes, with the share of the stream each takes.
+ */
+enum LoadKind
+{
+  LOAD_BACKGROUND,
+  LOAD_REDIRECTION,
+  LOAD_PIPE,
+  LOAD_BUILTIN,
+  NUM_LOAD_KINDS
+};
+
+static const char *const LOAD_KIND_NAMES[NUM_LOAD_KINDS] = {"background", "redirection", "pipe", "builtin"};
+static const int LOAD_KIND_PERCENT[NUM_LOAD_KINDS] = {30, 20, 15, 35};
+
+/*
+ *  LoadCommand Struct:
+ *  A line of the stream.
+ *  kind: The kind of command
+ *  line: The line, which every shell under test runs the same way
+ */
+struct LoadCommand
+{
+  LoadKind kind;
+  string line;
+};
+
+/*
+ *  ShellUnderTest Struct:
+ *  A shell the stream is run through, and how it is driven.
+ *  name: The name the shell is reported by
+ *  path: The program
+ *  marker: A cheap built-in command whose output contains "pid is "
+ *  quit: The line that ends the shell
+ */
+struct ShellUnderTest
+{
+  string name;
+  string path;
+  string marker;
+  string quit;
+};
+
+/*
+ *  LoadResult Struct:
+ *  What running a stream through a shell measured.
+ *  latency: The latency of the commands of each kind, in nanoseconds
+ *  latencyNs: The sum of the latencies of each kind
+ *  allLatency: The latency of every command
+ *  totalNs: The time from the first command to the marker of the last
+ *  peakRssKb: The largest resident set of the shell
+ */
+struct LoadResult
+{
+  Histogram latency[NUM_LOAD_KINDS];
+  int64_t latencyNs[NUM_LOAD_KINDS];
+  Histogram allLatency;
+  int64_t totalNs;
+  long peakRssKb;
+};
+
+/*
+ * Returns the current time of the monotonic clock
+ * Receives no parameters
+ * @return
+ *      int64_t - the time in nanoseconds
+ */
+static int64_t nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Generates a stream of commands. None of them reads its standard input, which is the stream itself.
+ * @param numCommands - the number of commands
+ * @param seed - the seed of the generator, so a stream can be generated again
+ * @param dir - a scratch directory the commands work in
+ * @return
+ *      vector<LoadCommand> - the stream
+ */
+static vector<LoadCommand> generateStream(int numCommands, unsigned seed, const string &dir)
+{
+  mt19937 random(seed);
+  const string sleeps[] = {"0.05", "0.2", "0.5"};
+  vector<LoadCommand> stream;
+  for (int i = 0; i < numCommands; i++)
+  {
+    int pick = random() % 100;
+    int kind = 0;
+    while (pick >= LOAD_KIND_PERCENT[kind])
+    {
+      pick -= LOAD_KIND_PERCENT[kind];
+      kind++;
+    }
+    int variant = random() % 4;
+    string line;
+    switch (kind)
+    {
+    case LOAD_BACKGROUND:
+      line = "sleep " + sleeps[variant % 3] + " &";
+      break;
+    case LOAD_REDIRECTION:
+      {
+        const string lines[] = {"echo " + to_string(i) + " > " + dir + "/out.txt",
+                                "echo " + to_string(i) + " >> " + dir + "/out.txt",
+                                "cat " + dir + "/out.txt > " + dir + "/copy.txt",
+                                "cat " + dir + "/copy.txt >> " + dir + "/log.txt"};
+        line = lines[variant];
+      }
+      break;
+    case LOAD_PIPE:
+      {
+        const string lines[] = {"echo a b c d | wc -w", "cat " + dir + "/out.txt | grep 1",
+                                "ls " + dir + " | sort -r", "cat " + dir + "/copy.txt | wc -c"};
+        line = lines[variant];
+      }
+      break;
+    default:
+      {
+        const string lines[] = {"pwd", "cd " + dir + "/sub", "cd " + dir, "jobs"};
+        line = lines[variant];
+      }
+      break;
+    }
+    stream.push_back({static_cast<LoadKind>(kind), line});
+  }
+  return stream;
+}
+
+/*
+ * Empties the scratch directory, so every shell starts from the same files
+ * @param dir - the scratch directory
+ * @return
+ *      void
+ */
+static void prepareScratch(const string &dir)
+{
+  mkdir((dir + "/sub").c_str(), 0755);
+  const char *files[] = {"/out.txt", "/copy.txt", "/log.txt"};
+  for (const char *file : files)
+  {
+    ofstream(dir + file, ios::trunc) << "0" << endl;
+  }
+}
+
+/*
+ * Starts a shell with pipes for its standard input and output; its errors are discarded
+ * @param shell - the shell
+ * @param dir - the directory it starts in
+ * @param input - set to the end of the pipe to write commands to
+ * @param output - set to the end of the pipe to read the shell's output from
+ * @return
+ *      pid_t - the PID of the shell, or -1 if it could not be started
+ */
+static pid_t startShell(const ShellUnderTest &shell, const string &dir, int &input, int &output)
+{
+  int toShell[2];
+  int fromShell[2];
+  if (pipe2(toShell, O_CLOEXEC) == SYS_FAIL || pipe2(fromShell, O_CLOEXEC) == SYS_FAIL)
+  {
+    perror("pipe2");
+    return SYS_FAIL;
+  }
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    int null = open("/dev/null", O_WRONLY);
+    if (dup2(toShell[0], STDIN_FILENO) == SYS_FAIL || dup2(fromShell[1], STDOUT_FILENO) == SYS_FAIL ||
+        dup2(null, STDERR_FILENO) == SYS_FAIL || chdir(dir.c_str()) == SYS_FAIL)
+    {
+      _exit(127);
+    }
+    execlp(shell.path.c_str(), shell.path.c_str(), static_cast<char *>(nullptr));
+    _exit(127);
+  }
+  close(toShell[0]);
+  close(fromShell[1]);
+  if (pid == SYS_FAIL)
+  {
+    perror("fork");
+    close(toShell[1]);
+    close(fromShell[0]);
+    return SYS_FAIL;
+  }
+  input = toShell[1];
+  output = fromShell[0];
+  return pid;
+}
+
+/*
+ * Reads the shell's output until the marker's line has come
+ * @param output - the shell's output
+ * @param pending - output read but not yet looked at; what follows the marker is kept
+ * @return
+ *      bool - false if the shell ended or took too long
+ */
+static bool awaitMarker(int output, string &pending)
+{
+  size_t searched = 0;
+  while (true)
+  {
+    size_t marker = pending.find("pid is ", searched);
+    size_t end = marker == string::npos ? string::npos : pending.find('\n', marker);
+    if (end != string::npos)
+    {
+      pending.erase(0, end + 1);
+      return true;
+    }
+    // The marker may be split between reads, so the last few bytes are searched again:
+    searched = pending.size() < 7 ? 0 : pending.size() - 7;
+    if (marker != string::npos)
+    {
+      searched = marker;
+    }
+    struct pollfd ready = {output, POLLIN, 0};
+    int count = poll(&ready, 1, LOAD_COMMAND_TIMEOUT_MS);
+    if (count == SYS_FAIL && errno == EINTR)
+    {
+      continue;
+    }
+    if (count <= 0)
+    {
+      return false;
+    }
+    char buffer[LOAD_READ_SIZE];
+    ssize_t length = read(output, buffer, sizeof(buffer));
+    if (length <= 0)
+    {
+      return false;
+    }
+    pending.append(buffer, length);
+  }
+}
+
+/*
+ * Writes a whole line to the shell
+ * @param input - the shell's input
+ * @param line - the line, with its newline
+ * @return
+ *      bool - false if the shell is no longer reading
+ */
+static bool writeLine(int input, const string &line)
+{
+  size_t written = 0;
+  while (written < line.size())
+  {
+    ssize_t length = write(input, line.data() + written, line.size() - written);
+    if (length == SYS_FAIL && errno != EINTR)
+    {
+      return false;
+    }
+    written += length == SYS_FAIL ? 0 : length;
+  }
+  return true;
+}
+
+/*
+ * Runs a stream through a shell, one command at a time
+ * @param shell - the shell
+ * @param stream - the stream
+ * @param dir - the scratch directory
+ * @param result - receives what was measured
+ * @return
+ *      bool - false if the shell could not run the whole stream
+ */
+static bool runStream(const ShellUnderTest &shell, const vector<LoadCommand> &stream, const string &dir, LoadResult &result)
+{
+  prepareScratch(dir);
+  int input;
+  int output;
+  pid_t pid = startShell(shell, dir, input, output);
+  if (pid == SYS_FAIL)
+  {
+    return false;
+  }
+  string pending;
+  // The first marker shows the shell is up, so its start is not counted:
+  bool isRunning = writeLine(input, shell.marker + "\n") && awaitMarker(output, pending);
+  if (!isRunning)
+  {
+    cerr << shell.name << ": " << shell.path << " did not start" << endl;
+  }
+  int64_t startNs = nowNs();
+  for (size_t i = 0; isRunning && i < stream.size(); i++)
+  {
+    int64_t sentNs = nowNs();
+    isRunning = writeLine(input, stream[i].line + "\n" + shell.marker + "\n") && awaitMarker(output, pending);
+    if (!isRunning)
+    {
+      cerr << shell.name << ": stopped answering at \"" << stream[i].line << "\"" << endl;
+      break;
+    }
+    int64_t latencyNs = nowNs() - sentNs;
+    result.latency[stream[i].kind].record(latencyNs);
+    result.latencyNs[stream[i].kind] += latencyNs;
+    result.allLatency.record(latencyNs);
+  }
+  result.totalNs = nowNs() - startNs;
+  if (isRunning)
+  {
+    writeLine(input, shell.quit + "\n");
+  }
+  else
+  {
+    kill(pid, SIGKILL);
+  }
+  close(input);
+  struct rusage usage;
+  int status;
+  if (wait4(pid, &status, 0, &usage) == SYS_FAIL)
+  {
+    perror("wait4");
+  }
+  close(output);
+  result.peakRssKb = usage.ru_maxrss;
+  return isRunning;
+}
+
+/*
+ * Writes a row of the results
+ * @param csv - the CSV file
+ * @param shell - the name of the shell
+ * @param kind - the kind of command, or "all"
+ * @param latency - the latency of the commands
+ * @param seconds - the time spent on them
+ * @param peakRssKb - the largest resident set of the shell
+ * @return
+ *      void
+ */
+static void writeRow(ofstream &csv, const string &shell, const char *kind, const Histogram &latency, double seconds,
+                     long peakRssKb)
+{
+  char row[256];
+  snprintf(row, sizeof(row), "%s,%s,%llu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%ld", shell.c_str(), kind,
+           static_cast<unsigned long long>(latency.count()), seconds, seconds > 0 ? latency.count() / seconds : 0.0,
+           latency.percentile(50) / 1e3, latency.percentile(90) / 1e3, latency.percentile(99) / 1e3,
+           latency.max() / 1e3, peakRssKb);
+  csv << row << endl;
+}
+
+/*
+ * Prints how the load generator is used
+ * @param program - the name it was run by
+ * @return
+ *      int - the exit status
+ */
+static int printUsage(const char *program)
+{
+  cerr << "usage: " << program << " [-n commands] [-r seed] [-o results.csv] [-S smash] [-s stream.txt]" << endl
+       << "  -s writes the stream smash runs, and keeps its scratch directory, so it can be replayed with ./smash < stream.txt"
+       << endl;
+  return 1;
+}
+
+int main(int argc, char *argv[])
+{
+  int numCommands = LOAD_DEFAULT_COMMANDS;
+  unsigned seed = 1;
+  string csvPath;
+  string smashPath = "./smash";
+  string streamPath;
+  int option;
+  while ((option = getopt(argc, argv, "n:r:o:S:s:")) != SYS_FAIL)
+  {
+    switch (option)
+    {
+    case 'n':
+      numCommands = atoi(optarg);
+      break;
+    case 'r':
+      seed = strtoul(optarg, nullptr, 10);
+      break;
+    case 'o':
+      csvPath = optarg;
+      break;
+    case 'S':
+      smashPath = optarg;
+      break;
+    case 's':
+      streamPath = optarg;
+      break;
+    default:
+      return printUsage(argv[0]);
+    }
+  }
+  if (optind != argc || numCommands <= 0)
+  {
+    return printUsage(argv[0]);
+  }
+  if (csvPath.empty())
+  {
+    char name[64];
+    time_t now = time(nullptr);
+    strftime(name, sizeof(name), "smash_load_%Y%m%d_%H%M%S.csv", localtime(&now));
+    csvPath = name;
+  }
+  // A shell that dies mid-stream must not take the load generator with it:
+  signal(SIGPIPE, SIG_IGN);
+
+  char dirTemplate[] = "/tmp/smash_load_XXXXXX";
+  if (mkdtemp(dirTemplate) == nullptr)
+  {
+    perror("mkdtemp");
+    return 1;
+  }
+  string dir = dirTemplate;
+  // The shells start in the scratch directory, so a relative path to smash would no longer lead to it:
+  if (smashPath.find('/') != string::npos)
+  {
+    char *absolute = realpath(smashPath.c_str(), nullptr);
+    if (absolute == nullptr)
+    {
+      perror(smashPath.c_str());
+      return 1;
+    }
+    smashPath = absolute;
+    free(absolute);
+  }
+  vector<LoadCommand> stream = generateStream(numCommands, seed, dir);
+  vector<ShellUnderTest> shells = {{"smash", smashPath, "showpid", "quit kill"},
+                                   {"bash", "bash", "echo smash pid is $$", "exit"},
+                                   {"dash", "dash", "echo smash pid is $$", "exit"}};
+  if (!streamPath.empty())
+  {
+    ofstream saved(streamPath);
+    for (const LoadCommand &command : stream)
+    {
+      saved << command.line << endl;
+    }
+    saved << shells[0].quit << endl;
+  }
+
+  ofstream csv(csvPath);
+  if (!csv)
+  {
+    perror(csvPath.c_str());
+    return 1;
+  }
+  csv << "shell,kind,commands,seconds,commands_per_s,p50_us,p90_us,p99_us,max_us,peak_rss_kb" << endl;
+  int failures = 0;
+  for (const ShellUnderTest &shell : shells)
+  {
+    LoadResult result = {};
+    if (!runStream(shell, stream, dir, result))
+    {
+      failures++;
+    }
+    double seconds = result.totalNs / 1e9;
+    writeRow(csv, shell.name, "all", result.allLatency, seconds, result.peakRssKb);
+    for (int kind = 0; kind < NUM_LOAD_KINDS; kind++)
+    {
+      writeRow(csv, shell.name, LOAD_KIND_NAMES[kind], result.latency[kind], result.latencyNs[kind] / 1e9,
+               result.peakRssKb);
+    }
+    cout << shell.name << ": " << result.allLatency.count() << " commands in " << seconds << " s, p99 "
+         << result.allLatency.percentile(99) / 1e3 << " us, peak RSS " << result.peakRssKb << " KB" << endl;
+  }
+  cout << "results written to " << csvPath << endl;
+
+  // A saved stream works in the scratch directory, so it is kept for the stream to be replayed:
+  string cleanup = "rm -rf " + dir;
+  if (!streamPath.empty())
+  {
+    cout << "stream written to " << streamPath << ", working in " << dir << endl;
+  }
+  else if (system(cleanup.c_str()) != 0)
+  {
+    cerr << "could not remove " << dir << endl;
+  }
+  return failures == 0 ? 0 : 1;
+}
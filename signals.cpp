@@ -11,16 +11,19 @@ void ctrlCHandler(int sig_num) {
    SmallShell& smash = SmallShell::getInstance();
   cout << "smash: got ctrl-C" << endl;
    if(smash.m_pid_fg){
-    if (kill(smash.m_pid_fg, SIGINT) == SYS_FAIL) {
+    // To the whole process group, through the process fd, so every stage of a pipeline gets it
+    // and a process that reused the PID cannot:
+    if (signalProcessGroup(smash.m_pid_fg, smash.m_pidfd_fg, SIGINT) == SYS_FAIL) {
         perror("smash error: kill failed");
         return;
      }
+     smash.markSignalSent();
      cout << "smash: process " << smash.m_pid_fg << " was killed" << endl;
      smash.m_pid_fg = 0;
    }
 }
 
-void alarmHandler(int sig_num) {
-  // TODO: Add your implementation
+void childHandler(int sig_num) {
+  // Nothing to do: the signal only interrupts the shell's wait for the foreground, to see
+  // whether it stopped (see JobsList::waitForChild).
 }
-
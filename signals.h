@@ -2,6 +2,6 @@
 #define SMASH__SIGNALS_H_
 
 void ctrlCHandler(int sig_num);
-void alarmHandler(int sig_num);
+void childHandler(int sig_num);
 
 #endif //SMASH__SIGNALS_H_
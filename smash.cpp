@@ -3,18 +3,24 @@
 #include <sys/wait.h>
 #include <signal.h>
 #include "Commands.h"
+#include "InputBuffer.h"
 #include "signals.h"
 
 int main(int argc, char* argv[]) {
     if(signal(SIGINT , ctrlCHandler)==SIG_ERR) {
         perror("smash error: failed to set ctrl-C handler");
     }
+    if(signal(SIGCHLD , childHandler)==SIG_ERR) {
+        perror("smash error: failed to set child handler");
+    }
 
-    //TODO: setup sig alarm handler
-
+    // The input is read through a buffer whose content is known, so buffered lines are not waited for:
+    InputBuffer input(STDIN_FILENO);
+    std::cin.rdbuf(&input);
     SmallShell& smash = SmallShell::getInstance();
     while(true) {
         std::cout << smash.getPrompt() << "> ";
+        smash.getJobs()->waitForInput(STDIN_FILENO, input);
         std::string cmd_line;
         std::getline(std::cin, cmd_line);
         smash.executeCommand(cmd_line.c_str());
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Glob.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+/*
+ * Checks the result of matching a name against a pattern
+ * @param pattern - the pattern
+ * @param name - the name
+ * @param expected - whether the name should match
+ * @return
+ *      void
+ */
+static void checkMatch(const char *pattern, const char *name, bool expected)
+{
+  if (GlobExpander::matchName(pattern, strlen(pattern), name) != expected)
+  {
+    fail("\"" + string(pattern) + "\" " + (expected ? "should" : "should not") + " match \"" + name + "\"");
+  }
+}
+
+/*
+ * Expands a pattern and compares the matches with the expected paths
+ * @param globber - the expander
+ * @param pattern - the pattern
+ * @param expected - the expected paths, separated by single spaces ("" for no match)
+ * @return
+ *      void
+ */
+static void checkExpand(GlobExpander &globber, const char *pattern, const char *expected)
+{
+  vector<string> matches;
+  globber.expandPattern(pattern, matches);
+  string joined;
+  for (const string &match : matches)
+  {
+    joined += (joined.empty() ? "" : " ") + match;
+  }
+  if (joined != expected)
+  {
+    fail("\"" + string(pattern) + "\" expanded to \"" + joined + "\"");
+  }
+}
+
+/*
+ * Creates an empty file
+ * @param path - the file
+ * @return
+ *      void
+ */
+static void touch(const char *path)
+{
+  close(open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+}
+
+/*
+ * Sets the modification time of a directory to a fixed point in the past, so its listing can be kept
+ * @param dir - the directory
+ * @return
+ *      void
+ */
+static void settle(const char *dir)
+{
+  static time_t stamp = 1000000000;
+  struct timespec times[2];
+  times[0].tv_sec = times[1].tv_sec = stamp++;
+  times[0].tv_nsec = times[1].tv_nsec = 0;
+  utimensat(AT_FDCWD, dir, times, 0);
+}
+
+int main()
+{
+  checkMatch("*", "anything", true);
+  checkMatch("*.c", "main.c", true);
+  checkMatch("*.c", "main.cpp", false);
+  checkMatch("?.c", "a.c", true);
+  checkMatch("?.c", "ab.c", false);
+  checkMatch("[ab].c", "b.c", true);
+  checkMatch("[ab].c", "c.c", false);
+  checkMatch("[!ab].c", "c.c", true);
+  checkMatch("[^ab].c", "a.c", false);
+  checkMatch("[a-c]x", "bx", true);
+  checkMatch("[a-c]x", "dx", false);
+  checkMatch("[]]", "]", true);
+  checkMatch("[", "[", true);
+  checkMatch("a*b*c", "aXXbYYbZc", true);
+  checkMatch("a*b*c", "aXXbYYbZ", false);
+  checkMatch("\\*", "*", true);
+  checkMatch("\\*", "a", false);
+  checkMatch("**", "deep", true);
+  if (!GlobExpander::hasWildcard("a*") || !GlobExpander::hasWildcard("[ab]") || GlobExpander::hasWildcard("[") ||
+      GlobExpander::hasWildcard("plain") || GlobExpander::hasWildcard("\\*"))
+  {
+    fail("hasWildcard");
+  }
+
+  string root = makeScratchDir("glob");
+  if (chdir(root.c_str()) != 0)
+  {
+    perror("chdir");
+    return 1;
+  }
+  mkdir("sub", 0755);
+  mkdir("sub/deep", 0755);
+  mkdir(".hidden", 0755);
+  touch("a.c");
+  touch("b.c");
+  touch("c.txt");
+  touch(".dot.c");
+  touch("sub/x.c");
+  touch("sub/deep/y.c");
+  touch(".hidden/z.c");
+  settle("sub/deep");
+  settle("sub");
+  settle(".hidden");
+  settle(".");
+
+  GlobExpander globber;
+  checkExpand(globber, "*.c", "a.c b.c");
+  checkExpand(globber, "?.txt", "c.txt");
+  checkExpand(globber, "[!a].c", "b.c");
+  checkExpand(globber, ".*.c", ".dot.c");
+  checkExpand(globber, "*/*.c", "sub/x.c");
+  checkExpand(globber, "*/", "sub/");
+  checkExpand(globber, "sub/*", "sub/deep sub/x.c");
+  checkExpand(globber, "**/*.c", "a.c b.c sub/deep/y.c sub/x.c");
+  checkExpand(globber, "sub/**", "sub/deep sub/deep/y.c sub/x.c");
+  checkExpand(globber, "*/deep/y.c", "sub/deep/y.c");
+  checkExpand(globber, "*.none", "");
+  string absolute = root + "/*.txt";
+  checkExpand(globber, absolute.c_str(), (root + "/c.txt").c_str());
+
+  // Arguments without wildcards, or without matches, are kept as they are:
+  char arg0[] = "ls";
+  char arg1[] = "*.c";
+  char arg2[] = "*.none";
+  char *args[] = {arg0, arg1, arg2, nullptr};
+  vector<string> words;
+  globber.expand(args, nullptr, words);
+  if (words.size() != 4 || words[0] != "ls" || words[1] != "a.c" || words[2] != "b.c" || words[3] != "*.none")
+  {
+    fail("expand");
+  }
+
+  // Repeated globs reuse the listing, and a change to the directory is seen:
+  unsigned long misses = globber.misses();
+  checkExpand(globber, "*.c", "a.c b.c");
+  if (globber.misses() != misses)
+  {
+    fail("expected the listing to be reused");
+  }
+  touch("d.c");
+  settle(".");
+  checkExpand(globber, "*.c", "a.c b.c d.c");
+  // A directory modified just now is read again every time:
+  touch("e.c");
+  misses = globber.misses();
+  checkExpand(globber, "*.c", "a.c b.c d.c e.c");
+  checkExpand(globber, "*.c", "a.c b.c d.c e.c");
+  if (globber.misses() != misses + 2)
+  {
+    fail("expected a recently modified directory to be read again");
+  }
+
+  removeScratchDir(root);
+  return finishTest("test_glob");
+}
@@ -0,0 +1,95 @@
+#include <stdint.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include "Histogram.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+/*
+ * Checks that a percentile is within the precision of a bucket above the exact value
+ * @param histogram - the histogram
+ * @param percent - the percentile
+ * @param exact - the exact value of the percentile
+ * @return
+ *      void
+ */
+static void expectPercentile(const Histogram &histogram, double percent, uint64_t exact)
+{
+  uint64_t found = histogram.percentile(percent);
+  if (found < exact || found > exact + exact / (1 << HISTOGRAM_SUB_BITS))
+  {
+    fail("p" + to_string(percent) + " is " + to_string(found) + ", not about " + to_string(exact));
+  }
+}
+
+int main()
+{
+  // The buckets cover every value once, in order, and small values exactly:
+  for (int bucket = 0; bucket + 2 < HISTOGRAM_BUCKETS; bucket++)
+  {
+    uint64_t limit = Histogram::bucketLimit(bucket);
+    if (Histogram::bucketOf(limit) != bucket || Histogram::bucketOf(limit + 1) != bucket + 1)
+    {
+      fail("bucket " + to_string(bucket) + " does not end at " + to_string(limit));
+      break;
+    }
+  }
+  for (uint64_t value = 0; value < (1 << HISTOGRAM_SUB_BITS); value++)
+  {
+    if (Histogram::bucketLimit(Histogram::bucketOf(value)) != value)
+    {
+      fail("small values are not counted exactly");
+    }
+  }
+  if (Histogram::bucketOf(UINT64_MAX) != HISTOGRAM_BUCKETS - 1)
+  {
+    fail("huge values are not counted in the last bucket");
+  }
+
+  // A bucket is within its relative precision of every value it counts:
+  mt19937_64 random(3);
+  for (int i = 0; i < 100000; i++)
+  {
+    uint64_t value = random() >> (random() % 64);
+    value = value >> (64 - HISTOGRAM_MAX_BITS);
+    uint64_t limit = Histogram::bucketLimit(Histogram::bucketOf(value));
+    if (limit < value || limit - value > value / (1 << HISTOGRAM_SUB_BITS))
+    {
+      fail(to_string(value) + " is counted in a bucket up to " + to_string(limit));
+      break;
+    }
+  }
+
+  // Percentiles of a known distribution:
+  Histogram histogram;
+  if (histogram.percentile(50) != 0 || histogram.count() != 0)
+  {
+    fail("expected an empty histogram");
+  }
+  for (uint64_t value = 10000; value >= 1; value--)
+  {
+    histogram.record(value * 1000);
+  }
+  expectPercentile(histogram, 50, 5000000);
+  expectPercentile(histogram, 90, 9000000);
+  expectPercentile(histogram, 99, 9900000);
+  if (histogram.percentile(100) != 10000000 || histogram.max() != 10000000 || histogram.count() != 10000)
+  {
+    fail("expected the largest value to be the maximum");
+  }
+  histogram.record(UINT64_MAX);
+  if (histogram.percentile(100) != UINT64_MAX)
+  {
+    fail("expected the largest value to be kept");
+  }
+  expectPercentile(histogram, 0, 1000);
+  histogram.reset();
+  if (histogram.count() != 0 || histogram.max() != 0 || histogram.percentile(99) != 0)
+  {
+    fail("expected a reset histogram to be empty");
+  }
+
+  return finishTest("test_histogram");
+}
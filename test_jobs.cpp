@@ -0,0 +1,354 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Jobs.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+/*
+ * Starts a child that exits at once with a status, and waits until it exited without reaping it
+ * @param code - the exit status
+ * @return
+ *      pid_t - the PID of the child
+ */
+static pid_t exitedChild(int code)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    _exit(code);
+  }
+  siginfo_t info;
+  waitid(P_PID, pid, &info, WEXITED | WNOWAIT);
+  return pid;
+}
+
+/*
+ * Handles SIGCHLD, only so it interrupts waiting
+ * @param sig_num - the signal number
+ * @return
+ *      void
+ */
+static void wakeUp(int sig_num) {}
+
+/*
+ * Captures what the jobs list prints
+ * @param jobs - the jobs list
+ * @return
+ *      string - the output of printJobsList
+ */
+static string listing(JobsList &jobs)
+{
+  ostringstream out;
+  streambuf *previous = cout.rdbuf(out.rdbuf());
+  jobs.printJobsList();
+  cout.rdbuf(previous);
+  return out.str();
+}
+
+/*
+ *  ExitingStarter Class:
+ *  Starts a queued job as a child that exits at once, recording the order jobs start in.
+ */
+class ExitingStarter : public JobStarter
+{
+public:
+  /*
+   * Constructor of ExitingStarter class
+   * @param code - the exit status of the child, or -1 to fail to start
+   * @param started - receives the code of every job started
+   * @return
+   *      A new instance of ExitingStarter.
+   */
+  ExitingStarter(int code, vector<int> &started) : m_code(code), m_started(started) {}
+
+  pid_t start() override
+  {
+    m_started.push_back(m_code);
+    return m_code == -1 ? -1 : exitedChild(m_code);
+  }
+
+private:
+  int m_code;
+  vector<int> &m_started;
+};
+
+/*
+ *  CountingReporter Class:
+ *  Counts the reports left on an eventfd, and whether the child waited for was still running
+ *  when they were printed.
+ */
+class CountingReporter : public Reporter
+{
+public:
+  /*
+   * Constructor of CountingReporter class
+   * @param fd - the eventfd the reports are left on
+   * @return
+   *      A new instance of CountingReporter.
+   */
+  explicit CountingReporter(int fd) : m_fd(fd), m_reports(0), m_waited(0), m_isEarly(false) {}
+
+  void printReports() override
+  {
+    uint64_t count = 0;
+    if (read(m_fd, &count, sizeof(count)) == -1 || count == 0)
+    {
+      return;
+    }
+    m_reports += count;
+    siginfo_t info = {};
+    m_isEarly = m_waited != 0 && waitid(P_PID, m_waited, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == 0;
+  }
+
+  int m_fd;
+  uint64_t m_reports;
+  pid_t m_waited;
+  bool m_isEarly;
+};
+
+int main()
+{
+  // IDs follow the largest one in use, and lookups by ID and by PID agree:
+  JobsList jobs;
+  const int count = 20000;
+  for (int i = 0; i < count; i++)
+  {
+    jobs.addJob(i % 2 ? "sleep 100&" : "sleep 200&", 1000000 + i, -1);
+  }
+  if (jobs.size() != count || jobs.getMaxId() != count)
+  {
+    fail("expected " + to_string(count) + " jobs");
+  }
+  for (int i = 0; i < count; i++)
+  {
+    JobsList::JobEntry *byId = jobs.getJobById(i + 1);
+    if (byId == nullptr || byId->m_pid != 1000000 + i || jobs.getJobByPid(1000000 + i) != byId)
+    {
+      fail("lookup of job " + to_string(i + 1) + " failed");
+      break;
+    }
+  }
+  if (jobs.getJobById(0) != nullptr || jobs.getJobById(count + 1) != nullptr || jobs.getJobByPid(1) != nullptr)
+  {
+    fail("expected no job for unknown IDs and PIDs");
+  }
+  // The same CMD line is stored once:
+  if (jobs.getJobById(2)->m_cmd != jobs.getJobById(4)->m_cmd || jobs.getJobById(1)->m_cmd == jobs.getJobById(2)->m_cmd)
+  {
+    fail("expected jobs of the same line to share it");
+  }
+
+  // Removing the last jobs lowers the largest ID, so the next job reuses it:
+  for (int id = count; id > 2; id--)
+  {
+    jobs.removeJobById(id);
+  }
+  jobs.removeJobById(1);
+  if (jobs.size() != 1 || jobs.getMaxId() != 2 || listing(jobs) != "[2] sleep 100&\n")
+  {
+    fail("unexpected list after removals: " + listing(jobs));
+  }
+  jobs.addJob("sleep 300&", 42, -1);
+  if (jobs.getJobById(3) == nullptr || jobs.getJobByPid(42)->m_id != 3 || jobs.getJobByPid(1000000) != nullptr)
+  {
+    fail("expected the new job to take ID 3");
+  }
+  jobs.removeJobById(2);
+  jobs.removeJobById(3);
+  if (!jobs.isEmpty() || jobs.getMaxId() != 0)
+  {
+    fail("expected an empty list");
+  }
+
+  // Finished jobs are reaped through their process fds, and other children are left to their waiter:
+  pid_t first = exitedChild(0);
+  pid_t other = exitedChild(7);
+  jobs.addJob("first&", first, openProcessFd(first));
+  jobs.removeFinishedJobs();
+  siginfo_t info;
+  if (!jobs.isEmpty() || jobs.getMaxId() != 0 || waitid(P_PID, first, &info, WEXITED | WNOHANG) != -1)
+  {
+    fail("the finished job was not reaped");
+  }
+  int status = 0;
+  if (waitpid(other, &status, 0) != other || WEXITSTATUS(status) != 7)
+  {
+    fail("a child that is not a job should not be reaped");
+  }
+
+  // A reaped job is remembered with how it ended, up to a limit:
+  for (int i = 0; i < JOBS_DONE_HISTORY + 5; i++)
+  {
+    pid_t pid = exitedChild(i % 5);
+    jobs.addJob("done&", pid, openProcessFd(pid));
+    jobs.removeFinishedJobs();
+  }
+  const deque<JobsList::FinishedJob> &done = jobs.getFinishedJobs();
+  if (done.size() != JOBS_DONE_HISTORY || done.back().m_cmd != "done&" || WEXITSTATUS(done.back().m_status) != 4 ||
+      done.back().m_usage.ru_maxrss <= 0 || done.back().m_wallNs <= 0 || done.front().m_pid == first)
+  {
+    fail("the finished jobs were not recorded");
+  }
+
+  // Lookups do not reap: a finished job stays in the list until the finished jobs are removed:
+  pid_t finished = exitedChild(0);
+  jobs.addJob("finished&", finished, openProcessFd(finished));
+  if (jobs.getJobByPid(finished) == nullptr || jobs.getJobById(jobs.getMaxId()) == nullptr)
+  {
+    fail("a lookup reaped a finished job");
+  }
+  jobs.removeFinishedJobs();
+  if (jobs.getJobByPid(finished) != nullptr || jobs.size() != 0)
+  {
+    fail("the finished job was not removed");
+  }
+
+  // A job that finishes while the shell waits for another child is reaped during the wait:
+  signal(SIGCHLD, wakeUp);
+  pid_t job = fork();
+  if (job == 0)
+  {
+    _exit(0);
+  }
+  jobs.addJob("job&", job, openProcessFd(job));
+  pid_t foreground = fork();
+  if (foreground == 0)
+  {
+    usleep(100000);
+    _exit(3);
+  }
+  int pidfd = openProcessFd(foreground);
+  status = jobs.waitForChild(foreground, pidfd);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 3)
+  {
+    fail("waiting for the foreground child failed");
+  }
+  if (jobs.size() != 0)
+  {
+    fail("the job was not reaped while waiting");
+  }
+  close(pidfd);
+
+  // A child that stops ends the wait too, though its process fd does not report it:
+  pid_t stopped = fork();
+  if (stopped == 0)
+  {
+    raise(SIGSTOP);
+    _exit(0);
+  }
+  pidfd = openProcessFd(stopped);
+  status = jobs.waitForChild(stopped, pidfd);
+  if (!WIFSTOPPED(status))
+  {
+    fail("a stopped child should end the wait");
+  }
+  signalProcess(stopped, pidfd, SIGKILL);
+  status = jobs.waitForChild(stopped, pidfd);
+  if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGKILL)
+  {
+    fail("the child was not killed through its process fd");
+  }
+  close(pidfd);
+
+  // Reports left by another thread are printed during the wait, before the child ends:
+  int reportFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  CountingReporter reporter(reportFd);
+  jobs.watchReports(reportFd, &reporter);
+  pid_t slow = fork();
+  if (slow == 0)
+  {
+    usleep(300000);
+    _exit(0);
+  }
+  reporter.m_waited = slow;
+  pid_t writer = fork();
+  if (writer == 0)
+  {
+    uint64_t one = 1;
+    usleep(20000);
+    _exit(write(reportFd, &one, sizeof(one)) == sizeof(one) ? 0 : 1);
+  }
+  pidfd = openProcessFd(slow);
+  jobs.waitForChild(slow, pidfd);
+  close(pidfd);
+  waitpid(writer, &status, 0);
+  if (reporter.m_reports != 1 || !reporter.m_isEarly)
+  {
+    fail("the report was not printed during the wait");
+  }
+  close(reportFd);
+
+  // Past the limit jobs are queued, and start first in first out as running jobs leave:
+  JobsList limited;
+  vector<int> started;
+  limited.setMaxRunning(1);
+  pid_t blocker = fork();
+  if (blocker == 0)
+  {
+    pause();
+    _exit(0);
+  }
+  limited.addJob("blocker&", blocker, openProcessFd(blocker));
+  limited.queueJob("first&", unique_ptr<JobStarter>(new ExitingStarter(1, started)));
+  limited.queueJob("failing&", unique_ptr<JobStarter>(new ExitingStarter(-1, started)));
+  limited.queueJob("second&", unique_ptr<JobStarter>(new ExitingStarter(2, started)));
+  limited.queueJob("third&", unique_ptr<JobStarter>(new ExitingStarter(3, started)));
+  if (!started.empty() || !limited.isFull() || limited.size() != 5 || !limited.getJobById(2)->m_isQueued ||
+      listing(limited) != "[1] blocker&\n[2] first& (queued)\n[3] failing& (queued)\n[4] second& (queued)\n"
+                          "[5] third& (queued)\n")
+  {
+    fail("the jobs past the limit were not queued");
+  }
+  limited.sigJobById(5, SIGTERM);
+  signalProcess(blocker, limited.getJobById(1)->m_pidfd, SIGKILL);
+  waitid(P_PID, blocker, &info, WEXITED | WNOWAIT);
+  limited.removeFinishedJobs();
+  if (started != vector<int>({1}) || limited.size() != 3)
+  {
+    fail("the first queued job did not start when the running one finished");
+  }
+  // One that fails to start is dropped, and the next one starts in its place:
+  limited.removeFinishedJobs();
+  if (started != vector<int>({1, -1, 2}) || limited.size() != 1 || limited.getJobById(3) != nullptr)
+  {
+    fail("the queued jobs did not start in order");
+  }
+  limited.removeFinishedJobs();
+  if (!limited.isEmpty() || limited.isFull() || limited.getFinishedJobs().size() != 3)
+  {
+    fail("the started jobs were not reaped");
+  }
+  // Raising the limit starts queued jobs at once, and a queued job can be started ahead of the queue:
+  blocker = fork();
+  if (blocker == 0)
+  {
+    pause();
+    _exit(0);
+  }
+  limited.addJob("blocker&", blocker, -1);
+  limited.queueJob("fourth&", unique_ptr<JobStarter>(new ExitingStarter(4, started)));
+  limited.queueJob("fifth&", unique_ptr<JobStarter>(new ExitingStarter(5, started)));
+  limited.queueJob("sixth&", unique_ptr<JobStarter>(new ExitingStarter(6, started)));
+  limited.startQueuedJob(3);
+  if (started != vector<int>({1, -1, 2, 5}) || limited.size() != 4)
+  {
+    fail("the queued job was not started ahead of the queue");
+  }
+  limited.setMaxRunning(3);
+  if (started != vector<int>({1, -1, 2, 5, 4, 6}) || limited.size() != 3)
+  {
+    fail("the queued jobs did not start when the limit grew");
+  }
+  kill(blocker, SIGKILL);
+  waitpid(blocker, &status, 0);
+
+  return finishTest("test_jobs");
+}
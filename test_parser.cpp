@@ -0,0 +1,488 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <new>
+#include "Commands.h"
+#include "Parser.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+/*
+ * Counts every heap allocation made by the process, so the test can prove that
+ * parsing a command line, and running a built-in command it planned before, do not touch the heap.
+ */
+static size_t allocations = 0;
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+extern "C" void *malloc(size_t size)
+{
+  allocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+  allocations++;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  allocations++;
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+  __libc_free(ptr);
+}
+
+void *operator new(size_t size)
+{
+  void *ptr = malloc(size);
+  if (ptr == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+/*
+ * Reports a failed check of a line
+ * @param line - the CMD line being checked
+ * @param what - a description of the mismatch
+ * @return
+ *      void
+ */
+static void failLine(const char *line, const string &what)
+{
+  fail("\"" + string(line) + "\": " + what);
+}
+
+/*
+ * Parses a line and compares the result with the expected arguments
+ * @param line - the CMD line to parse
+ * @param expected - the expected arguments, separated by single spaces
+ * @param pipeExpected - the expected stages after the first, each preceded by its operator ("| b |& c"), or nullptr
+ * @param redirectionsExpected - the expected redirections of every stage, as "stage:fd" followed by the
+ *        operator and the file ("0:1>out 0:2>&1 1:0<in"); a missing file is written "(missing)"
+ * @param isBackground - whether the line is expected to run in the background
+ * @return
+ *      void
+ */
+static void check(const char *line, const char *expected, const char *pipeExpected, const char *redirectionsExpected,
+                  bool isBackground)
+{
+  char buffer[LINE_ARENA_SIZE];
+  LineArena arena(buffer, sizeof(buffer));
+  ParsedLine parsed;
+  if (!parseCommandLine(line, arena, parsed))
+  {
+    failLine(line, "parse failed");
+    return;
+  }
+  string joined;
+  for (int i = 0; i < parsed.numArgs; i++)
+  {
+    joined += (i ? " " : "") + string(parsed.args[i]);
+  }
+  if (joined != expected || parsed.args[parsed.numArgs] != nullptr)
+  {
+    failLine(line, "args are \"" + joined + "\"");
+  }
+  if ((pipeExpected != nullptr) != (parsed.numStages > 1) || parsed.stages[0].args != parsed.args)
+  {
+    failLine(line, "pipe mismatch");
+  }
+  else if (pipeExpected != nullptr)
+  {
+    string pipeJoined;
+    for (int stage = 1; stage < parsed.numStages; stage++)
+    {
+      pipeJoined += string(stage > 1 ? " " : "") + (parsed.stages[stage - 1].pipeStderr ? "|&" : "|");
+      for (int i = 0; i < parsed.stages[stage].numArgs; i++)
+      {
+        pipeJoined += " " + string(parsed.stages[stage].args[i]);
+      }
+      if (parsed.stages[stage].args[parsed.stages[stage].numArgs] != nullptr)
+      {
+        failLine(line, "stage not terminated");
+      }
+    }
+    if (pipeJoined != pipeExpected)
+    {
+      failLine(line, "pipe stages are \"" + pipeJoined + "\"");
+    }
+  }
+  string redirectionsJoined;
+  for (int stage = 0; stage < parsed.numStages; stage++)
+  {
+    for (int i = 0; i < parsed.stages[stage].numRedirections; i++)
+    {
+      const Redirection &redirection = parsed.stages[stage].redirections[i];
+      const char *ops[] = {"<", ">", ">>", ">&", ">&-", "<<", "<<<"};
+      redirectionsJoined += string(redirectionsJoined.empty() ? "" : " ") + to_string(stage) + ":" +
+                            to_string(redirection.fd) + ops[redirection.type];
+      if (redirection.type == REDIRECT_DUP)
+      {
+        redirectionsJoined += to_string(redirection.sourceFd);
+      }
+      else if (redirection.type != REDIRECT_CLOSE)
+      {
+        redirectionsJoined += redirection.target != nullptr ? redirection.target : "(missing)";
+      }
+    }
+  }
+  if (redirectionsJoined != redirectionsExpected)
+  {
+    failLine(line, "redirections are \"" + redirectionsJoined + "\"");
+  }
+  if (parsed.isBackground != isBackground)
+  {
+    failLine(line, "background mismatch");
+  }
+}
+
+/*
+ * Classifies a line on every instruction set the CPU supports and compares the results
+ * with a plain search for each metacharacter
+ * @param line - the CMD line to classify
+ * @param length - the length of line
+ * @return
+ *      void
+ */
+static void checkClassifier(const char *line, size_t length)
+{
+  // Both quotes share the last bit:
+  const char *metaChars = "><|&*?[\"'";
+  unsigned expectedMask = 0;
+  string expectedOffsets;
+  for (size_t i = 0; i < length; i++)
+  {
+    const char *found = line[i] ? strchr(metaChars, line[i]) : nullptr;
+    if (found != nullptr)
+    {
+      expectedMask |= 1u << min<long>(found - metaChars, 7);
+      expectedOffsets += to_string(i) + ",";
+    }
+  }
+  ClassifierIsa isas[] = {CLASSIFIER_SCALAR, CLASSIFIER_SSE2, CLASSIFIER_AVX2};
+  for (ClassifierIsa isa : isas)
+  {
+    if (isa > bestClassifierIsa())
+    {
+      break;
+    }
+    char buffer[LINE_ARENA_SIZE];
+    LineArena arena(buffer, sizeof(buffer));
+    LineClass cls;
+    if (!classifyLineWith(isa, line, length, arena, cls))
+    {
+      failLine(line, "classify failed");
+      continue;
+    }
+    string offsets;
+    for (size_t i = 0; i < cls.numOffsets; i++)
+    {
+      offsets += to_string(cls.offsets[i]) + ",";
+    }
+    if (cls.mask != expectedMask || offsets != expectedOffsets)
+    {
+      failLine(line, "classifier " + to_string(isa) + " disagrees with a plain search");
+    }
+  }
+}
+
+int main()
+{
+  check("", "", nullptr, "", false);
+  check("   \t ", "", nullptr, "", false);
+  check("pwd", "pwd", nullptr, "", false);
+  check("  chprompt   hello  ", "chprompt hello", nullptr, "", false);
+  check("sleep 10&", "sleep 10", nullptr, "", true);
+  check("sleep 10 &  ", "sleep 10", nullptr, "", true);
+  check("echo hi>out.txt", "echo hi", nullptr, "0:1>out.txt", false);
+  check("echo hi >> out.txt", "echo hi", nullptr, "0:1>>out.txt", false);
+  check("echo hi >", "echo hi", nullptr, "0:1>(missing)", false);
+  check("echo hi > out extra", "echo hi extra", nullptr, "0:1>out", false);
+  check("sort < in > out", "sort", nullptr, "0:0<in 0:1>out", false);
+  check("ls missing 2>err", "ls missing", nullptr, "0:2>err", false);
+  check("ls missing &> all", "ls missing", nullptr, "0:1>all 0:2>&1", false);
+  check("ls missing &>> all", "ls missing", nullptr, "0:1>>all 0:2>&1", false);
+  check("ls missing >& all", "ls missing", nullptr, "0:1>all 0:2>&1", false);
+  check("cmd > f 2>&1", "cmd", nullptr, "0:1>f 0:2>&1", false);
+  check("echo hi >&2", "echo hi", nullptr, "0:1>&2", false);
+  check("ls 3>&- 4<&0", "ls", nullptr, "0:3>&- 0:4>&0", false);
+  check("echo a2>x", "echo a2", nullptr, "0:1>x", false);
+  check("echo 2 > x", "echo 2", nullptr, "0:1>x", false);
+  check("2>err ls &", "ls", nullptr, "0:2>err", true);
+  check("ls -l|grep x", "ls -l", "| grep x", "", false);
+  check("ls nothing |& cat", "ls nothing", "|& cat", "", false);
+  check("ls | sort > sorted", "ls", "| sort", "1:1>sorted", false);
+  check("cat log|grep x |& sort|uniq -c | head", "cat log", "| grep x |& sort | uniq -c | head", "", false);
+  check("a | b > out | c", "a", "| b | c", "1:1>out", false);
+  check("a 2>x | b < y", "a", "| b", "0:2>x 1:0<y", false);
+  check("a > | b", "a", "| b", "0:1>(missing)", false);
+  check("a | | b", "a", "| | b", "", false);
+  check("cat <<EOF", "cat", nullptr, "0:0<<EOF", false);
+  check("cat << END -n | wc 3<<<word", "cat -n", "| wc", "0:0<<END 1:3<<<word", false);
+  check("tr a b <<<x>out", "tr a b", nullptr, "0:0<<<x 0:1>out", false);
+  // Quotes keep spaces and metacharacters in a word, and are removed:
+  check("find g -name \"*.txt\"", "find g -name *.txt", nullptr, "", false);
+  check("echo 'a | b' \"c > d\" \"it's\"", "echo a | b c > d it's", nullptr, "", false);
+  check("echo x\"a  b\"'c'y \"\"", "echo xa  bcy ", nullptr, "", false);
+  check("grep 'a|b' < \"in file\" | wc", "grep a|b", "| wc", "0:0<in file", false);
+  check("echo \"a &\"", "echo a &", nullptr, "", false);
+  check("echo 'open | x", "echo open | x", nullptr, "", false);
+
+  // Quoted words are marked, through the pipeline stages and past the redirection targets:
+  char quoteBuffer[LINE_ARENA_SIZE];
+  LineArena quoteArena(quoteBuffer, sizeof(quoteBuffer));
+  ParsedLine quotedLine;
+  parseCommandLine("ls *.c > 'out' | grep \"*.c\" b", quoteArena, quotedLine);
+  const bool *quoted = quotedLine.stages[1].quoted;
+  if (quotedLine.stages[0].quoted == nullptr || quoted == nullptr || quotedLine.stages[0].quoted[1] || quoted[0] ||
+      !quoted[1] || quoted[2])
+  {
+    fail("expected only the second word of the second stage to be quoted");
+  }
+  quoteArena.reset();
+  parseCommandLine("ls *.c | grep b", quoteArena, quotedLine);
+  if (quotedLine.stages[0].quoted != nullptr || quotedLine.stages[1].quoted != nullptr)
+  {
+    fail("expected a line without quotes to have no quoted words");
+  }
+
+  // Every instruction set finds the same metacharacters, including in the unaligned tail:
+  const char *classified[] = {"", "ls", "a>b", "cat a | grep b >> c &", "echo [a-z]*.txt ?x",
+                              "sleep 100 &", "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<",
+                              "0123456789abcde>0123456789abcdef|0123456789abcdef&0123456789abcde*"};
+  for (const char *line : classified)
+  {
+    checkClassifier(line, strlen(line));
+  }
+  srand(5);
+  for (int round = 0; round < 200; round++)
+  {
+    char random[600];
+    size_t length = rand() % sizeof(random);
+    for (size_t i = 0; i < length; i++)
+    {
+      random[i] = (rand() % 4) ? "ab >|&*?[<\"'"[rand() % 12] : (char)(rand() % 256);
+    }
+    checkClassifier(random, length);
+  }
+  char maskBuffer[LINE_ARENA_SIZE];
+  LineArena maskArena(maskBuffer, sizeof(maskBuffer));
+  ParsedLine masked;
+  if (!parseCommandLine("cat <<A | cat <<<b <in <<C", maskArena, masked) || masked.numHereDocuments != 3 ||
+      masked.stages[1].redirections[1].type != REDIRECT_INPUT || masked.stages[1].redirections[2].hereIndex != 2)
+  {
+    failLine("cat <<A | cat <<<b <in <<C", "wrong here-document indices");
+  }
+  maskArena.reset();
+  if (!parseCommandLine("ls *.txt | grep a?c &", maskArena, masked) ||
+      masked.metaMask != (META_STAR | META_PIPE | META_QUESTION | META_AMPERSAND))
+  {
+    failLine("ls *.txt | grep a?c &", "wrong metacharacter mask");
+  }
+
+  // Parsing must not allocate once the arena exists:
+  const char *lines[] = {"showpid", "chprompt a-much-longer-prompt-than-sso", "cd ../some/dir",
+                         "sleep 100 &", "echo something >> log.txt", "cat file | grep -v pattern",
+                         "kill -9 1", "chmod 777 file"};
+  char buffer[LINE_ARENA_SIZE];
+  LineArena arena(buffer, sizeof(buffer));
+  ParsedLine parsed;
+  size_t before = allocations;
+  for (int round = 0; round < 1000; round++)
+  {
+    for (const char *line : lines)
+    {
+      arena.reset();
+      if (!parseCommandLine(line, arena, parsed))
+      {
+        failLine(line, "parse failed");
+      }
+    }
+  }
+  if (allocations != before)
+  {
+    fail("parsing made " + to_string(allocations - before) + " heap allocations");
+  }
+
+  // A line longer than the inline buffer spills into the heap instead of being truncated:
+  string longLine;
+  for (int i = 0; i < 5000; i++)
+  {
+    longLine += "arg" + to_string(i) + " ";
+  }
+  arena.reset();
+  before = allocations;
+  if (!parseCommandLine(longLine.c_str(), arena, parsed) || parsed.numArgs != 5000 ||
+      strcmp(parsed.args[4999], "arg4999") != 0)
+  {
+    failLine("<long line>", "long line was not parsed completely");
+  }
+  if (allocations == before)
+  {
+    failLine("<long line>", "expected the arena to spill into the heap");
+  }
+  arena.reset();
+  before = allocations;
+  parseCommandLine("sleep 100 &", arena, parsed);
+  if (allocations != before)
+  {
+    failLine("sleep 100 &", "short line allocated after a long one");
+  }
+  char small[64];
+  LineArena fixed(small, sizeof(small), false);
+  if (parseCommandLine(longLine.c_str(), fixed, parsed))
+  {
+    failLine("<long line>", "expected an arena that cannot grow to be exhausted");
+  }
+
+  // Plan cache: hits skip parsing, do not allocate, and the least recently used plan is evicted:
+  PlanCache plans(2);
+  if (plans.lookup("ls -l") != nullptr || plans.misses() != 1)
+  {
+    failLine("ls -l", "expected a cache miss");
+  }
+  CommandPlan parsedPlan;
+  parsedPlan.builtin = nullptr;
+  arena.reset();
+  parseCommandLine("ls -l", arena, parsedPlan.line);
+  parsedPlan.kind = CMD_EXTERNAL;
+  plans.insert("ls -l", parsedPlan);
+  arena.reset();
+  parseCommandLine("cat a | grep 'b*' > c", arena, parsedPlan.line);
+  parsedPlan.kind = CMD_PIPE;
+  before = allocations;
+  plans.insert("cat a | grep 'b*' > c", parsedPlan);
+  if (allocations != before + 1)
+  {
+    failLine("cat a | grep 'b*' > c", "expected a miss to allocate a single block");
+  }
+  // The cached plan no longer refers to the arena:
+  memset(buffer, 0, sizeof(buffer));
+  arena.reset();
+  before = allocations;
+  const CommandPlan *plan = plans.lookup("cat a | grep 'b*' > c");
+  if (allocations != before)
+  {
+    failLine("cat a | grep 'b*' > c", "cache hit allocated");
+  }
+  if (plan == nullptr || plan->kind != CMD_PIPE || plan->line.numArgs != 2 || plan->line.args[2] != nullptr ||
+      strcmp(plan->line.stages[1].args[1], "b*") != 0 || plan->line.stages[1].args[2] != nullptr ||
+      !plan->line.stages[1].quoted[1] || plan->line.stages[0].quoted[1] || plan->line.stages[0].numRedirections != 0 ||
+      plan->line.stages[1].numRedirections != 1 || strcmp(plan->line.stages[1].redirections[0].target, "c") != 0)
+  {
+    failLine("cat a | grep 'b*' > c", "wrong cached plan");
+  }
+  plans.lookup("ls -l");
+  arena.reset();
+  parseCommandLine("pwd", arena, parsedPlan.line);
+  parsedPlan.kind = CMD_BUILTIN;
+  plans.insert("pwd", parsedPlan);
+  if (plans.size() != 2 || plans.lookup("cat a | grep 'b*' > c") != nullptr || plans.lookup("ls -l") == nullptr)
+  {
+    failLine("pwd", "expected the least recently used plan to be evicted");
+  }
+  if (plans.hits() != 3 || plans.misses() != 2)
+  {
+    failLine("pwd", "wrong hit/miss counters");
+  }
+  plans.clear();
+  if (plans.size() != 0 || plans.lookup("ls -l") != nullptr || plans.lookup("pwd") != nullptr)
+  {
+    failLine("pwd", "expected clear to remove every plan");
+  }
+
+  // Many lines through a small cache: exactly the most recently used ones stay, each with its own plan:
+  PlanCache many(64);
+  for (int i = 0; i < 1000; i++)
+  {
+    string line = "echo " + to_string(i);
+    arena.reset();
+    parseCommandLine(line.c_str(), arena, parsedPlan.line);
+    many.insert(line.c_str(), parsedPlan);
+  }
+  for (int i = 0; i < 1000; i++)
+  {
+    string line = "echo " + to_string(i);
+    const CommandPlan *found = many.lookup(line.c_str());
+    if ((found != nullptr) != (i >= 1000 - 64) || (found != nullptr && to_string(i) != found->line.args[1]))
+    {
+      failLine(line.c_str(), "wrong plan after many evictions");
+    }
+  }
+
+  // Once a built-in line has been planned, running it again goes from the plan cache to the command without
+  // allocating; what the commands print is thrown away:
+  SmallShell &shell = SmallShell::getInstance();
+  const char *builtinLines[] = {"pwd", "showpid", "jobs", "pwd   "};
+  cout.flush();
+  int savedStdout = dup(STDOUT_FILENO);
+  int devNull = open("/dev/null", O_WRONLY);
+  if (savedStdout == -1 || devNull == -1 || dup2(devNull, STDOUT_FILENO) == -1)
+  {
+    perror("dup");
+    return 1;
+  }
+  for (const char *line : builtinLines)
+  {
+    shell.executeCommand(line);
+  }
+  cout.flush();
+  before = allocations;
+  for (int i = 0; i < 100; i++)
+  {
+    for (const char *line : builtinLines)
+    {
+      shell.executeCommand(line);
+    }
+  }
+  cout.flush();
+  size_t executed = allocations - before;
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+  close(devNull);
+  if (executed != 0)
+  {
+    fail("running cached built-in lines made " + to_string(executed) + " allocations");
+  }
+
+  // Neither does finding a program in PATH again on a later line:
+  PathCache paths;
+  paths.lookup("sh");
+  before = allocations;
+  for (int i = 0; i < 100; i++)
+  {
+    paths.startLine();
+    paths.lookup("sh");
+  }
+  if (allocations != before || paths.hits() != 100)
+  {
+    fail("cached PATH lookups made " + to_string(allocations - before) + " allocations");
+  }
+
+  return finishTest("test_parser");
+}
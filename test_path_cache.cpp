@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <string>
+#include "PathCache.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+static string root;
+
+/*
+ * Sets the modification time of a directory to a fixed point in the past, so the cache
+ * can trust it; a different stamp for every call makes each change visible
+ * @param dir - the directory, relative to root
+ * @return
+ *      void
+ */
+static void settle(const string &dir)
+{
+  static time_t stamp = 1000000000;
+  struct timespec times[2];
+  times[0].tv_sec = times[1].tv_sec = stamp++;
+  times[0].tv_nsec = times[1].tv_nsec = 0;
+  utimensat(AT_FDCWD, (root + "/" + dir).c_str(), times, 0);
+}
+
+/*
+ * Creates an executable file
+ * @param path - the file, relative to root
+ * @return
+ *      void
+ */
+static void makeProgram(const string &path)
+{
+  int fd = open((root + "/" + path).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0755);
+  close(fd);
+}
+
+/*
+ * Looks a name up and compares the result with the expected program
+ * @param cache - the cache
+ * @param name - the command name
+ * @param expected - the expected program relative to root, or nullptr if the name should not be found
+ * @return
+ *      void
+ */
+static void expect(PathCache &cache, const char *name, const char *expected)
+{
+  const char *found = cache.lookup(name);
+  string wanted = expected == nullptr ? "" : root + "/" + expected;
+  if ((found == nullptr) != (expected == nullptr) || (found != nullptr && wanted != found))
+  {
+    fail(string(name) + " resolved to " + (found == nullptr ? "nothing" : found));
+  }
+}
+
+int main()
+{
+  root = makeScratchDir("path_cache");
+  const char *originalPath = getenv("PATH");
+  string savedPath = originalPath == nullptr ? PATH_CACHE_DEFAULT_PATH : originalPath;
+  mkdir((root + "/a").c_str(), 0755);
+  mkdir((root + "/b").c_str(), 0755);
+  makeProgram("b/foo");
+  settle("a");
+  settle("b");
+  setenv("PATH", (root + "/a:" + root + "/b").c_str(), 1);
+
+  // Found and missing names are both remembered:
+  PathCache cache;
+  expect(cache, "foo", "b/foo");
+  expect(cache, "foo", "b/foo");
+  expect(cache, "bar", nullptr);
+  expect(cache, "bar", nullptr);
+  if (cache.hits() != 2 || cache.misses() != 2 || cache.entries().size() != 2)
+  {
+    fail("expected 2 hits, 2 misses and 2 entries");
+  }
+  if (cache.lookup("/bin/sh") == nullptr || strcmp(cache.lookup("/bin/sh"), "/bin/sh") != 0)
+  {
+    fail("names with a slash are not looked up");
+  }
+
+  // The directories are checked once per line, so a change is seen on the next line:
+  makeProgram("a/foo");
+  settle("a");
+  expect(cache, "foo", "b/foo");
+  // A program added to an earlier directory shadows the remembered one:
+  cache.startLine();
+  expect(cache, "foo", "a/foo");
+  // A program added anywhere replaces a remembered miss:
+  makeProgram("b/bar");
+  settle("b");
+  cache.startLine();
+  expect(cache, "bar", "b/bar");
+  // A removed program is searched for again:
+  unlink((root + "/a/foo").c_str());
+  settle("a");
+  cache.startLine();
+  expect(cache, "foo", "b/foo");
+  unsigned long misses = cache.misses();
+  cache.startLine();
+  expect(cache, "foo", "b/foo");
+  if (cache.misses() != misses)
+  {
+    fail("expected a hit once the directories settled");
+  }
+
+  // A program that is no longer executable does not change its directory, so it stays cached until
+  // it is forgotten, and is then searched for again:
+  makeProgram("a/foo");
+  settle("a");
+  cache.startLine();
+  expect(cache, "foo", "a/foo");
+  chmod((root + "/a/foo").c_str(), 0644);
+  expect(cache, "foo", "a/foo");
+  cache.forget("foo");
+  expect(cache, "foo", "b/foo");
+  cache.forget("missing");
+
+  // A change of PATH drops everything:
+  setenv("PATH", (root + "/b").c_str(), 1);
+  cache.startLine();
+  if (cache.lookup("foo") == nullptr || cache.entries().size() != 1)
+  {
+    fail("expected the entries to be dropped when PATH changed");
+  }
+
+  // A directory modified just now is not trusted, since its mtime may not have ticked yet:
+  // It is checked once more on each line, not on every lookup:
+  utimensat(AT_FDCWD, (root + "/b").c_str(), nullptr, 0);
+  misses = cache.misses();
+  cache.startLine();
+  expect(cache, "foo", "b/foo");
+  expect(cache, "foo", "b/foo");
+  cache.startLine();
+  expect(cache, "foo", "b/foo");
+  if (cache.misses() != misses + 2)
+  {
+    fail("expected a recently modified directory to be searched again on every line");
+  }
+
+  // Results that depend on the current directory are not kept:
+  cache.clear();
+  if (chdir((root + "/a").c_str()) == 0)
+  {
+    makeProgram("a/local");
+    setenv("PATH", (root + "/b:.").c_str(), 1);
+    cache.startLine();
+    if (cache.lookup("local") == nullptr || !cache.entries().empty())
+    {
+      fail("expected a program found through a relative directory not to be kept");
+    }
+  }
+
+  setenv("PATH", savedPath.c_str(), 1);
+  removeScratchDir(root);
+  return finishTest("test_path_cache");
+}
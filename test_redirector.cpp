@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "Redirector.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+/*
+ * Reads a file
+ * @param path - the file
+ * @return
+ *      string - its contents
+ */
+static string readFile(const string &path)
+{
+  string data;
+  int fd = open(path.c_str(), O_RDONLY);
+  char buffer[4096];
+  ssize_t got;
+  while (fd != -1 && (got = read(fd, buffer, sizeof(buffer))) > 0)
+  {
+    data.append(buffer, got);
+  }
+  close(fd);
+  return data;
+}
+
+/*
+ * Reads a descriptor from where it is positioned until it ends
+ * @param fd - the descriptor
+ * @return
+ *      string - everything read
+ */
+static string readFd(int fd)
+{
+  string data;
+  char buffer[65536];
+  ssize_t got;
+  while ((got = read(fd, buffer, sizeof(buffer))) > 0)
+  {
+    data.append(buffer, got);
+  }
+  return data;
+}
+
+/*
+ * Checks whether two descriptors refer to the same open file
+ * @param first - a descriptor
+ * @param second - another descriptor
+ * @return
+ *      bool - true if they are the same file
+ */
+static bool sameFile(int first, int second)
+{
+  struct stat a;
+  struct stat b;
+  return fstat(first, &a) == 0 && fstat(second, &b) == 0 && a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+}
+
+int main()
+{
+  string root = makeScratchDir("redirector");
+  string out = root + "/out";
+  int original = dup(STDOUT_FILENO);
+
+  // Output of the shell itself goes to the file only while the redirection is applied:
+  {
+    Redirection redirections[] = {{1, REDIRECT_OVERWRITE, out.c_str(), -1}, {2, REDIRECT_DUP, nullptr, 1}};
+    Redirector redirector;
+    if (!redirector.open(redirections, 2) || redirector.numActions() != 2)
+    {
+      fail("could not open the redirections");
+      return 1;
+    }
+    if (redirector.actions()[0].source < REDIRECT_FIRST_SHELL_FD ||
+        (fcntl(redirector.actions()[0].source, F_GETFD) & FD_CLOEXEC) == 0)
+    {
+      fail("the file should be close-on-exec and above the descriptors a redirection can name");
+    }
+    if (!redirector.applyToShell())
+    {
+      fail("could not apply the redirections");
+    }
+    cout << "to the file" << endl;
+    cerr << "errors too" << endl;
+    redirector.restoreShell();
+  }
+  if (readFile(out) != "to the file\nerrors too\n")
+  {
+    fail("the file has \"" + readFile(out) + "\"");
+  }
+  if (!sameFile(original, STDOUT_FILENO) || sameFile(STDERR_FILENO, STDOUT_FILENO) != sameFile(original, STDERR_FILENO))
+  {
+    fail("the standard descriptors were not restored");
+  }
+
+  // Appending keeps what the file had, and the destructor restores what was applied:
+  {
+    Redirection redirections[] = {{1, REDIRECT_APPEND, out.c_str(), -1}};
+    Redirector redirector;
+    redirector.open(redirections, 1);
+    redirector.applyToShell();
+    cout << "appended" << endl;
+  }
+  if (readFile(out) != "to the file\nerrors too\nappended\n" || !sameFile(original, STDOUT_FILENO))
+  {
+    fail("appending to the file or restoring on destruction failed");
+  }
+
+  // A descriptor that was closed before is closed again afterwards:
+  {
+    Redirection redirections[] = {{7, REDIRECT_INPUT, out.c_str(), -1}};
+    Redirector redirector;
+    redirector.open(redirections, 1);
+    redirector.applyToShell();
+    if (fcntl(7, F_GETFD) == -1)
+    {
+      fail("descriptor 7 should be open while redirected");
+    }
+  }
+  if (fcntl(7, F_GETFD) != -1)
+  {
+    fail("descriptor 7 should be closed again");
+  }
+
+  // A file that cannot be opened, or a missing file name, fails without touching the shell:
+  {
+    string missing = root + "/no/such/dir";
+    Redirection redirections[] = {{1, REDIRECT_INPUT, missing.c_str(), -1}};
+    Redirector redirector;
+    if (redirector.open(redirections, 1))
+    {
+      fail("opening a missing file should fail");
+    }
+    Redirection unnamed[] = {{1, REDIRECT_OVERWRITE, nullptr, -1}};
+    Redirector other;
+    if (other.open(unnamed, 1))
+    {
+      fail("a redirection without a file should fail");
+    }
+  }
+
+  // An action added first is overridden by the command's own redirections:
+  {
+    int capture = createMemoryFile("test");
+    Redirection redirections[] = {{1, REDIRECT_OVERWRITE, out.c_str(), -1}};
+    Redirector redirector;
+    redirector.addAction(capture, STDOUT_FILENO);
+    if (capture < REDIRECT_FIRST_SHELL_FD || !redirector.open(redirections, 1) || redirector.numActions() != 2 ||
+        redirector.actions()[0].source != capture || redirector.actions()[1].target != STDOUT_FILENO)
+    {
+      fail("the added action should come before the redirections");
+    }
+    redirector.applyToShell();
+    cout << "last" << endl;
+    redirector.restoreShell();
+    if (readFile(out) != "last\n" || lseek(capture, 0, SEEK_END) != 0)
+    {
+      fail("the redirection should win over the added action");
+    }
+    close(capture);
+  }
+
+  // A here-document holds the lines up to the delimiter, including lines longer than its buffer,
+  // and leaves the rest of the input to be read:
+  string longLine(HERE_DOCUMENT_BUFFER + 100, 'x');
+  string body = "one\n\n EOF\nEOF \n" + longLine + "\n" + string(HERE_DOCUMENT_BUFFER - 2, 'y') + "\nEOFEOF\n";
+  istringstream input(body + "EOF\nnext line\n");
+  int here = readHereDocument(input, "EOF");
+  string rest;
+  getline(input, rest);
+  if (here < REDIRECT_FIRST_SHELL_FD || readFd(here) != body || rest != "next line")
+  {
+    fail("the here-document or the input after it differs");
+  }
+  int seals = fcntl(here, F_GET_SEALS);
+  if (seals == -1 || (seals & F_SEAL_WRITE) == 0 || write(here, "z", 1) != -1)
+  {
+    fail("the here-document should be sealed");
+  }
+  istringstream unterminated("a\nb");
+  int partial = readHereDocument(unterminated, "EOF");
+  if (readFd(partial) != "a\nb\n")
+  {
+    fail("a here-document ended by the input should keep every line");
+  }
+
+  // A here-string is handed to a command through the actions, like a file:
+  int word = makeHereString("word");
+  {
+    Redirection redirections[] = {{0, REDIRECT_HEREDOC, "EOF", -1, 1}, {5, REDIRECT_HERESTRING, "word", -1, 0}};
+    int hereDocuments[] = {word, partial};
+    Redirector redirector;
+    if (!redirector.open(redirections, 2, hereDocuments) || redirector.numActions() != 2 ||
+        redirector.actions()[0].source != partial || redirector.actions()[1].source != word)
+    {
+      fail("the here-documents were not turned into actions");
+    }
+    if (!redirector.applyToShell() || readFd(5) != "word\n")
+    {
+      fail("the here-string was not readable on descriptor 5");
+    }
+    Redirector failed;
+    int missing[] = {-1};
+    if (failed.open(redirections + 1, 1, missing))
+    {
+      fail("a here-document that could not be made should fail");
+    }
+  }
+  close(here);
+  close(partial);
+  close(word);
+  close(original);
+
+  removeScratchDir(root);
+  return finishTest("test_redirector");
+}
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "Relay.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+/*
+ * Builds a stream that does not repeat within a pipe buffer, so misplaced data is noticed
+ * @param size - the length of the stream
+ * @return
+ *      string - the stream
+ */
+static string makeData(size_t size)
+{
+  string data(size, '\0');
+  unsigned state = 12345;
+  for (size_t i = 0; i < size; i++)
+  {
+    state = state * 1103515245 + 12345;
+    data[i] = static_cast<char>(state >> 16);
+  }
+  return data;
+}
+
+/*
+ * Writes a whole string into a descriptor, then closes it
+ * @param fd - the descriptor
+ * @param data - the string
+ * @return
+ *      void
+ */
+static void writeAll(int fd, const string &data)
+{
+  size_t done = 0;
+  while (done < data.size())
+  {
+    ssize_t written = write(fd, data.data() + done, data.size() - done);
+    if (written == -1)
+    {
+      break;
+    }
+    done += written;
+  }
+  close(fd);
+}
+
+/*
+ * Reads a descriptor until it ends
+ * @param fd - the descriptor
+ * @return
+ *      string - everything read
+ */
+static string readAll(int fd)
+{
+  string data;
+  char buffer[65536];
+  ssize_t got;
+  while ((got = read(fd, buffer, sizeof(buffer))) > 0)
+  {
+    data.append(buffer, got);
+  }
+  return data;
+}
+
+/*
+ * Reads a file
+ * @param path - the file
+ * @return
+ *      string - its contents
+ */
+static string readFile(const string &path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  string data = readAll(fd);
+  close(fd);
+  return data;
+}
+
+int main()
+{
+  signal(SIGPIPE, SIG_IGN);
+  int sized[2];
+  if (makePipe(sized, 1 << 20) != 0 || fcntl(sized[1], F_GETPIPE_SZ) != 1 << 20 ||
+      (fcntl(sized[0], F_GETFD) & FD_CLOEXEC) == 0)
+  {
+    fail("expected a close-on-exec pipe of 1 MiB");
+  }
+  close(sized[0]);
+  close(sized[1]);
+
+  // A plain relay moves the whole stream and counts it:
+  string data = makeData(3 * 1000 * 1000 + 17);
+  int in[2];
+  int out[2];
+  makePipe(in, 0);
+  makePipe(out, 0);
+  shared_ptr<Relay> relay = make_shared<Relay>(in[0], out[1], true);
+  if (relay->start() != 0)
+  {
+    fail("could not start the relay");
+    return 1;
+  }
+  thread writer(writeAll, in[1], cref(data));
+  string received = readAll(out[0]);
+  writer.join();
+  relay->join();
+  close(out[0]);
+  if (received != data || relay->stats().bytes != data.size())
+  {
+    fail("the plain relay lost or reordered data");
+  }
+
+  // Copies get the whole stream too, including one that only takes write(2) (append mode refuses splice):
+  string root = makeScratchDir("relay");
+  makePipe(in, 0);
+  makePipe(out, 0);
+  relay = make_shared<Relay>(in[0], out[1], true);
+  relay->addCopy(open((root + "/copy").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+  relay->addCopy(open((root + "/append").c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644));
+  if (relay->start() != 0)
+  {
+    fail("could not start the relay with copies");
+    return 1;
+  }
+  writer = thread(writeAll, in[1], cref(data));
+  received = readAll(out[0]);
+  writer.join();
+  relay->join();
+  close(out[0]);
+  if (received != data || relay->stats().bytes != data.size())
+  {
+    fail("the relay with copies lost or reordered data");
+  }
+  if (readFile(root + "/copy") != data)
+  {
+    fail("the spliced copy differs");
+  }
+  if (readFile(root + "/append") != data)
+  {
+    fail("the copy written through the buffer differs");
+  }
+
+  // Once the reader of the main output is gone, the relay stops:
+  makePipe(in, 0);
+  makePipe(out, 0);
+  close(out[0]);
+  relay = make_shared<Relay>(in[0], out[1], true);
+  relay->start();
+  writeAll(in[1], "lost");
+  relay->join();
+  if (relay->stats().bytes != 0)
+  {
+    fail("nothing can be relayed to a closed pipe");
+  }
+  makePipe(in, 0);
+  relay = make_shared<Relay>(in[0], -1, false);
+  relay.reset();
+  if (write(in[1], "x", 1) != -1 || errno != EPIPE)
+  {
+    fail("a relay that never started should close its input");
+  }
+  close(in[1]);
+
+  removeScratchDir(root);
+  return finishTest("test_relay");
+}
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "TimerWheel.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+int main()
+{
+  // Timers on every level expire exactly at their deadline, wherever the wheel stops on the way:
+  TimerWheel wheel(1000);
+  const int64_t span = static_cast<int64_t>(1) << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS);
+  mt19937_64 random(7);
+  map<uint64_t, int64_t> expected;
+  for (uint64_t key = 0; key < 20000; key++)
+  {
+    int level = random() % (TIMER_WHEEL_LEVELS + 1);
+    int64_t reach = level == TIMER_WHEEL_LEVELS ? span * 3 : static_cast<int64_t>(1) << (TIMER_WHEEL_SLOT_BITS * (level + 1));
+    int64_t deadline = 1000 + 1 + random() % reach;
+    wheel.schedule(key, deadline);
+    expected[key] = deadline;
+  }
+  // Some are cancelled, and some moved to another deadline:
+  for (uint64_t key = 0; key < 20000; key += 7)
+  {
+    if (!wheel.cancel(key))
+    {
+      fail("a scheduled timer could not be cancelled");
+    }
+    expected.erase(key);
+  }
+  for (uint64_t key = 3; key < 20000; key += 11)
+  {
+    if (expected.count(key))
+    {
+      expected[key] = 1000 + 1 + random() % 5000;
+      wheel.schedule(key, expected[key]);
+    }
+  }
+  if (wheel.cancel(7) || wheel.size() != expected.size())
+  {
+    fail("expected " + to_string(expected.size()) + " timers, not " + to_string(wheel.size()));
+  }
+  int64_t last = 0;
+  for (const auto &entry : expected)
+  {
+    last = max(last, entry.second);
+  }
+  int64_t now = 1000;
+  size_t fired = 0;
+  while (now < last)
+  {
+    int64_t next = wheel.nextTick();
+    int64_t earliest = INT64_MAX;
+    for (const auto &entry : expected)
+    {
+      earliest = min(earliest, entry.second);
+    }
+    if (next == -1 || next > earliest)
+    {
+      fail("the next tick " + to_string(next) + " is after the deadline " + to_string(earliest));
+      break;
+    }
+    // Either to the next tick, or a random step past it:
+    now = random() % 3 == 0 ? next : now + 1 + random() % 50000;
+    vector<uint64_t> expired;
+    wheel.advance(now, expired);
+    for (uint64_t key : expired)
+    {
+      auto found = expected.find(key);
+      if (found == expected.end() || found->second > now)
+      {
+        fail("timer " + to_string(key) + " expired at " + to_string(now) + " or expired twice");
+        return 1;
+      }
+      expected.erase(found);
+      fired++;
+    }
+    for (const auto &entry : expected)
+    {
+      if (entry.second <= now)
+      {
+        fail("timer " + to_string(entry.first) + " did not expire by " + to_string(now));
+        return 1;
+      }
+    }
+  }
+  if (!expected.empty() || wheel.size() != 0 || wheel.nextTick() != -1 || fired == 0)
+  {
+    fail("expected every timer to expire");
+  }
+
+  // Moving to each next tick lands exactly on the deadlines:
+  TimerWheel exact(0);
+  exact.schedule(1, 70);
+  exact.schedule(2, 5000);
+  exact.schedule(3, span + 5);
+  exact.schedule(4, -3);
+  vector<uint64_t> order;
+  vector<int64_t> ticks;
+  while (exact.nextTick() != -1)
+  {
+    size_t before = order.size();
+    exact.advance(exact.nextTick(), order);
+    if (order.size() != before)
+    {
+      ticks.push_back(exact.now());
+    }
+  }
+  if (order != vector<uint64_t>({4, 1, 2, 3}) || ticks != vector<int64_t>({1, 70, 5000, span + 5}))
+  {
+    fail("the timers did not expire in order at their deadlines");
+  }
+
+  return finishTest("test_timer_wheel");
+}
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "WorkingDir.h"
+#include "TestSupport.h"
+
+using namespace std;
+
+static string root;
+
+/*
+ * Resolves a path and compares the result with the expected one
+ * @param base - the directory to resolve from, relative to root
+ * @param path - the path
+ * @param expected - the expected path relative to root, or nullptr if the path should not resolve
+ * @param expectedErrno - the expected errno when the path should not resolve
+ * @return
+ *      void
+ */
+static void expectResolved(const string &base, const char *path, const char *expected, int expectedErrno = 0)
+{
+  string resolved;
+  errno = 0;
+  bool isResolved = WorkingDir::resolve(root + base, path, resolved);
+  if (expected == nullptr && (isResolved || errno != expectedErrno))
+  {
+    fail(string(path) + " resolved, or failed with errno " + to_string(errno));
+  }
+  else if (expected != nullptr && (!isResolved || resolved != root + expected))
+  {
+    fail(string(path) + " resolved to " + (isResolved ? resolved : "nothing"));
+  }
+}
+
+/*
+ * Compares the current directory, as kept and as the kernel knows it, with the expected one
+ * @param workingDir - the current directory
+ * @param expected - the expected directory relative to root
+ * @return
+ *      void
+ */
+static void expectAt(WorkingDir &workingDir, const string &expected)
+{
+  char *cwd = getcwd(nullptr, 0);
+  if (cwd == nullptr || workingDir.path() != root + expected || string(cwd) != root + expected)
+  {
+    fail("expected to be in " + root + expected + ", not " + workingDir.path());
+  }
+  free(cwd);
+}
+
+int main()
+{
+  root = makeScratchDir("working_dir");
+  mkdir((root + "/a").c_str(), 0755);
+  mkdir((root + "/a/b").c_str(), 0755);
+  mkdir((root + "/a/b/c").c_str(), 0755);
+  symlink("a/b", (root + "/link").c_str());
+  symlink((root + "/a").c_str(), (root + "/abs").c_str());
+  symlink("..", (root + "/a/b/up").c_str());
+  symlink("loop2", (root + "/loop1").c_str());
+  symlink("loop1", (root + "/loop2").c_str());
+
+  // "." and ".." are taken off, and links are followed before ".." goes up from them:
+  expectResolved("", "a/./b//c/", "/a/b/c");
+  expectResolved("", "link/..", "/a");
+  expectResolved("/a/b", "../../abs/b", "/a/b");
+  expectResolved("/a/b", "up/b/up/b/c", "/a/b/c");
+  expectResolved("", "link/c/../../b", "/a/b");
+  expectResolved("", "loop1", nullptr, ELOOP);
+  expectResolved("", "missing/..", nullptr, ENOENT);
+  string top;
+  if (!WorkingDir::resolve("/", "../..", top) || top != "/")
+  {
+    fail("expected the parent of / to be /");
+  }
+
+  // Changes follow the kernel, and the previous directory is kept:
+  if (chdir(root.c_str()) != 0)
+  {
+    perror("chdir");
+    return 1;
+  }
+  {
+    // The first change is to an absolute directory, which does not need the current one to be resolved:
+    WorkingDir first;
+    if (!first.change((root + "/a").c_str()) || first.previous() != root)
+    {
+      fail("expected the first change to keep the directory it left");
+    }
+    if (chdir(root.c_str()) != 0)
+    {
+      perror("chdir");
+      return 1;
+    }
+  }
+  WorkingDir workingDir;
+  expectAt(workingDir, "");
+  if (!workingDir.change("link") || workingDir.previous() != root)
+  {
+    fail("expected to change through a link");
+  }
+  expectAt(workingDir, "/a/b");
+  workingDir.change("..");
+  expectAt(workingDir, "/a");
+  workingDir.changeBack();
+  expectAt(workingDir, "/a/b");
+  if (workingDir.change("missing"))
+  {
+    fail("expected not to change to a missing directory");
+  }
+  expectAt(workingDir, "/a/b");
+
+  // The stack returns to its directories in order, and pushd with no directory exchanges the top:
+  workingDir.push("c");
+  workingDir.push(root.c_str());
+  expectAt(workingDir, "");
+  vector<string> dirs;
+  workingDir.listStack(dirs);
+  if (dirs != vector<string>({root, root + "/a/b/c", root + "/a/b"}) || workingDir.depth() != 2)
+  {
+    fail("expected the stack to hold / a/b/c a/b below root");
+  }
+  workingDir.push(nullptr);
+  expectAt(workingDir, "/a/b/c");
+  workingDir.pop();
+  expectAt(workingDir, "");
+  workingDir.pop();
+  expectAt(workingDir, "/a/b");
+  if (workingDir.pop() || workingDir.push(nullptr) || workingDir.depth() != 0)
+  {
+    fail("expected an empty stack");
+  }
+
+  // Paths have no length limit:
+  string deep;
+  for (int i = 0; i < 8; i++)
+  {
+    deep += "/" + string(60, 'd' + i);
+    mkdir((root + deep).c_str(), 0755);
+  }
+  workingDir.change((root + deep).c_str());
+  expectAt(workingDir, deep);
+  workingDir.change("../../..");
+  expectAt(workingDir, deep.substr(0, 5 * 61));
+
+  removeScratchDir(root);
+  return finishTest("test_working_dir");
+}